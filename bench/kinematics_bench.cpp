@@ -0,0 +1,907 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <memory>
+#include <atomic>
+#include <cstdlib>
+#include <cerrno>
+#include <cmath>
+#include <thread>
+#include <pty.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+
+#include <benchmark/benchmark.h>
+
+#include "../include/utils.h"
+#include "../include/serial_com.h"
+#include "../include/euler_rotations.h"
+#include "../include/animated_hand.h"
+#include "../include/finger.h"
+#include "../include/hand_kinematics.h"
+#include "../include/skinning_kernel.h"
+#include "../include/jacobian_batch.h"
+#include "../include/hand_collision.h"
+#include "../include/joint_calibration.h"
+#include "../include/one_euro_filter.h"
+#include "../include/trajectory_batch.h"
+#include "../include/exoskeleton.h"
+#include "../include/frame_arena.h"
+#include "../include/pose_history.h"
+
+/**
+ * Benchmarks of the hot paths of the animation: parsing, calibration and
+ * filtering of the glove lines, reading of the serial port, mapping of the
+ * joint angles to the hand frames, rotations, forward kinematics and
+ * skinning of the fingers and hands, fingertip Jacobians over a trajectory
+ * and the offline processing of a session.
+ * The benchmarks only time these paths, their results are checked against
+ * reference implementations by kinematics_test (see tests/).
+ * They only link the kinematics core (hand_kinematics library) and the
+ * acquisition (serial port, Exoskeleton::), so they run without a display.
+ * The heap allocations of the process are counted (malloc and its family,
+ * which operator new and Eigen use), so a benchmark can report the
+ * allocations of the frames of the animation.
+ * The benchmarks load the configuration and mesh files from the share folder,
+ * so they must be run from the root of the repository (like main). The
+ * results are written to kinematics_bench.json unless --benchmark_out is
+ * given.
+ */
+
+/// Number of heap allocations of the process (see malloc).
+static std::atomic<size_t> g_allocations_num{0};
+
+/// Allocation functions of the C library (the replacements below count the
+/// allocations and forward to them).
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t num, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+extern "C" void* __libc_memalign(size_t alignment, size_t size);
+
+/// Replacements of the allocation functions that count the allocations.
+extern "C" void* malloc(size_t size)
+{
+    g_allocations_num.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t num, size_t size)
+{
+    g_allocations_num.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(num, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+    g_allocations_num.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void* memalign(size_t alignment, size_t size)
+{
+    g_allocations_num.fetch_add(1, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void** ptr, size_t alignment, size_t size)
+{
+    *ptr = memalign(alignment, size);
+    return *ptr ? 0 : ENOMEM;
+}
+
+/// Glove line of the default topology (13 channels, device tick, sequence).
+static const std::string g_glove_line = "12.50,-3.25,45.00,0.00,1.50,2.50,"
+    "3.50,-4.50,5.50,6.50,-7.50,8.50,9.50,123456,77";
+
+/// Number of precomputed frames of joint angles.
+static constexpr size_t g_frames_num = 64;
+
+/// Joint angles of the precomputed frames (rad).
+static std::vector<std::vector<double>> get_joint_angles(size_t channels_num)
+{
+    std::vector<std::vector<double>> joint_angles(g_frames_num,
+        std::vector<double>(channels_num));
+    for (size_t frame = 0; frame < g_frames_num; frame++)
+    {
+        for (size_t i = 0; i < channels_num; i++)
+        {
+            joint_angles.at(frame).at(i) = 0.5 * sin(0.1 * frame + i);
+        }
+    }
+    return joint_angles;
+}
+
+/********************** Parsing of the glove lines **********************/
+static void BM_AnalogStrBufToDoubleVec(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(Utils::analog_str_buf_to_double_vec(
+            g_glove_line));
+    }
+    state.SetBytesProcessed(state.iterations() * g_glove_line.size());
+}
+BENCHMARK(BM_AnalogStrBufToDoubleVec);
+
+static void BM_ParseDoubleVec(benchmark::State& state)
+{
+    std::vector<double> data_vec;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(Utils::parse_double_vec(g_glove_line,
+            data_vec));
+        benchmark::DoNotOptimize(data_vec.data());
+    }
+    state.SetBytesProcessed(state.iterations() * g_glove_line.size());
+}
+BENCHMARK(BM_ParseDoubleVec);
+
+/// Calibration of a parsed line (calibration file with a cubic correction
+/// on every channel, see JointCalibration::).
+static void BM_JointCalibrationApply(benchmark::State& state)
+{
+    // Channels of the line (without the tick and the sequence counter)
+    AnimatedHand anim_hand;
+    anim_hand.initialize();
+
+    std::vector<double> data_vec;
+    Utils::parse_double_vec(g_glove_line, data_vec);
+    data_vec.resize(anim_hand.get_channels_num());
+
+    std::vector<JointCalibration::Parameters> parameters;
+    JointCalibration::load_parameters(anim_hand.get_channel_signs(),
+        parameters);
+    for (auto& channel : parameters)
+    {
+        channel.polynomial = {0.5, 0.98, 1e-4, -2e-6};
+    }
+    JointCalibration calibration;
+    calibration.initialize(parameters);
+
+    std::vector<double> sample;
+    for (auto _ : state)
+    {
+        sample = data_vec;
+        calibration.apply(sample);
+        benchmark::DoNotOptimize(sample.data());
+    }
+}
+BENCHMARK(BM_JointCalibrationApply);
+
+/// Filtering of a sample of the 13 channels at 1 kHz (every channel
+/// enabled, see OneEuroFilter::).
+static void BM_OneEuroFilter(benchmark::State& state)
+{
+    const size_t channels_num = 13;
+    const std::vector<std::vector<double>> joint_angles =
+        get_joint_angles(channels_num);
+
+    OneEuroFilter filter;
+    filter.initialize(std::vector<OneEuroFilter::Parameters>(channels_num,
+        OneEuroFilter::Parameters{1.0, 0.007, 1.0}));
+
+    std::vector<double> sample;
+    size_t frame = 0;
+    for (auto _ : state)
+    {
+        sample = joint_angles.at(frame);
+        filter.filter(sample, 1e-3);
+        benchmark::DoNotOptimize(sample.data());
+        frame = (frame + 1) % g_frames_num;
+    }
+}
+BENCHMARK(BM_OneEuroFilter);
+
+/************************* Serial port (pty) ***************************/
+/// Serial port fixture: a pseudo terminal whose master side plays the glove.
+class SerialFixture : public benchmark::Fixture
+{
+public:
+    void SetUp(const benchmark::State&) override
+    {
+        // Open pseudo terminal in raw mode
+        char name[256];
+        openpty(&m_master, &m_slave, name, nullptr, nullptr);
+        struct termios tty;
+        tcgetattr(m_slave, &tty);
+        cfmakeraw(&tty);
+        tcsetattr(m_slave, TCSANOW, &tty);
+
+        // Open serial port on the slave side
+        m_serial = std::make_shared<SerialCOM>(name, 115200);
+
+        // Lines written at once (they fit in the pty buffer)
+        m_lines.clear();
+        for (size_t i = 0; i < m_lines_num; i++)
+        {
+            m_lines += g_glove_line + "\r\n";
+        }
+    }
+
+    void TearDown(const benchmark::State&) override
+    {
+        m_serial.reset();
+        close(m_slave);
+        close(m_master);
+    }
+
+protected:
+    /// Write a batch of lines to the master side.
+    void write_lines(void)
+    {
+        if (write(m_master, m_lines.data(), m_lines.size()) < 0) { return; }
+    }
+
+    /// Pseudo terminal descriptors.
+    int m_master = -1, m_slave = -1;
+
+    /// Serial port on the slave side.
+    std::shared_ptr<SerialCOM> m_serial;
+
+    /// Batch of lines and its number of lines.
+    std::string m_lines;
+    static constexpr size_t m_lines_num = 32;
+};
+
+BENCHMARK_F(SerialFixture, ReadLine)(benchmark::State& state)
+{
+    std::string line;
+    double timestamp;
+    size_t pending = 0;
+    for (auto _ : state)
+    {
+        // Refill the pty (not timed)
+        if (pending == 0)
+        {
+            state.PauseTiming();
+            write_lines();
+            pending = m_lines_num;
+            state.ResumeTiming();
+        }
+
+        m_serial->readLine(line, timestamp);
+        benchmark::DoNotOptimize(line.data());
+        pending--;
+    }
+
+    // Drain the remaining lines
+    for (; pending > 0; pending--) { m_serial->readLine(line, timestamp); }
+
+    state.SetBytesProcessed(state.iterations() * (g_glove_line.size() + 2));
+}
+
+/*************************** Glove mapping *****************************/
+static void BM_GetHandAngles(benchmark::State& state)
+{
+    AnimatedHand anim_hand;
+    anim_hand.initialize();
+
+    std::vector<std::vector<double>> joint_angles =
+        get_joint_angles(anim_hand.get_channels_num());
+    AnimatedHand::HandAngles euler_arr;
+    size_t frame = 0;
+    for (auto _ : state)
+    {
+        anim_hand.get_hand_angles(joint_angles.at(frame++ % g_frames_num),
+            euler_arr);
+        benchmark::DoNotOptimize(euler_arr.data());
+    }
+}
+BENCHMARK(BM_GetHandAngles);
+
+/****************************** Rotations ******************************/
+static void BM_EulerRotation(benchmark::State& state)
+{
+    double phi = 0.1, theta = 0.2, psi = 0.3;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(EulerRotations::rotation(phi, theta, psi));
+        phi += 1e-3;
+    }
+}
+BENCHMARK(BM_EulerRotation);
+
+static void BM_EulerToQuaternions(benchmark::State& state)
+{
+    double phi = 0.1, theta = 0.2, psi = 0.3;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(EulerRotations::euler_to_quaternions(phi,
+            theta, psi));
+        phi += 1e-3;
+    }
+}
+BENCHMARK(BM_EulerToQuaternions);
+
+static void BM_QuaternionsToEuler(benchmark::State& state)
+{
+    EulerRotations::Quaternions q = EulerRotations::euler_to_quaternions(0.1,
+        0.2, 0.3);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(EulerRotations::quaternions_to_euler(q.w, q.x,
+            q.y, q.z));
+        q.w += 1e-9;
+    }
+}
+BENCHMARK(BM_QuaternionsToEuler);
+
+/****************************** Finger *********************************/
+/// Finger fixture: the index finger with its meshes.
+class FingerFixture : public benchmark::Fixture
+{
+public:
+    void SetUp(const benchmark::State&) override
+    {
+        // Parse hand configuration file
+        std::ifstream file(std::filesystem::current_path() /
+            "share/hand_config.json");
+        nlohmann::json json_file = nlohmann::json::parse(file);
+
+        // Initialize finger and its rest state
+        m_finger = std::make_unique<Finger>();
+        m_finger->initialize("Index", json_file);
+        m_state = m_finger->get_state();
+    }
+
+    void TearDown(const benchmark::State&) override
+    {
+        m_finger.reset();
+    }
+
+protected:
+    /// Set the joint angles of a frame to the state.
+    void set_state(size_t frame)
+    {
+        for (size_t i = 1; i < m_state.size(); i++)
+        {
+            m_state.at(i).euler(1) = 0.5 * sin(0.1 * frame + i);
+        }
+    }
+
+    /// Finger.
+    std::unique_ptr<Finger> m_finger;
+
+    /// Joint state of the finger.
+    std::vector<dm::JointState> m_state;
+};
+
+BENCHMARK_F(FingerFixture, UpdateKinematics)(benchmark::State& state)
+{
+    size_t frame = 0;
+    for (auto _ : state)
+    {
+        set_state(frame++);
+        m_finger->update_kinematics(m_state);
+        benchmark::DoNotOptimize(m_finger->get_global_transforms().data());
+    }
+}
+
+/*************************** Skinning kernel ***************************/
+/// Synthetic skinning problem: the rest-pose streams of 30 links with a joint
+/// and a bone mesh each (their sizes are not multiples of the vector widths,
+/// so the remainders are skinned too) and random link transforms.
+template <typename T>
+struct SkinningProblem
+{
+    using Streams = Eigen::Matrix<T, Eigen::Dynamic, 3>;
+    using Vertices = Eigen::Matrix<T, Eigen::Dynamic, 3, Eigen::RowMajor>;
+
+    SkinningProblem(void)
+    {
+        // Mesh sizes
+        const size_t links_num = 30;
+        std::vector<size_t> sizes;
+        for (size_t i = 0; i < 2 * links_num; i++)
+        {
+            sizes.push_back(i % 2 ? 133 + 7 * i : 97 + 5 * i);
+        }
+        size_t rest_size = 0;
+        for (size_t size : sizes) { rest_size += size; }
+
+        // Rest-pose streams and outputs
+        rest = Streams::Random(rest_size, 3);
+        out = Vertices::Zero(rest_size, 3);
+
+        // Segments (one per mesh) and link transforms
+        size_t offset = 0;
+        for (size_t i = 0; i < sizes.size(); i++)
+        {
+            segments.push_back(SkinningKernel::Segment<T>{offset, sizes.at(i),
+                i / 2, out.data() + 3 * offset});
+            offset += sizes.at(i);
+        }
+        for (size_t i = 0; i < links_num; i++)
+        {
+            Eigen::Matrix4d t_mat = Eigen::Matrix4d::Identity();
+            t_mat.block<3, 3>(0, 0) = EulerRotations::rotation(0.3 * i,
+                0.2 * i + 0.1, 0.7 - 0.1 * i);
+            t_mat.block<3, 1>(0, 3) = Eigen::Vector3d::Random();
+            transforms.push_back(SkinningKernel::rigid_transform<T>(t_mat));
+        }
+    }
+
+    /// Skin the rest-pose streams with the selected instruction set.
+    void skin(void)
+    {
+        SkinningKernel::skin(rest.data(), rest.rows(), segments, transforms);
+    }
+
+    /// Rest-pose streams.
+    Streams rest;
+
+    /// Outputs (interleaved).
+    Vertices out;
+
+    /// Segments and link transforms.
+    std::vector<SkinningKernel::Segment<T>> segments;
+    std::vector<SkinningKernel::RigidTransform<T>> transforms;
+};
+
+/// Skinning of the synthetic problem with an instruction set (argument, see
+/// SkinningKernel::ISA, limited to the ones supported by the CPU, which is
+/// given in the label). The kernels are checked against the scalar one by
+/// kinematics_test.
+template <typename T>
+static void BM_SkinningKernel(benchmark::State& state)
+{
+    SkinningProblem<T> problem;
+
+    // Select instruction set
+    SkinningKernel::ISA default_isa = SkinningKernel::get_isa();
+    SkinningKernel::set_isa((SkinningKernel::ISA) state.range(0));
+    state.SetLabel(SkinningKernel::get_isa_name(SkinningKernel::get_isa()));
+
+    for (auto _ : state)
+    {
+        problem.skin();
+        benchmark::DoNotOptimize(problem.out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * problem.rest.rows());
+
+    SkinningKernel::set_isa(default_isa);
+}
+BENCHMARK_TEMPLATE(BM_SkinningKernel, float)->ArgName("isa")->Arg(0)->Arg(1)
+    ->Arg(2);
+BENCHMARK_TEMPLATE(BM_SkinningKernel, double)->ArgName("isa")->Arg(0)->Arg(1)
+    ->Arg(2);
+
+/******************************* Hand **********************************/
+/// Hand fixture: the kinematic model of a hand, with its meshes skinned on
+/// the CPU (first argument 1) or only its kinematics (first argument 0, as
+/// in the GPU and instanced render modes, see Hand::RenderMode).
+class HandFixture : public benchmark::Fixture
+{
+public:
+    void SetUp(const benchmark::State& state) override
+    {
+        m_anim_hand.initialize();
+        m_hand = std::make_unique<HandKinematics>();
+        m_hand->initialize(0, Eigen::Vector3d(0.0, 0.2, 0.0),
+            state.range(0), state.range(0));
+    }
+
+    void TearDown(const benchmark::State&) override
+    {
+        m_hand.reset();
+    }
+
+protected:
+    /// Animated hand (mapping of the joint angles).
+    AnimatedHand m_anim_hand;
+
+    /// Kinematic model of the hand.
+    std::unique_ptr<HandKinematics> m_hand;
+};
+
+BENCHMARK_DEFINE_F(HandFixture, Update)(benchmark::State& state)
+{
+    // Hand angles of the precomputed frames
+    std::vector<std::vector<double>> joint_angles =
+        get_joint_angles(m_anim_hand.get_channels_num());
+    std::vector<AnimatedHand::HandAngles> euler_arr(g_frames_num);
+    for (size_t i = 0; i < g_frames_num; i++)
+    {
+        m_anim_hand.get_hand_angles(joint_angles.at(i), euler_arr.at(i));
+    }
+
+    size_t frame = 0;
+    for (auto _ : state)
+    {
+        if (state.range(0))
+        {
+            m_hand->update(euler_arr.at(frame++ % g_frames_num));
+            benchmark::DoNotOptimize(m_hand->get_vertex_data().data());
+        }
+        else
+        {
+            m_hand->update_kinematics(euler_arr.at(frame++ % g_frames_num));
+            benchmark::DoNotOptimize(m_hand->get_fingers().data());
+        }
+    }
+}
+BENCHMARK_REGISTER_F(HandFixture, Update)->ArgName("skin")->Arg(1)->Arg(0);
+
+/// Skinning of the hand meshes alone (HandKinematics::update_vertices, the
+/// path of the animation), after the kinematics of each frame (not timed).
+BENCHMARK_DEFINE_F(HandFixture, UpdateVertices)(benchmark::State& state)
+{
+    // Hand angles of the precomputed frames
+    std::vector<std::vector<double>> joint_angles =
+        get_joint_angles(m_anim_hand.get_channels_num());
+    std::vector<AnimatedHand::HandAngles> euler_arr(g_frames_num);
+    for (size_t i = 0; i < g_frames_num; i++)
+    {
+        m_anim_hand.get_hand_angles(joint_angles.at(i), euler_arr.at(i));
+    }
+
+    size_t frame = 0;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        m_hand->update_kinematics(euler_arr.at(frame++ % g_frames_num));
+        state.ResumeTiming();
+
+        m_hand->update_vertices();
+        benchmark::DoNotOptimize(m_hand->get_vertex_data().data());
+    }
+}
+BENCHMARK_REGISTER_F(HandFixture, UpdateVertices)->ArgName("skin")->Arg(1);
+
+/************************** Fingertip Jacobians ************************/
+/// Jacobians of every finger over a trajectory of precomputed frames (the
+/// argument is the number of threads, see JacobianBatch::). The Jacobians
+/// are checked against central differences by kinematics_test.
+static void BM_JacobianBatchEvaluate(benchmark::State& state)
+{
+    AnimatedHand anim_hand;
+    anim_hand.initialize();
+
+    JacobianBatch::Parameters parameters;
+    parameters.threads_num = state.range(0);
+    JacobianBatch jacobian_batch;
+    jacobian_batch.initialize(parameters);
+
+    // Trajectory (the precomputed frames repeated)
+    std::vector<std::vector<double>> joint_angles =
+        get_joint_angles(anim_hand.get_channels_num());
+    std::vector<AnimatedHand::HandAngles> poses(64 * g_frames_num);
+    for (size_t i = 0; i < poses.size(); i++)
+    {
+        anim_hand.get_hand_angles(joint_angles.at(i % g_frames_num),
+            poses.at(i));
+    }
+
+    std::vector<Finger::JacobianBlock> jacobians;
+    for (auto _ : state)
+    {
+        jacobian_batch.evaluate(poses, jacobians);
+        benchmark::DoNotOptimize(jacobians.data());
+    }
+    state.SetItemsProcessed(state.iterations() * poses.size());
+}
+BENCHMARK(BM_JacobianBatchEvaluate)->ArgName("threads")->Arg(1)->Arg(4)
+    ->UseRealTime();
+
+/************************** Contact queries ****************************/
+/// Refit of the capsules of both hands and the contact queries of a frame
+/// (thumb-index distance, self contacts, distance and contacts between the
+/// hands, see HandCollision::) over the precomputed frames. The queries are
+/// checked against sampling and brute force by kinematics_test.
+static void BM_HandCollisionFrame(benchmark::State& state)
+{
+    AnimatedHand anim_hand;
+    anim_hand.initialize();
+
+    // Poses of the precomputed frames (kinematics only)
+    std::vector<std::vector<double>> joint_angles =
+        get_joint_angles(anim_hand.get_channels_num());
+    HandKinematics left_hand, right_hand;
+    left_hand.initialize(0, Eigen::Vector3d(0.0, 0.2, 0.0), false);
+    right_hand.initialize(1, Eigen::Vector3d(0.0, -0.2, 0.0), false);
+    std::vector<HandKinematics> left_hands(g_frames_num, left_hand);
+    std::vector<HandKinematics> right_hands(g_frames_num, right_hand);
+    AnimatedHand::HandAngles euler_arr;
+    for (size_t i = 0; i < g_frames_num; i++)
+    {
+        anim_hand.get_hand_angles(joint_angles.at(i), euler_arr);
+        left_hands.at(i).update_kinematics(euler_arr);
+        right_hands.at(i).update_kinematics(euler_arr);
+    }
+
+    HandCollision left_collision, right_collision;
+    left_collision.initialize(left_hand, HandCollision::Parameters());
+    right_collision.initialize(right_hand, HandCollision::Parameters());
+
+    std::vector<HandCollision::Contact> contacts;
+    size_t frame_idx = 0;
+    for (auto _ : state)
+    {
+        left_collision.update(left_hands.at(frame_idx));
+        right_collision.update(right_hands.at(frame_idx));
+        benchmark::DoNotOptimize(left_collision.get_finger_distance(0, 1));
+        left_collision.get_self_contacts(contacts);
+        benchmark::DoNotOptimize(left_collision.get_distance(right_collision));
+        left_collision.get_contacts(right_collision, contacts);
+        benchmark::DoNotOptimize(contacts.data());
+        frame_idx = (frame_idx + 1) % g_frames_num;
+    }
+}
+BENCHMARK(BM_HandCollisionFrame);
+
+/************************* Offline trajectories ************************/
+/// Number of lines of the generated session.
+static constexpr size_t g_session_lines = 1 << 17;
+
+/// Generated session: the precomputed frames in degrees, with device tick
+/// and sequence counter. It is written once to a temporary file (the
+/// benchmarks can be run several times to estimate their iterations) and
+/// removed at exit.
+class GeneratedSession
+{
+public:
+    GeneratedSession(size_t channels_num)
+    {
+        m_filename = (std::filesystem::temp_directory_path() /
+            "kinematics_bench_session.txt").string();
+
+        std::vector<std::vector<double>> joint_angles =
+            get_joint_angles(channels_num);
+        std::ofstream session(m_filename);
+        for (size_t i = 0; i < g_session_lines; i++)
+        {
+            for (double angle : joint_angles.at(i % g_frames_num))
+            {
+                session << angle * 180.0 / M_PI << ",";
+            }
+            session << i << "," << i << "\n";
+        }
+    }
+
+    ~GeneratedSession() { std::filesystem::remove(m_filename); }
+
+    /// Get the name of the session file.
+    const std::string& get_filename(void) const { return m_filename; }
+
+private:
+    /// Name of the session file.
+    std::string m_filename;
+};
+
+/// Get the generated session (written on the first call).
+static const GeneratedSession& get_session(size_t channels_num)
+{
+    static GeneratedSession session(channels_num);
+    return session;
+}
+
+/// Conversion of a generated session into binary trajectories (the argument
+/// is the number of workers, see TrajectoryBatch::). The trajectories are a
+/// temporary file. The conversion is checked by kinematics_test.
+static void BM_TrajectoryBatchProcess(benchmark::State& state)
+{
+    AnimatedHand anim_hand;
+    anim_hand.initialize();
+
+    const std::string& session_filename =
+        get_session(anim_hand.get_channels_num()).get_filename();
+    std::string output_filename = (std::filesystem::temp_directory_path() /
+        "kinematics_bench_trajectories.bin").string();
+
+    TrajectoryBatch::Parameters parameters;
+    parameters.format = TrajectoryBatch::Format::Binary;
+    parameters.threads_num = state.range(0);
+    TrajectoryBatch batch;
+    batch.initialize(parameters);
+
+    for (auto _ : state)
+    {
+        batch.process(session_filename, output_filename);
+    }
+    state.SetItemsProcessed(state.iterations() * g_session_lines);
+    state.SetBytesProcessed(state.iterations() *
+        std::filesystem::file_size(session_filename));
+
+    std::filesystem::remove(output_filename);
+}
+BENCHMARK(BM_TrajectoryBatchProcess)->ArgName("threads")->Arg(1)->Arg(4)
+    ->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/*********************** Allocations of a frame ************************/
+/// Scripted pose sequence: number of frames (3 minutes at 30 frames per
+/// second) and sample rate of the glove (Hz).
+static constexpr size_t g_script_frames_num = 5400;
+static constexpr double g_script_frame_rate = 30.0;
+static constexpr double g_script_sample_rate = 1000.0;
+
+/// Write the glove line of a sample of the scripted pose sequence: every
+/// channel sweeps +-40 deg at its own frequency, followed by the device tick
+/// (ms) and the sequence counter. It returns the length of the line.
+static int get_script_line(size_t sample, size_t channels_num, char* line,
+    size_t size)
+{
+    double time = sample / g_script_sample_rate;
+    int length = 0;
+    for (size_t i = 0; i < channels_num; i++)
+    {
+        length += snprintf(line + length, size - length, "%.2f,", 40.0 *
+            sin(2.0 * M_PI * (0.2 + 0.05 * i) * time + i));
+    }
+    length += snprintf(line + length, size - length, "%llu,%llu\r\n",
+        (unsigned long long) std::llround(1e3 * time),
+        (unsigned long long) sample);
+    return length;
+}
+
+/// Heap allocations of the frames of the animation over a scripted pose
+/// sequence of 3 minutes (one iteration per frame). A pseudo terminal plays
+/// the glove at 1 kHz and an Exoskeleton:: reads it on its acquisition
+/// thread. Each frame hands the new samples over through the frame arena
+/// (see Exoskeleton::get_joint_samples), maps them to hand poses, samples
+/// the pose history, updates the kinematics and the vertices of both hands
+/// and their contact queries, like KinematicAnimation::animation_loop
+/// without the viewer. The first second is not counted, since the arena
+/// and the containers grow to their largest size in it. The allocations of
+/// the acquisition thread are counted too.
+static void BM_FrameAllocations(benchmark::State& state)
+{
+    // Hands, pose history, capsules and frame arena
+    AnimatedHand anim_hand;
+    anim_hand.initialize();
+    HandKinematics left_hand, right_hand;
+    left_hand.initialize(0, Eigen::Vector3d(0.0, 0.2, 0.0));
+    right_hand.initialize(1, Eigen::Vector3d(0.0, -0.2, 0.0));
+    HandCollision left_collision, right_collision;
+    left_collision.initialize(left_hand, HandCollision::Parameters());
+    right_collision.initialize(right_hand, HandCollision::Parameters());
+    PoseHistory pose_history;
+    pose_history.initialize();
+    FrameArena arena;
+    AnimatedHand::HandAngles euler_id;
+    for (auto& euler : euler_id) { euler.setZero(); }
+
+    // Open pseudo terminal in raw mode
+    int master, slave;
+    char name[256];
+    openpty(&master, &slave, name, nullptr, nullptr);
+    struct termios tty;
+    tcgetattr(slave, &tty);
+    cfmakeraw(&tty);
+    tcsetattr(slave, TCSANOW, &tty);
+
+    // Write the lines of the samples up to a frame (the first lines are
+    // read by the initialization of the stream)
+    const size_t channels_num = anim_hand.get_channels_num();
+    const size_t warmup_lines = 3;
+    size_t sample = 0;
+    char line[512];
+    auto write_lines = [&](size_t frame) {
+        size_t end = warmup_lines + (size_t) (frame * g_script_sample_rate /
+            g_script_frame_rate);
+        for (; sample < end; sample++)
+        {
+            int length = get_script_line(sample, channels_num, line,
+                sizeof(line));
+            if (write(master, line, length) < 0) { return; }
+        } };
+
+    // Exoskeleton (acquisition thread at default scheduling)
+    write_lines(0);
+    Exoskeleton exoskeleton;
+    exoskeleton.initialize(name, 115200, channels_num,
+        anim_hand.get_filter_parameters(), ThreadScheduler::Parameters(),
+        anim_hand.get_sequence_bits());
+
+    // Frame of the animation
+    auto run_frame = [&](size_t frame) {
+        // Glove lines of the frame, wait for the acquisition thread
+        write_lines(frame + 1);
+        while (exoskeleton.get_stream_health().samples + warmup_lines <
+            sample)
+        {
+            std::this_thread::yield();
+        }
+
+        // Hand over samples and update hand poses
+        arena.reset();
+        Eigen::Map<Eigen::MatrixXd> samples =
+            exoskeleton.get_joint_samples(arena);
+        for (Eigen::Index i = 0; i < samples.cols(); i++)
+        {
+            anim_hand.get_hand_angles(
+                &samples(Exoskeleton::joint_angles_row, i), euler_id);
+            pose_history.push(samples(Exoskeleton::time_row, i), euler_id);
+        }
+        if (samples.cols() > 0)
+        {
+            pose_history.sample(samples(Exoskeleton::time_row,
+                samples.cols() - 1), euler_id);
+        }
+
+        // Kinematics, vertices and contact queries of the hands
+        left_hand.update(euler_id);
+        right_hand.update(euler_id);
+        left_collision.update(left_hand);
+        right_collision.update(right_hand);
+        benchmark::DoNotOptimize(left_collision.get_finger_distance(0, 1));
+        benchmark::DoNotOptimize(right_collision.get_finger_distance(0, 1));
+        benchmark::DoNotOptimize(left_collision.get_distance(
+            right_collision)); };
+
+    // First second (not counted)
+    size_t frame = 0;
+    for (; frame < g_script_frame_rate; frame++) { run_frame(frame); }
+
+    size_t allocations_num = g_allocations_num.load();
+    for (auto _ : state) { run_frame(frame++); }
+    allocations_num = g_allocations_num.load() - allocations_num;
+
+    exoskeleton.stop();
+    close(slave);
+    close(master);
+
+    state.counters["allocations_per_frame"] = (double) allocations_num /
+        state.iterations();
+    state.counters["arena_bytes"] = arena.get_high_water_mark();
+    state.counters["arena_allocations"] = arena.get_allocation_num();
+    state.counters["samples"] = exoskeleton.get_stream_health().samples;
+}
+BENCHMARK(BM_FrameAllocations)->Iterations(g_script_frames_num)
+    ->Unit(benchmark::kMicrosecond);
+
+/**
+ * @brief Runs the benchmarks. The results are also written as json to
+ * kinematics_bench.json, unless an output file is given
+ * (--benchmark_out), so they can be compared across releases (e.g. with
+ * tools/compare.py of Google Benchmark).
+ */
+int main(int argc, char** argv)
+{
+    // Write json results by default
+    std::vector<char*> args(argv, argv + argc);
+    std::string out_arg = "--benchmark_out=kinematics_bench.json";
+    std::string format_arg = "--benchmark_out_format=json";
+    bool has_out = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]).rfind("--benchmark_out=", 0) == 0)
+        {
+            has_out = true;
+        }
+    }
+    if (!has_out)
+    {
+        args.push_back(out_arg.data());
+        args.push_back(format_arg.data());
+    }
+    int args_num = args.size();
+
+    // Initialize benchmarks
+    benchmark::Initialize(&args_num, args.data());
+    if (benchmark::ReportUnrecognizedArguments(args_num, args.data()))
+    {
+        return 1;
+    }
+
+    // Build options
+#ifdef HAND_FLOAT_VERTICES
+    benchmark::AddCustomContext("hand_float_vertices", "ON");
+#else
+    benchmark::AddCustomContext("hand_float_vertices", "OFF");
+#endif
+
+    // Run benchmarks
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    return 0;
+}
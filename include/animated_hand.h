@@ -1,9 +1,17 @@
-#pragma once 
+#pragma once
 
 #include <iostream>
 #include <vector>
+#include <array>
 #include <map>
+#include <utility>
+#include <stdexcept>
+#include <filesystem>
+#include <fstream>
 #include "euler_rotations.h"
+#include "one_euro_filter.h"
+
+#include "./nlohmann/json.hpp"
 
 
 class AnimatedHand
@@ -26,17 +34,44 @@ public:
         // Rotation direction (1: positive, -1:negative)
         double rot_dir;
     };
-    
-public:
-    
-    // Generate hand angles
-    std::vector<Eigen::Vector3d>
-        get_hand_angles(const std::vector<double>& joint_angles);
 
+    /// Mapping of a single glove channel to a hand frame axis. The frame
+    /// angle is given as \f$ sign \cdot scale \cdot \theta + offset \f$.
+    struct ChannelMap
+    {
+        // Sensor channel index
+        int index;
 
-private:
+        // Frames name/id
+        int frame_id;
+
+        // Rotation axis (roll=0, pitch=1, yaw=2)
+        int axis;
+
+        // Rotation direction (1: positive, -1:negative)
+        double sign;
+
+        // Angle offset (rad)
+        double offset;
+
+        // Angle scale
+        double scale;
+    };
+
+    /// Number of hand frames.
+    static constexpr size_t frames_num = 9;
+
+    /// Number of sensor channels of the default glove.
+    static constexpr size_t channels_num = 13;
+
+    /// Fixed size container of the euler angles of the hand frames.
+    using HandAngles = std::array<Eigen::Vector3d, frames_num>;
 
-    std::vector<HandMap> m_hand_map {
+    /// Axes (roll, pitch, yaw) of the hand frames.
+    using HandAxes = std::array<std::array<bool, 3>, frames_num>;
+
+    /// Default glove topology. Channel i drives the hand map entry i.
+    static constexpr std::array<HandMap, channels_num> default_hand_map {{
         HandMap{0, 3, 2, 1},
         HandMap{0, 3, 1, 1},
         HandMap{1, 4, 1, 1},
@@ -50,11 +85,117 @@ private:
         HandMap{6, 0, 2, 1},
         HandMap{7, 1, 1, 1},
         HandMap{8, 2, 1, 1},
+    }};
+
+public:
+
+    /// Load the glove channel map (falls back to the default topology).
+    void initialize(const std::string& config_rel_path=m_config_rel_path);
+
+    // Generate hand angles
+    std::vector<Eigen::Vector3d>
+        get_hand_angles(const std::vector<double>& joint_angles);
+
+    /// Generate hand angles into a fixed size container.
+    void get_hand_angles(const std::vector<double>& joint_angles,
+        HandAngles& euler_arr);
+
+    /// Generate hand angles into a fixed size container (one joint angle 
+    /// per channel, see get_channels_num).
+    void get_hand_angles(const double* joint_angles, HandAngles& euler_arr);
+
+    /// Generate the joint angles of the glove channels from hand angles.
+    void get_joint_angles(const HandAngles& euler_arr,
+        std::vector<double>& joint_angles);
+
+    /// Get the axes of the hand frames driven by the glove channels.
+    HandAxes get_driven_axes(void);
+
+    /// Get the direction of the axis driven by each glove channel (see
+    /// JointCalibration::load_parameters).
+    std::vector<double> get_channel_signs(void);
+
+    /// Set a custom hand map (gloves with a different sensor layout).
+    void set_hand_map(const std::vector<HandMap>& hand_map);
+
+    /// Set a custom channel map (gloves with a different sensor layout).
+    void set_channel_map(const std::vector<ChannelMap>& channel_map);
+
+    /// Get the number of sensor channels of the glove.
+    size_t get_channels_num(void) { return m_channels_num; }
+
+    /// Get the filter parameters of the glove channels (see OneEuroFilter::).
+    std::vector<OneEuroFilter::Parameters> get_filter_parameters(void);
+
+    /// Get the width of the sequence counter of the glove (bits, see
+    /// StreamHealth::add_sequence).
+    unsigned int get_sequence_bits(void) { return m_sequence_bits; }
+
+private:
+
+    /// Relative name of the glove configuration file. The "Revision" entry
+    /// selects the section whose "Channels" array describes the channel map.
+    static inline const std::string m_config_rel_path = "share/glove_config.json";
+
+    /// Parses the glove configuration json file.
+    std::vector<ChannelMap> parse_json_file(const nlohmann::json& json_file);
+
+    /// Scatter the joint angles of the default topology.
+    template <size_t... I>
+    static void scatter_default(const double* joint_angles,
+        HandAngles& euler_arr, std::index_sequence<I...>);
+
+private:
+
+    /// Precompiled scatter entry (runtime path).
+    struct ScatterEntry
+    {
+        // Sensor channel index
+        int channel;
+
+        // Frames name/id
+        int frame_id;
+
+        // Rotation axis
+        int axis;
+
+        // Angle gain (sign * scale)
+        double gain;
+
+        // Angle offset (rad)
+        double offset;
     };
 
-    // Number of hand frames
-    int m_hand_frames_num = 9;
+    /// Scatter table (runtime path).
+    std::vector<ScatterEntry> m_scatter_table;
+
+    /// Number of sensor channels.
+    size_t m_channels_num = channels_num;
+
+    /// Whether a custom channel map has been set.
+    bool m_custom_map = false;
 
-    // Hand index iterator
-    std::vector<int> m_hand_idx_iter = {3, 4, 5, 6, 7, 8, 0, 1, 2};
+    /// Filter parameters of the channels (indexed by channel, the channels 
+    /// without "MinCutoff" in the configuration file are not filtered).
+    std::vector<OneEuroFilter::Parameters> m_filter_parameters;
+
+    /// Width of the sequence counter of the glove ("SequenceBits" entry of
+    /// the revision, 64 if it is not given).
+    unsigned int m_sequence_bits = 64;
 };
+
+/**
+ * @brief Scatters the joint angles to the euler angles of the hand frames
+ * based on the default glove topology (#default_hand_map). Since the map is
+ * known at compile time the fold expression expands to straight-line code.
+ * @tparam I The channel indices.
+ * @param joint_angles Pointer to the joint angles (at least #channels_num).
+ * @param euler_arr The output euler angles.
+ */
+template <size_t... I>
+void AnimatedHand::scatter_default(const double* joint_angles,
+    HandAngles& euler_arr, std::index_sequence<I...>)
+{
+    ((euler_arr[default_hand_map[I].frame_id](default_hand_map[I].rot_type) =
+        default_hand_map[I].rot_dir * joint_angles[I]), ...);
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <math.h>
+
+/// Class ClockSync
+/**
+ * This class keeps the timing statistics of the serial stream and, if the
+ * firmware stamps each line with a device tick, maps device time to host time.
+ * The host arrival time of a line is its send time plus a transport and
+ * scheduling delay that is never negative, so the mapping is a linear fit of
+ * host time against device ticks (least squares over a sliding window) that
+ * is shifted down to the lower envelope of the arrivals. The slope of the fit
+ * gives the drift of the device clock, the spread of the arrivals around the
+ * fit the host-side jitter, and the spread of the device tick intervals the
+ * device-side jitter.
+ *
+ * The fit and the statistics are updated on every arrival from running sums
+ * of the window (the new arrival is added and the evicted one subtracted),
+ * so an arrival costs O(1) instead of a pass over the window. The sums are
+ * taken relative to an arrival of the window and are recomputed from
+ * scratch once per window length (#rebase), which bounds the rounding
+ * errors. The lower envelope is a vertex of the lower convex hull of the
+ * ticked arrivals, which is kept in two parts so that it is never rebuilt
+ * between rebases: the arrivals of the last rebase are pushed from the
+ * newest one, so the oldest arrival is evicted by undoing its push, and the
+ * newer arrivals are pushed from the oldest one. The range of the intervals
+ * is only scanned again when an evicted interval was on its boundary.
+*/
+class ClockSync
+{
+public:
+    /// Timing statistics of the stream (over the sliding window).
+    struct Statistics
+    {
+        // Number of arrivals in the window
+        size_t samples = 0;
+
+        // Inter-arrival interval on the host (mean, std, min, max, s)
+        double interval_mean = 0.0, interval_std = 0.0;
+        double interval_min = 0.0, interval_max = 0.0;
+
+        // Standard deviation of the device tick intervals (s)
+        double device_interval_std = 0.0;
+
+        // Standard deviation of the host arrivals around the fit (s)
+        double residual_std = 0.0;
+
+        // Drift of the device clock with respect to the host clock (ppm,
+        // positive if the device clock runs fast)
+        double drift_ppm = 0.0;
+
+        // Whether the device time is mapped to host time
+        bool is_synchronized = false;
+    };
+
+    /// Empty constructor.
+    ClockSync() {};
+
+    /// Initialize.
+    void initialize(double tick_period=1e-3, size_t window=2048);
+
+    /// Add an arrival without device tick.
+    double add_arrival(double host_time);
+
+    /// Add an arrival with device tick and get its mapped host time.
+    double add_arrival(double host_time, double device_tick);
+
+    /// Map a device tick to host time.
+    double map(double device_tick);
+
+    /// Get the timing statistics.
+    const Statistics& get_statistics(void) { return m_statistics; }
+
+private:
+    /// Update the fit and the statistics.
+    void update(void);
+
+    /// Recompute the running sums of the window.
+    void rebase(void);
+
+    /// Add (sign 1) or subtract (sign -1) the arrival i to the running sums.
+    void add_point(size_t i, double sign);
+
+    /// Add (sign 1) or subtract (sign -1) the interval between the arrivals
+    /// i - 1 and i to the running sums.
+    void add_interval(size_t i, double sign);
+
+    /// Scan the window for the range of the intervals.
+    void scan_intervals(void);
+
+    /// Get the cross product of the ticked arrivals b - a and c - a (ring
+    /// indices, positive if they turn counterclockwise).
+    double cross(size_t a, size_t b, size_t c);
+
+    /// Get the host time minus the fitted send time of a ticked arrival
+    /// (ring index, relative to the references of the running sums).
+    double get_envelope(size_t i, double slope) { return (m_host.at(i) -
+        m_sum_host_ref) - slope * (m_ticks.at(i) - m_sum_tick_ref); }
+
+    /// Get the vertex of a lower hull with the lowest envelope.
+    size_t get_envelope_vertex(const std::vector<size_t>& hull, size_t size,
+        double slope);
+
+    /// Get the arrival i of the window (0 is the oldest one).
+    size_t idx(size_t i) { return (m_head + m_host.size() - m_size + i) %
+        m_host.size(); }
+
+    /// Nominal tick period of the device (s).
+    double m_tick_period = 1e-3;
+
+    /// Host arrival times (ring buffer).
+    std::vector<double> m_host = std::vector<double>(256);
+
+    /// Device ticks (ring buffer, NaN for arrivals without tick).
+    std::vector<double> m_ticks = std::vector<double>(256);
+
+    /// Index of the next arrival in the ring buffers.
+    size_t m_head = 0;
+
+    /// Number of arrivals in the ring buffers.
+    size_t m_size = 0;
+
+    /// Fit: host time = m_host_ref + m_slope * (tick - m_tick_ref).
+    double m_slope = 0.0, m_host_ref = 0.0, m_tick_ref = 0.0;
+
+    /// References of the running sums (host time and device tick, NaN
+    /// until the window has a ticked arrival).
+    double m_sum_host_ref = 0.0, m_sum_tick_ref = NAN;
+
+    /// Running sums of the host intervals and of the device intervals.
+    double m_interval_sum = 0.0, m_interval_sum_sq = 0.0;
+    double m_device_sum = 0.0, m_device_sum_sq = 0.0;
+    size_t m_device_intervals = 0;
+
+    /// Running sums of the ticked arrivals (x: tick, y: host time).
+    double m_sx = 0.0, m_sy = 0.0, m_sxx = 0.0, m_sxy = 0.0, m_syy = 0.0;
+    size_t m_ticked = 0;
+
+    /// Arrivals until the running sums are recomputed.
+    size_t m_rebase_countdown = 0;
+
+    /// Whether the range of the intervals must be scanned again.
+    bool m_is_interval_range_stale = true;
+
+    /// Lower convex hulls of the ticked arrivals (ring indices) since the
+    /// last rebase (front, from the newest arrival) and after it (back,
+    /// from the oldest arrival).
+    std::vector<size_t> m_front_hull, m_back_hull;
+    size_t m_front_size = 0, m_back_size = 0;
+
+    /// Position of each push into the front hull and the vertex that it
+    /// overwrote.
+    std::vector<size_t> m_front_undo_position, m_front_undo_vertex;
+    size_t m_front_pushes = 0;
+
+    /// Minimum number of ticked arrivals for the mapping.
+    static constexpr size_t m_min_fit_samples = 8;
+
+    /// Timing statistics.
+    Statistics m_statistics;
+};
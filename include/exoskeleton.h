@@ -4,9 +4,18 @@
 #include <vector>
 #include <map>
 #include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
 
 #include "utils.h"
 #include "serial_com.h"
+#include "one_euro_filter.h"
+#include "clock_sync.h"
+#include "thread_scheduler.h"
+#include "stream_health.h"
+#include "joint_calibration.h"
+#include "frame_arena.h"
 
 /// Class Exoskeleton
 /**
@@ -14,39 +23,181 @@
  * Its goal is to provide a callback function that reads asychronously 
  * the serial data from the SerialCOM:: class and translates it to 
  * joint angle values. It then sends the data to the animation loop and to the 
- * rendering engine
+ * rendering engine. The callback runs on a single acquisition thread for the 
+ * whole stream, which publishes the samples into a single producer, single 
+ * consumer ring buffer, so the animation loop collects them without locking 
+ * or waiting for the serial port.
 */
 class Exoskeleton
 {
 
 public:
+    /// Timestamped sample of the joint angles.
+    struct JointSample
+    {
+        // Sample time (s, see Utils::monotonic_time). If the firmware sends 
+        // a device tick it is the device time mapped to the host clock 
+        // (see ClockSync::), otherwise the arrival time
+        double time;
+
+        // Arrival time of the line (s)
+        double arrival_time;
+
+        // Joint angles (rad)
+        std::vector<double> joint_angles;
+    };
+
     /// Empty constructor.
     Exoskeleton() {};
 
+    /// Destructor (stops the acquisition thread).
+    ~Exoskeleton() { stop(); }
+
     /// Initialize.
-    void initialize(const std::string& serial_com, unsigned int serial_baudrate);
+    void initialize(const std::string& serial_com, unsigned int serial_baudrate,
+        int meas_num=13, const std::vector<OneEuroFilter::Parameters>&
+        filter_parameters={}, const ThreadScheduler::Parameters&
+        acquisition_parameters={}, unsigned int sequence_bits=64);
+
+    /// Read incoming data (acquisition thread, until it is stopped).
+    void incoming_data_callback(void);
 
-    /// Read incoming data.
-    std::vector<double> incoming_data_callback(void);
+    /// Stop the acquisition thread and wait for it.
+    void stop(void);
 
     /// Get joint angles.
     std::vector<double> get_joint_angles(void);
 
+    /// Rows of the handed over samples (see get_joint_samples): the sample 
+    /// time, the arrival time and the first joint angle.
+    static constexpr Eigen::Index time_row = 0, arrival_time_row = 1,
+        joint_angles_row = 2;
+
+    /// Get the timestamped samples received since the previous call (one 
+    /// column per sample, a view into the frame arena).
+    Eigen::Map<Eigen::MatrixXd> get_joint_samples(FrameArena& arena);
+
+    /// Get the timing statistics of the stream (updated on every hand over 
+    /// of the samples, see get_joint_samples).
+    const ClockSync::Statistics& get_timing_statistics(void) {
+        return m_timing_statistics; }
+
+    /// Get the health counters of the stream (can be called at any time).
+    StreamHealth::Statistics get_stream_health(void);
+
+    /// Get the scheduling status of the acquisition thread (updated on 
+    /// every hand over of the samples, see get_joint_samples).
+    const ThreadScheduler::Status& get_scheduling_status(void) {
+        return m_scheduling_status; }
+
+    /// Set the calibration of the channels (installed by the acquisition 
+    /// thread before its next sample, the stream keeps running).
+    void set_calibration(const JointCalibration& calibration);
+
 private:
-    /// Measurements num.
-    const int m_meas_num = 13;
+    /// Sample of the ring buffer and the timing statistics of the stream 
+    /// at its arrival.
+    struct PendingSample
+    {
+        JointSample sample;
+        ClockSync::Statistics timing;
+    };
+
+    /// Measurements num (number of glove channels).
+    int m_meas_num = 13;
 
-    /// Sensors data vector (raw)
+    /// Latest joint angles handed over (deg, UI thread).
     std::vector<double> m_raw_sensor_data;
 
-private:
+    /// Filter of the sensor data (runs on the acquisition thread).
+    OneEuroFilter m_filter;
+
+    /// Calibration of the sensor data (runs on the acquisition thread).
+    JointCalibration m_calibration;
+
+    /// Calibration handed to the acquisition thread, which swaps it with 
+    /// #m_calibration before its next sample.
+    JointCalibration m_next_calibration;
+
+    /// Whether #m_next_calibration is waiting to be installed (set by the 
+    /// UI thread, cleared by the acquisition thread).
+    std::atomic<bool> m_calibration_pending{false};
+
+    /// Calibration set while the previous one was still pending (UI thread, 
+    /// handed over on the next call of get_joint_samples).
+    JointCalibration m_queued_calibration;
+
+    /// Whether a calibration is queued.
+    bool m_calibration_queued = 0;
+
+    /// Time of the previous sample (s).
+    double m_prev_sample_time = 0.0;
+
+    /// Buffer of the received line and of its values (acquisition thread).
+    std::string m_line;
+    std::vector<double> m_line_data;
+
+    /// Health counters of the stream.
+    StreamHealth m_stream_health;
+
+    /// UART overrun counters when the port was opened.
+    int m_overrun_baseline = 0, m_buffer_overrun_baseline = 0;
+
+    /// Clock synchronization of the stream (acquisition thread).
+    ClockSync m_clock_sync;
+
+    /// Timing statistics (copy handed over with the samples).
+    ClockSync::Statistics m_timing_statistics;
+
+    /// Scheduling parameters of the acquisition thread.
+    ThreadScheduler::Parameters m_acquisition_parameters;
+
+    /// Scheduling status of the acquisition thread (written by the 
+    /// acquisition thread before it publishes #m_is_running).
+    ThreadScheduler::Status m_acquisition_status;
+
+    /// Scheduling status (copy handed over with the samples).
+    ThreadScheduler::Status m_scheduling_status;
+
+    /// Ring buffer of the samples that have not been handed over yet 
+    /// (preallocated at initialization). The acquisition thread writes the 
+    /// slot of #m_pending_head and then advances it, the UI thread reads the 
+    /// slots from #m_pending_tail and then advances it, so each index has a 
+    /// single writer. If the ring is full the new sample is dropped.
+    std::vector<PendingSample> m_pending_samples;
+
+    /// Number of samples published and handed over since initialization 
+    /// (the slot of a sample is its number modulo the ring size).
+    std::atomic<size_t> m_pending_head{0}, m_pending_tail{0};
+
+    /// Maximum number of pending samples.
+    size_t m_max_pending_samples = 64;
+
+    /// Hand over the pending samples up to the given head (UI thread), 
+    /// calling a function for each of them.
+    template <typename Function>
+    void take_pending_samples(size_t head, Function function);
+
+    /// Hand over the queued calibration if the previous one is installed.
+    void hand_over_calibration(void);
+
+    /// Install the pending calibration (acquisition thread).
+    void install_calibration(void);
 
     /// Serial communication handler.
     std::shared_ptr<SerialCOM> m_serial;
 
-    /// Future function handle.
-    std::future<std::vector<double>> m_future_fun;
+    /// Acquisition thread.
+    std::thread m_acquisition_thread;
+
+    /// Whether the acquisition thread is running (set once its scheduling 
+    /// parameters are applied).
+    std::atomic<bool> m_is_running{false};
+
+    /// Termination flag of the acquisition thread.
+    std::atomic<bool> m_is_stopped{false};
 
-    /// Termination flag for callback function.
-    bool m_return_value = 0;
+    /// Time the acquisition thread waits for a line before it checks the 
+    /// termination flag (ms).
+    static constexpr int m_poll_timeout = 100;
 };
\ No newline at end of file
@@ -4,10 +4,13 @@
 #include <vector>
 #include <filesystem>
 #include <fstream>
+#include <algorithm>
+#include <memory>
 
-#include <igl/opengl/glfw/Viewer.h>
+#include <igl/read_triangle_mesh.h>
 #include "dynamics_math.h"
 #include "euler_rotations.h"
+#include "mesh_cache.h"
 
 #include "./nlohmann/json.hpp"
 
@@ -20,26 +23,82 @@
 class Finger
 {
 public:
+    /// Block of the geometric Jacobian of the fingertip for one link: the
+    /// linear (rows 0-2) and angular (rows 3-5) velocity of the fingertip
+    /// per rate of the euler angles (phi, theta, psi) of the link.
+    using JacobianBlock = Eigen::Matrix<double, 6, 3>;
+
     Finger() {};
 
     /// Initialize finger.
     void initialize(const std::string& name_id, const nlohmann::json& json_file, 
-        igl::opengl::glfw::Viewer *viewer, int mesh_idx);
+        bool load_meshes=true,
+        const Eigen::Affine3d& root_transform=Eigen::Affine3d::Identity());
 
-    /// Update state.
+    /// Update state and vertices (reference of the skinning of the hand,
+    /// see HandKinematics::update_vertices, which the animation uses).
     void update(const std::vector<dm::JointState>& state);
 
-    /// Get finger vertices.
-    std::vector<Eigen::MatrixXd> get_vertices(void) { return m_vertices_data; }
+    /// Update state (forward kinematics only).
+    void update_kinematics(const std::vector<dm::JointState>& state);
+
+    /// Get finger vertices (libigl layout, Nx3).
+    const std::vector<Eigen::MatrixXd>& get_vertices(void) { return m_vertices_data; }
+
+    /// Set the root transform of the finger chain.
+    void set_root_transform(const Eigen::Affine3d& root_transform) {
+        m_root_transform = root_transform; }
 
     /// Get the ids of the finger frames.
-    std::vector<int> get_frame_ids(void) { return m_frame_ids; };
+    const std::vector<int>& get_frame_ids(void) { return m_frame_ids; };
 
-    /// Load finger mesh files.
-    void load_mesh_files(igl::opengl::glfw::Viewer *viewer);
+    /// Load finger mesh files (scaled, see #postprocess_meshes).
+    void load_mesh_files(void);
 
     /// Get current state  of the finger.
-    std::vector<dm::JointState> get_state(void) { return m_state_vec; }
+    const std::vector<dm::JointState>& get_state(void) { return m_state_vec; }
+
+    /// Get the global transforms of the finger links.
+    const std::vector<Eigen::Matrix4d>& get_global_transforms(void) {
+        return m_global_transform; }
+
+    /// Get the lengths of the finger links.
+    const std::vector<double>& get_link_lengths(void) { return m_link_lengths; }
+
+    /// Get the position of the fingertip (end of the distal link).
+    Eigen::Vector3d get_tip_position(void);
+
+    /// Get the geometric Jacobian of the fingertip (one block per link).
+    const std::vector<JacobianBlock>& get_jacobian(void) { return m_jacobian; }
+
+    /// Get the number of meshes of the finger (a joint and a bone mesh per
+    /// link, zero if the meshes are not loaded).
+    size_t get_meshes_num(void) { return m_meshes.size(); }
+
+    /// Get the scaled rest-pose vertices of a finger mesh (3xN, mapped from
+    /// the mesh cache).
+    Eigen::Map<const MeshCache::VerticesMatrix> get_rest_vertices(
+        size_t idx) const {
+        const MeshView& mesh = m_meshes.at(idx);
+        return Eigen::Map<const MeshCache::VerticesMatrix>(mesh.vertices, 3,
+            mesh.vertices_num); }
+
+    /// Get the faces of a finger mesh (Fx3, mapped from the mesh cache).
+    Eigen::Map<const MeshCache::FacesMatrix> get_faces(size_t idx) const {
+        const MeshView& mesh = m_meshes.at(idx);
+        return Eigen::Map<const MeshCache::FacesMatrix>(mesh.faces,
+            mesh.faces_num, 3); }
+
+    /// Get the scales of the finger meshes.
+    const std::vector<double>& get_geom_scales(void) { return m_geom_scales; }
+
+    /// Get the relative filename of the joint mesh.
+    static const std::string& get_joint_filename(void) {
+        return m_joint_rel_filename; }
+
+    /// Get the relative filename of the bone (link) mesh.
+    static const std::string& get_bone_filename(void) {
+        return m_bone_rel_filename; }
 
 private: 
 
@@ -49,6 +108,11 @@ private:
     /// Finger origin.
     dm::JointState m_origin;
 
+    /// Root transform of the finger chain. It places the hand's base frame
+    /// \f$ f_{{W}_{0}}\f$ with respect to the inertial frame (including the
+    /// mirroring of the right hand).
+    Eigen::Affine3d m_root_transform = Eigen::Affine3d::Identity();
+
     /// The lengths of the finger links.
     std::vector<double> m_link_lengths;
 
@@ -61,10 +125,10 @@ private:
 private:
 
     /// Joint mesh file.
-    std::string m_joint_rel_filename = "share/joint.obj";
+    static inline const std::string m_joint_rel_filename = "share/joint.obj";
 
     /// Bone (link) mesh file.
-    std::string m_bone_rel_filename = "share/bone.obj";
+    static inline const std::string m_bone_rel_filename = "share/bone.obj";
 
     /// Mesh files for joints and bones(links).
     std::vector<std::string> m_meshes_filenames;
@@ -78,29 +142,50 @@ private:
     /// Finger scales.
     std::vector<double> m_geom_scales;
 
-    /// Viewer data lower idx see (Hand::m_viewer_data_lower_idx).
-    int m_viewer_data_lower_idx;
-
-    /// Viewer data upper idx (see Hand::m_viewer_data_lower_idx).
-    int m_viewer_data_upper_idx;
-
 private:
 
-    /// Get mesh data.
-    void get_mesh_data(igl::opengl::glfw::Viewer *viewer);
-
-    /// Vertices data (original).
-    std::vector<Eigen::MatrixXd> m_vertices_data_o;
-
-    /// Vertices data (original homogeneous).
-    std::vector<Eigen::MatrixXd> m_vertices_data_oh;
-
-    /// Vertices data.
+    /// Relative directory of the mesh cache files (one per finger).
+    static inline const std::string m_cache_rel_dir = "share/cache";
+
+    /// Load the meshes from the mesh cache.
+    bool load_mesh_cache(void);
+
+    /// Get the key of the mesh cache.
+    uint64_t get_mesh_cache_key(void);
+
+    /// Use the meshes read from the mesh files (if the mesh cache can not
+    /// be written).
+    void map_mesh_files(void);
+
+    /// Rest-pose mesh (scaled): its vertices (3xN, column-wise so that they
+    /// can be transformed in a single pass) and faces, in the mapped mesh
+    /// cache or in the meshes read from the files.
+    struct MeshView
+    {
+        const MeshCache::VertexScalar* vertices;
+        const int* faces;
+        Eigen::Index vertices_num, faces_num;
+    };
+
+    /// Rest-pose meshes (one per mesh file).
+    std::vector<MeshView> m_meshes;
+
+    /// Mapped mesh cache of the rest-pose meshes (shared by the copies of
+    /// the finger).
+    std::shared_ptr<MeshCache> m_mesh_cache;
+
+    /// Meshes read from the mesh files: vertices (scaled rest pose) and
+    /// faces. They are only kept if the mesh cache can not be written.
+    struct MeshFiles
+    {
+        std::vector<MeshCache::VerticesMatrix> vertices;
+        std::vector<MeshCache::FacesMatrix> faces;
+    };
+    std::shared_ptr<MeshFiles> m_mesh_files;
+
+    /// Vertices data (libigl layout, Nx3).
     std::vector<Eigen::MatrixXd> m_vertices_data;
 
-    /// Faces data.
-    std::vector<Eigen::MatrixXi> m_faces_data;
-
     /// Postproccess meshes.
     void postprocess_meshes(void);
 
@@ -121,4 +206,10 @@ private:
 
     /// Global transforamation matrix.
     std::vector<Eigen::Matrix4d> m_global_transform;
+
+    /// Update the Jacobian of the fingertip (after the global transforms).
+    void update_jacobian(void);
+
+    /// Geometric Jacobian of the fingertip (one block per link).
+    std::vector<JacobianBlock> m_jacobian;
 };
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <eigen3/Eigen/Dense>
+
+/// Class FrameArena
+/**
+ * This class implements a bump allocator for the temporary matrices that
+ * are generated on every frame of the animation, e.g. the glove samples
+ * handed over by the acquisition thread (see Exoskeleton::get_joint_samples),
+ * whose number changes from frame to frame. Memory is handed out as
+ * Eigen::Map views into a single contiguous block and is released all at
+ * once when the arena is reset (at the beginning of every frame, see
+ * KinematicAnimation::animation_loop). If a frame requests more memory than
+ * the block holds, the excess is served from overflow blocks and the main
+ * block grows to the high-water mark on the next reset. After the first
+ * frames the arena therefore serves every request without allocating.
+*/
+class FrameArena
+{
+public:
+    /// Empty constructor.
+    FrameArena() {};
+
+    /// Reserve arena capacity (number of doubles).
+    void reserve(size_t size);
+
+    /// Release all the memory handed out during the previous frame.
+    void reset(void);
+
+    /// Allocate a matrix view of the given size.
+    Eigen::Map<Eigen::MatrixXd> matrix(Eigen::Index rows, Eigen::Index cols);
+
+    /// Get the high-water mark in bytes.
+    size_t get_high_water_mark(void) {
+        return m_high_water_mark * sizeof(double); }
+
+    /// Get the capacity in bytes.
+    size_t get_capacity(void) { return m_buffer.size() * sizeof(double); }
+
+    /// Get the number of times the arena had to grow.
+    size_t get_growth_num(void) { return m_growth_num; }
+
+    /// Get the number of heap allocations (overflow blocks and growths).
+    size_t get_allocation_num(void) { return m_allocation_num; }
+
+private:
+    /// Allocate a contiguous block of doubles.
+    double* allocate(size_t size);
+
+    /// Alignment of every allocation (number of doubles).
+    static constexpr size_t m_alignment = 4;
+
+    /// Main memory block.
+    std::vector<double> m_buffer;
+
+    /// Overflow blocks of the current frame.
+    std::vector<std::unique_ptr<double[]>> m_overflow;
+
+    /// Current offset (number of doubles) including overflow allocations.
+    size_t m_offset = 0;
+
+    /// High-water mark (number of doubles).
+    size_t m_high_water_mark = 0;
+
+    /// Number of growths of the main block.
+    size_t m_growth_num = 0;
+
+    /// Number of heap allocations.
+    size_t m_allocation_num = 0;
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+
+/// Class FrameEncoder
+/**
+ * This class writes rendered frames to PNG files (see igl::png::writePNG) on
+ * a pool of encoder threads, so the compression of a frame overlaps the
+ * rendering of the next ones. The frames are taken from a fixed set of
+ * buffers: the renderer acquires a free frame, reads the pixels into it and
+ * submits it, and an encoder releases it once the file is written. The
+ * renderer only waits if all the frames are queued, i.e. if the encoders
+ * cannot keep up, which bounds the memory (see Statistics::wait_time).
+*/
+class FrameEncoder
+{
+public:
+    /// Frame to encode.
+    struct Frame
+    {
+        // RGBA pixels, bottom row first (as read by glReadPixels)
+        std::vector<unsigned char> pixels;
+
+        // Size of the frame (pixels)
+        int width = 0, height = 0;
+
+        // Output file
+        std::string filename;
+    };
+
+    /// Encoding statistics.
+    struct Statistics
+    {
+        // Encoded frames and frames that could not be written
+        uint64_t frames = 0, failed = 0;
+
+        // Encoding time (s, summed over the encoders) and time the renderer
+        // waited for a free frame (s)
+        double encode_time = 0.0, wait_time = 0.0;
+    };
+
+    /// Empty constructor.
+    FrameEncoder() {};
+
+    /// Destructor (waits for the queued frames).
+    ~FrameEncoder() { finish(); }
+
+    /// Start the encoders.
+    void initialize(size_t encoders_num, size_t frames_num, int width,
+        int height);
+
+    /// Acquire a free frame (waits if all the frames are queued).
+    Frame& acquire(void);
+
+    /// Submit an acquired frame to the encoders.
+    void submit(Frame& frame);
+
+    /// Wait for the queued frames and stop the encoders.
+    void finish(void);
+
+    /// Get the statistics of the encoders.
+    const Statistics& get_statistics(void) { return m_statistics; }
+
+private:
+    /// Run an encoder.
+    void run_encoder(void);
+
+    /// Frame buffers.
+    std::vector<Frame> m_frames;
+
+    /// Free frames and frames waiting for an encoder.
+    std::vector<Frame*> m_free_frames;
+    std::deque<Frame*> m_queued_frames;
+
+    /// Encoder threads.
+    std::vector<std::thread> m_encoders;
+
+    /// Whether the encoders must stop once the queue is empty.
+    bool m_stop = false;
+
+    /// Encoding statistics.
+    Statistics m_statistics;
+
+    /// Synchronization of the renderer and the encoders.
+    std::mutex m_mutex;
+    std::condition_variable m_frame_queued, m_frame_free;
+};
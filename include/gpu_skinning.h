@@ -0,0 +1,51 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <eigen3/Eigen/Dense>
+
+#include <igl/opengl/glfw/Viewer.h>
+
+/// Class GpuSkinning
+/**
+ * This class moves the rigid skinning of the hand meshes to the GPU. The
+ * scaled rest-pose meshes are uploaded to the viewer once, and on every frame
+ * only the global transform of the link that each mesh is attached to is sent
+ * as a uniform (4x4 matrix) of the mesh's shader program. The shader programs
+ * are the ones of libigl's MeshGL with the link transform applied to the
+ * vertex positions and normals. Since each libigl viewer data owns its own
+ * shader program, the uniforms persist until the mesh is drawn.
+*/
+class GpuSkinning
+{
+public:
+    /// Empty constructor.
+    GpuSkinning() {};
+
+    /// Initialize for a range of viewer data.
+    void initialize(int viewer_data_lower_idx, int data_list_size);
+
+    /// Send the link transforms (one per mesh) to the shaders.
+    void update(igl::opengl::glfw::Viewer& viewer,
+        const std::vector<Eigen::Matrix4f>& transforms);
+
+private:
+    /// Replace the shader program of a viewer data with the skinning one.
+    void setup_shader(igl::opengl::ViewerData& data, size_t idx);
+
+    /// Viewer data lower idx (see Hand::m_viewer_data_lower_idx).
+    int m_viewer_data_lower_idx;
+
+    /// Shader programs (one per mesh).
+    std::vector<GLuint> m_programs;
+
+    /// Location of the link transform uniform (one per mesh).
+    std::vector<GLint> m_transform_locations;
+
+    /// Skinning vertex shader.
+    static const std::string m_vertex_shader;
+
+    /// Mesh fragment shader (same as libigl's MeshGL).
+    static const std::string m_fragment_shader;
+};
@@ -1,123 +1,112 @@
-#pragma once 
+#pragma once
 
 #include <iostream>
 #include <vector>
-#include <filesystem>
-#include <fstream>
 #include <eigen3/Eigen/Dense>
 
-#include "./nlohmann/json.hpp"
 #include <igl/opengl/glfw/Viewer.h>
 
-#include "dynamics_math.h"
-#include "exoskeleton.h"
 #include "animated_hand.h"
-#include "finger.h"
+#include "hand_kinematics.h"
+#include "gpu_skinning.h"
+#include "instanced_mesh.h"
 
 /// Class Hand
 /**
- * This class defines the hand stucture. It calls the finger class (see Finger::)
- * to compose the three fingers and develop the full kinematic model of
- * the hand.
+ * This class is the viewer adapter of the hand. The kinematic model of the
+ * hand (configuration, forward kinematics and vertex generation) is
+ * computed by HandKinematics::, and this class adds the hand meshes to the
+ * viewer and sends them the result of every update, according to the render
+ * mode.
 */
 class Hand
 {
 public:
+    /// Scalar type of the hand vertices (see HandKinematics::VertexScalar).
+    using VertexScalar = HandKinematics::VertexScalar;
+
+    /// Render modes of the hand meshes: skinned on the CPU (see
+    /// SkinningKernel::), skinned on the GPU (see GpuSkinning::) or drawn
+    /// as instances of a single joint and bone mesh (see InstancedMesh::).
+    enum class RenderMode { CPU = 0, GPU = 1, Instanced = 2 };
+
     /// Empty constructor.
     Hand(){};
 
     /// Initialize the hand.
-    void initialize(igl::opengl::glfw::Viewer* viewer,
-        Exoskeleton* exo_handler, AnimatedHand* anim_hand,
-        bool type, const Eigen::Vector3d& origin);
+    void initialize(igl::opengl::glfw::Viewer* viewer, bool type,
+        const Eigen::Vector3d& origin, RenderMode render_mode=RenderMode::CPU,
+        InstancedMesh* joint_mesh=nullptr, InstancedMesh* bone_mesh=nullptr);
 
     // Update the hand.
-    void update(const std::vector<Eigen::Vector3d>& euler_id, 
+    void update(const AnimatedHand::HandAngles& euler_id,
         igl::opengl::glfw::Viewer& viewer);
 
+    /// Add the instances of the hand meshes at a level of detail.
+    void add_instances(size_t lod=0);
+
+    /// Get the bounding sphere of the hand.
+    void get_bounding_sphere(Eigen::Vector3d& center, double& radius) {
+        m_kinematics.get_bounding_sphere(center, radius); }
+
+    /// Get the number of links of the hand.
+    size_t get_links_num(void) { return m_kinematics.get_links_num(); }
+
+    /// Get the kinematic model of the hand.
+    HandKinematics& get_kinematics(void) { return m_kinematics; }
+
 private:
-    /// Relative name of hand's configuration file. This is a json file
-    /// that contains the 
-    /// geometric characteristics of each finger (link lengths of the finger,
-    /// ordered as [proximal, middle, distal]), the position and orientation 
-    /// of the finger's frame with respect to the local hand frame
-    /// \f$ T_{f_{O_{i}}}^{f_{W_{0}}} \f$ with \f$ i = 0, 3, 6 \f$ and 
-    /// the finger's frame names as illustrated in the figure below.
-    /// \image html animated_hand_kinematic_model.png width=600px
-    std::string m_config_rel_path = "share/hand_config.json";
+    /// Kinematic model of the hand.
+    HandKinematics m_kinematics;
 
-    /// Absolute name of hand's configuration file.
-    std::filesystem::path m_config_abs_path;
+    /// Render mode of the meshes.
+    RenderMode m_render_mode = RenderMode::CPU;
 
-    /// Hand configuration.
-    std::vector<std::string> m_hand_config = {"Thumb", "Index", "Middle"};
+    /// Add the hand meshes to the viewer.
+    void add_meshes(igl::opengl::glfw::Viewer* viewer);
 
-    /// Vector of finger handles.
-    std::vector<Finger> m_fingers;
+    /// Initialize the GPU skinning.
+    void initialize_gpu_skinning(void);
 
-    /// The total rotation matrix of the hand \f$ T_{f_{W_{0}}}^{F} \f$, with
-    /// respect to the  inertial frame of reference \f$ F \f$.
-    Eigen::Matrix3d m_hand_rot;
+    /// Send the skinned vertices of a mesh to its viewer data and its
+    /// vertex buffer.
+    void upload_vertices(igl::opengl::ViewerData& data,
+        const HandKinematics::VertexMatrix& vertices, size_t idx);
 
-    /// Hand origin with respect to the inertial frame of reference \f$ F \f$.
-    Eigen::Vector3d m_hand_origin;
+    /// Replace the vertex buffer of a viewer data with the hand one.
+    void setup_vertex_buffer(igl::opengl::MeshGL& meshgl, size_t idx);
 
-private:
+    /// Vertex buffers of the meshes (CPU skinning, one per mesh).
+    std::vector<GLuint> m_vertex_buffers;
+
+#ifndef HAND_FLOAT_VERTICES
+    /// Single precision vertices of the mesh being uploaded (sized for the
+    /// largest mesh of the hand, see upload_vertices).
+    Eigen::Matrix<float, Eigen::Dynamic, 3, Eigen::RowMajor> m_upload_buffer;
+#endif
 
-    /// Concatenates vertex or face data to a std vector.
-    template <typename T>
-    std::vector<T> concatenate_data(const std::vector<std::vector<T>>& data);
-
-    /// Vertex data container.
-    std::vector<Eigen::MatrixXd> m_vertex_data;
-
-    /// Concatenated hand vertex data.
-    Eigen::MatrixXd m_concatenated_hand_vertex_data;
-    
-    /// Viewer data lower and upper idx. The viewer object of libigl stores 
-    /// the vertex data into a container. This includes ALL the bodies that 
-    /// are rendered on the screen. For setting the vertices when they 
-    /// are updated it is important to know where the vertices for each object 
-    /// are located inside this container. These two variables define the 
-    /// lower and upper index for these specific instance of the hand. 
+    /// GPU skinning handle.
+    GpuSkinning m_gpu_skinner;
+
+    /// Link transform of each mesh (GPU skinning).
+    std::vector<Eigen::Matrix4f> m_mesh_transforms;
+
+    /// Instanced joint and bone meshes (shared by all the hands).
+    InstancedMesh *m_joint_mesh = nullptr, *m_bone_mesh = nullptr;
+
+    /// Viewer data lower and upper idx. The viewer object of libigl stores
+    /// the vertex data into a container. This includes ALL the bodies that
+    /// are rendered on the screen. For setting the vertices when they
+    /// are updated it is important to know where the vertices for each object
+    /// are located inside this container. These two variables define the
+    /// lower and upper index for these specific instance of the hand.
     /// This way when we set the data for this hand to the
     /// viewer.data_list we know what vertices to update.
     /// For more info on how libigl handles multiple meshes at
     /// https://github.com/libigl/libigl/blob/main/tutorial/107_MultipleMeshes/main.cpp.
-    int m_viewer_data_lower_idx, m_viewer_data_upper_idx;
+    int m_viewer_data_lower_idx = 0, m_viewer_data_upper_idx = 0;
 
-    /// The total size of the vertices of this instance of the hand on the 
+    /// The total size of the vertices of this instance of the hand on the
     /// data_list container.
-    int m_data_list_size;    
-
-    /// This function offset a set of vertices by a given offset.
-    Eigen::MatrixXd translation_matrix(const Eigen::Vector3d& offset, size_t vert_num);
+    int m_data_list_size = 0;
 };
-
-/**
- * @brief This function is used to concatenate Eigen matrices. More specifically 
- * each link of the finger is imported as an Eigen::Matrix. The total finger 
- * is then a vector of Eigen matrices. The whole hand is a vector of 
- * fingers or a vector of a vector of links. This function takes this vector 
- * of vectors of links and converts to a vector of fingers.
- * @tparam T The type of Eigen::Matrix to concatenate (MatrixXd, MatrixXi etc). 
- * @param data The vector of vectors of matrices.
- * @return std::vector<T> The vector of matrices.
- */
-template <typename T>
-std::vector<T> Hand::concatenate_data(const std::vector<std::vector<T>>& data)
-{
-    // Vertex data concatenated
-    std::vector<T> data_conc;
-
-    // Concatenate data to a single vector
-    for (auto data_j : data)
-    {
-        for (size_t i = 0; i < data_j.size(); i++)
-        {
-            data_conc.push_back(data_j.at(i));
-        }
-    }
-
-    return data_conc;
-}
\ No newline at end of file
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <eigen3/Eigen/Dense>
+#include <eigen3/Eigen/Geometry>
+
+#include "finger.h"
+#include "hand_kinematics.h"
+
+/// Class HandCollision
+/**
+ * This class represents every phalanx of a hand as a capsule (the segment
+ * of the link, from its joint to the next one or to the fingertip, see
+ * Finger::get_link_lengths, swept by a sphere) and answers minimum distance
+ * and contact queries between the fingers of the hand (self-collision) and
+ * between two hands, e.g. to detect when the thumb and index tips touch.
+ *
+ * The capsules are kept in a tiny bounding volume hierarchy of fixed
+ * topology: the box of the hand, the boxes of its fingers and the boxes of
+ * the capsules. Only the boxes are refitted on every frame (see #update), so
+ * there is no rebuild, and the queries skip the fingers and capsules whose
+ * boxes are farther than the current best distance or than the contact
+ * margin. The update and the queries of a frame take a few microseconds,
+ * so they can run at the sample rate of the glove. The capsules are given
+ * in the inertial frame (as the global transforms of the fingers).
+*/
+class HandCollision
+{
+public:
+    /// Capsule parameters.
+    struct Parameters
+    {
+        // Radius of the phalanx capsules (m)
+        double radius = 0.008;
+
+        // Contact margin (m): two capsules are in contact if the distance
+        // between their surfaces is below it
+        double contact_margin = 0.0;
+    };
+
+    /// Capsule of a phalanx (inertial frame).
+    struct Capsule
+    {
+        // Finger and link of the phalanx
+        size_t finger = 0, link = 0;
+
+        // End points of the segment (joint and next joint or fingertip)
+        Eigen::Vector3d start = Eigen::Vector3d::Zero();
+        Eigen::Vector3d end = Eigen::Vector3d::Zero();
+
+        // Radius (m)
+        double radius = 0.0;
+    };
+
+    /// Closest pair of capsules.
+    struct Contact
+    {
+        // Capsules of the pair (index in #get_capsules of each hand)
+        size_t capsule_a = 0, capsule_b = 0;
+
+        // Distance between the surfaces (m, negative if they intersect)
+        double distance = std::numeric_limits<double>::infinity();
+
+        // Closest points of the segments of the capsules
+        Eigen::Vector3d point_a = Eigen::Vector3d::Zero();
+        Eigen::Vector3d point_b = Eigen::Vector3d::Zero();
+    };
+
+    /// Empty constructor.
+    HandCollision() {};
+
+    /// Initialize.
+    void initialize(HandKinematics& hand, const Parameters& parameters);
+
+    /// Update the capsules and refit the hierarchy.
+    void update(HandKinematics& hand);
+
+    /// Get the capsules (fingers in the order of HandKinematics::get_fingers,
+    /// links from the base of the finger).
+    const std::vector<Capsule>& get_capsules(void) const { return m_capsules; }
+
+    /// Get the minimum distance between two fingers of the hand.
+    Contact get_finger_distance(size_t finger_a, size_t finger_b) const;
+
+    /// Get the contacts between the fingers of the hand.
+    void get_self_contacts(std::vector<Contact>& contacts) const;
+
+    /// Get the minimum distance to another hand.
+    Contact get_distance(const HandCollision& other) const;
+
+    /// Get the contacts with another hand.
+    void get_contacts(const HandCollision& other,
+        std::vector<Contact>& contacts) const;
+
+    /// Get the squared distance between two segments and their closest
+    /// points.
+    static double segment_distance_sq(const Eigen::Vector3d& start_a,
+        const Eigen::Vector3d& end_a, const Eigen::Vector3d& start_b,
+        const Eigen::Vector3d& end_b, Eigen::Vector3d& point_a,
+        Eigen::Vector3d& point_b);
+
+private:
+    /// Axis aligned bounding box.
+    using Box = Eigen::AlignedBox3d;
+
+    /// Get the distance between the capsules of two fingers (pairs whose
+    /// boxes are farther than the bound are skipped).
+    static void finger_distance(const HandCollision& hand_a, size_t finger_a,
+        const HandCollision& hand_b, size_t finger_b, Contact& contact);
+
+    /// Add the contacts between the capsules of two fingers.
+    static void finger_contacts(const HandCollision& hand_a, size_t finger_a,
+        const HandCollision& hand_b, size_t finger_b, double margin,
+        std::vector<Contact>& contacts);
+
+    /// Get the distance between two capsules.
+    static void capsule_distance(const Capsule& capsule_a,
+        const Capsule& capsule_b, Contact& contact);
+
+    /// Capsule parameters.
+    Parameters m_parameters;
+
+    /// Capsules of the phalanges.
+    std::vector<Capsule> m_capsules;
+
+    /// First capsule of each finger (and end of the last one).
+    std::vector<size_t> m_finger_offsets;
+
+    /// Boxes of the capsules, of the fingers and of the hand (hierarchy).
+    std::vector<Box> m_capsule_boxes, m_finger_boxes;
+    Box m_hand_box;
+};
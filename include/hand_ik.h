@@ -0,0 +1,152 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <utility>
+#include <stdint.h>
+#include <eigen3/Eigen/Dense>
+
+#include "utils.h"
+#include "dynamics_math.h"
+#include "animated_hand.h"
+#include "finger.h"
+#include "hand_kinematics.h"
+
+/// Class HandIK
+/**
+ * This class solves the hand angles that place the fingertips at target
+ * positions (inverse kinematics), e.g. to drive the animated hand from
+ * motion capture instead of the glove. Each finger chain is solved
+ * independently with damped least squares on the position of its fingertip
+ * (see Finger::get_jacobian). Only the axes of the hand frames that the
+ * glove drives are solved (see AnimatedHand::get_driven_axes), so the
+ * solution is a pose that the glove mapping can produce. The targets are
+ * given with respect to the base frame of the hand \f$ f_{{W}_{0}} \f$ (as
+ * the trajectories of TrajectoryBatch::).
+ *
+ * The solver is warm-started from the solution of the previous frame, which
+ * is close to the next one for a trajectory. A trajectory can be solved in
+ * parallel: it is split in contiguous ranges, one per thread, and each range
+ * is solved in order, the first frame of a range starting from the rest
+ * pose.
+*/
+class HandIK
+{
+public:
+    /// Solver parameters.
+    struct Parameters
+    {
+        // Hand (left: 0, right: 1)
+        bool type = 0;
+
+        // Maximum number of iterations per finger
+        size_t max_iterations = 100;
+
+        // Fingertip position tolerance (m)
+        double tolerance = 1e-5;
+
+        // Damping factor (m)
+        double damping = 1e-3;
+
+        // Maximum step of the joint angles per iteration (rad, norm)
+        double max_step = 0.2;
+
+        // Number of threads of the batch mode (0: one per core)
+        size_t threads_num = 0;
+    };
+
+    /// Convergence statistics.
+    struct Statistics
+    {
+        // Solved finger targets and converged ones
+        uint64_t targets = 0, converged = 0;
+
+        // Iterations (total and maximum per target)
+        uint64_t iterations = 0, max_iterations = 0;
+
+        // Residual fingertip error (sum and maximum, m)
+        double error_sum = 0.0, max_error = 0.0;
+
+        // Solve time (s, summed over the threads)
+        double solve_time = 0.0;
+    };
+
+    /// Empty constructor.
+    HandIK() {};
+
+    /// Initialize.
+    void initialize(AnimatedHand& anim_hand, const Parameters& parameters);
+
+    /// Get the number of threads of the batch mode.
+    size_t get_threads_num(void) { return m_solvers.size(); }
+
+    /// Get the number of fingers (targets per frame).
+    size_t get_fingers_num(void) { return m_finger_dofs.size(); }
+
+    /// Solve a frame (warm-started from the previous frame).
+    bool solve(const std::vector<Eigen::Vector3d>& targets,
+        AnimatedHand::HandAngles& euler_arr);
+
+    /// Solve a trajectory in parallel.
+    void solve_batch(const std::vector<Eigen::Vector3d>& targets,
+        std::vector<AnimatedHand::HandAngles>& euler_arr);
+
+    /// Reset the warm start to the rest pose.
+    void reset(void);
+
+    /// Get the convergence statistics.
+    const Statistics& get_statistics(void) { return m_statistics; }
+
+    /// Reset the convergence statistics.
+    void reset_statistics(void) { m_statistics = Statistics(); }
+
+private:
+    /// State of a solver (one per thread).
+    struct Solver
+    {
+        // Hand model (kinematics only)
+        HandKinematics hand;
+
+        // Joint state of a finger
+        std::vector<dm::JointState> state;
+
+        // Solution of the previous frame (warm start)
+        AnimatedHand::HandAngles euler_arr;
+
+        // Position Jacobian of the solved axes and joint angle step
+        Eigen::Matrix<double, 3, Eigen::Dynamic> jacobian;
+        Eigen::VectorXd step;
+
+        // Statistics of the solver
+        Statistics statistics;
+    };
+
+    /// Solve a frame with a solver.
+    bool solve_frame(Solver& solver, const Eigen::Vector3d* targets,
+        AnimatedHand::HandAngles& euler_arr);
+
+    /// Solve the target of a finger.
+    bool solve_finger(Solver& solver, size_t finger_idx,
+        const Eigen::Vector3d& target, AnimatedHand::HandAngles& euler_arr);
+
+    /// Update the kinematics of a finger from hand angles.
+    void update_finger(Solver& solver, size_t finger_idx,
+        const AnimatedHand::HandAngles& euler_arr);
+
+    /// Add the statistics of a solver.
+    void add_statistics(const Statistics& statistics);
+
+    /// Solver parameters.
+    Parameters m_parameters;
+
+    /// Solved axes of each finger (link and axis).
+    std::vector<std::vector<std::pair<size_t, int>>> m_finger_dofs;
+
+    /// Solvers (the first one solves the single frames).
+    std::vector<Solver> m_solvers;
+
+    /// Convergence statistics.
+    Statistics m_statistics;
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <filesystem>
+#include <fstream>
+#include <eigen3/Eigen/Dense>
+
+#include "./nlohmann/json.hpp"
+
+#include "dynamics_math.h"
+#include "animated_hand.h"
+#include "finger.h"
+#include "skinning_kernel.h"
+
+/// Class HandKinematics
+/**
+ * This class is the GUI-free core of the hand (hand_kinematics library). It
+ * reads the hand configuration file, composes the three fingers (see
+ * Finger::), performs the forward kinematics of the hand from the euler
+ * angles of its frames (see AnimatedHand::) and generates the vertices of
+ * its meshes with the skinning kernel (see SkinningKernel::). It has no
+ * viewer dependency, so headless tools can link it without OpenGL; the
+ * viewer glue is in Hand::.
+*/
+class HandKinematics
+{
+public:
+    /// Scalar type of the hand vertices. The kinematics are always computed
+    /// in double precision, while the vertices can be skinned in single
+    /// precision (HAND_FLOAT_VERTICES build option, the scalar of the mesh
+    /// cache, see MeshCache::).
+    using VertexScalar = MeshCache::VertexScalar;
+
+    /// Vertex matrix type (Nx3 row-major, the layout of the vertex buffers).
+    using VertexMatrix = Eigen::Matrix<VertexScalar, Eigen::Dynamic, 3,
+        Eigen::RowMajor>;
+
+    /// Vertex streams type (Nx3 column-major, see SkinningKernel::).
+    using StreamMatrix = Eigen::Matrix<VertexScalar, Eigen::Dynamic, 3>;
+
+    /// Fingertip twist (linear and angular velocity) or wrench (force and
+    /// moment), with respect to the inertial frame.
+    using Twist = Eigen::Matrix<double, 6, 1>;
+    using Wrench = Eigen::Matrix<double, 6, 1>;
+
+    /// Empty constructor.
+    HandKinematics(){};
+
+    /// Initialize the hand.
+    void initialize(bool type, const Eigen::Vector3d& origin,
+        bool load_meshes=true, bool skin_vertices=true);
+
+    /// Update the forward kinematics and the vertices of the hand.
+    void update(const AnimatedHand::HandAngles& euler_id);
+
+    /// Update the forward kinematics of the hand.
+    void update_kinematics(const AnimatedHand::HandAngles& euler_id);
+
+    /// Update the vertices of the hand (after update_kinematics).
+    void update_vertices(void);
+
+    /// Get the fingers.
+    std::vector<Finger>& get_fingers(void) { return m_fingers; }
+
+    /// Get the names of the fingers (in the order of #get_fingers).
+    const std::vector<std::string>& get_finger_names(void) {
+        return m_hand_config; }
+
+    /// Get the vertex data of the hand meshes (Nx3 row-major, one
+    /// matrix per mesh, in finger order).
+    const std::vector<VertexMatrix>& get_vertex_data(void) {
+        return m_vertex_data; }
+
+    /// Get the number of meshes of the hand.
+    size_t get_meshes_num(void);
+
+    /// Get the number of links of the hand.
+    size_t get_links_num(void);
+
+    /// Get the bounding sphere of the hand.
+    void get_bounding_sphere(Eigen::Vector3d& center, double& radius);
+
+    /// Get the fingertip twists from the rates of the hand angles (after
+    /// update_kinematics).
+    void get_tip_twists(const AnimatedHand::HandAngles& euler_rates,
+        std::vector<Twist>& twists);
+
+    /// Get the generalized forces of the hand angles from fingertip wrenches
+    /// (after update_kinematics).
+    void get_joint_torques(const std::vector<Wrench>& wrenches,
+        AnimatedHand::HandAngles& torques);
+
+private:
+    /// Relative name of hand's configuration file. This is a json file
+    /// that contains the
+    /// geometric characteristics of each finger (link lengths of the finger,
+    /// ordered as [proximal, middle, distal]), the position and orientation
+    /// of the finger's frame with respect to the local hand frame
+    /// \f$ T_{f_{O_{i}}}^{f_{W_{0}}} \f$ with \f$ i = 0, 3, 6 \f$ and
+    /// the finger's frame names as illustrated in the figure below.
+    /// \image html animated_hand_kinematic_model.png width=600px
+    std::string m_config_rel_path = "share/hand_config.json";
+
+    /// Absolute name of hand's configuration file.
+    std::filesystem::path m_config_abs_path;
+
+    /// Hand configuration.
+    std::vector<std::string> m_hand_config = {"Thumb", "Index", "Middle"};
+
+    /// Vector of finger handles.
+    std::vector<Finger> m_fingers;
+
+    /// The total rotation matrix of the hand \f$ T_{f_{W_{0}}}^{F} \f$, with
+    /// respect to the  inertial frame of reference \f$ F \f$.
+    Eigen::Matrix3d m_hand_rot;
+
+    /// Hand origin with respect to the inertial frame of reference \f$ F \f$.
+    Eigen::Vector3d m_hand_origin;
+
+private:
+
+    /// Finger state containers.
+    std::vector<std::vector<dm::JointState>> m_state_data;
+
+    /// Initialize the skinning buffers.
+    void initialize_skinning(void);
+
+    /// Rest-pose vertices of the whole hand, stored as SoA streams in a
+    /// single contiguous buffer (see SkinningKernel::).
+    StreamMatrix m_rest_vertices;
+
+    /// Skinning segments (one per mesh).
+    std::vector<SkinningKernel::Segment<VertexScalar>> m_segments;
+
+    /// Global transforms of the hand links.
+    std::vector<SkinningKernel::RigidTransform<VertexScalar>> m_link_transforms;
+
+    /// Vertex data container (Nx3 row-major). The skinning segments write
+    /// directly to its rows.
+    std::vector<VertexMatrix> m_vertex_data;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <iostream>
+#include <functional>
+
+#include <igl/opengl/glfw/Viewer.h>
+#include <igl/opengl/glfw/ViewerPlugin.h>
+
+/// Class InstancePlugin
+/**
+ * This viewer plugin draws the instanced meshes of the hands (see
+ * KinematicAnimation::draw_instances) between the viewer data and the menu.
+ * The viewer of libigl draws the data of every core, then calls the
+ * post_draw of the plugins in the order of Viewer::plugins (the ImGui plugin
+ * renders the menu there), and only then its post-draw callback, so the
+ * instances cannot be drawn from that callback without covering the menu.
+ * The plugin must therefore be added to the viewer before the ImGui plugin
+ * (see main.cpp).
+*/
+class InstancePlugin : public igl::opengl::glfw::ViewerPlugin
+{
+public:
+    /// Constructor.
+    InstancePlugin() { plugin_name = "instances"; };
+
+    /// Draw the instances (after the viewer data, before the next plugins).
+    bool post_draw() override {
+        if (callback_draw) { callback_draw(*viewer); } return false; }
+
+    /// Draw callback of the instances.
+    std::function<bool(igl::opengl::glfw::Viewer&)> callback_draw;
+};
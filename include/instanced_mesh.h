@@ -0,0 +1,108 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <eigen3/Eigen/Dense>
+
+#include <igl/opengl/glfw/Viewer.h>
+
+/// Class InstancedMesh
+/**
+ * This class draws many copies (instances) of a single mesh with one
+ * instanced draw call per level of detail. The mesh is loaded once and
+ * decimated to a number of coarser levels of detail (LOD), and on every frame
+ * only the transform of each instance (4x4 matrix, including its scale) is
+ * sent to the GPU. It is used for the joint spheres and the bone cylinders of
+ * the hands, which are all copies of share/joint.obj and share/bone.obj (see
+ * Hand::RenderMode). The instances are drawn after the viewer data (see
+ * InstancePlugin::) with the camera and light of the viewer core.
+*/
+class InstancedMesh
+{
+public:
+    /// Empty constructor.
+    InstancedMesh() {};
+
+    /// Load the mesh file and generate its levels of detail.
+    void initialize(const std::string& filename, size_t lod_num=1,
+        const Eigen::Vector4f& color=Eigen::Vector4f(1.0, 0.85, 0.3, 1.0));
+
+    /// Clear the instances (start of a frame).
+    void clear_instances(void);
+
+    /// Add an instance to a level of detail.
+    void add_instance(const Eigen::Matrix4f& transform, size_t lod=0) {
+        m_levels.at(lod).instances.push_back(transform); }
+
+    /// Get the number of levels of detail.
+    size_t get_lod_num(void) { return m_levels.size(); }
+
+    /// Get the number of faces of a level of detail.
+    size_t get_faces_num(size_t lod) { return m_levels.at(lod).faces.rows(); }
+
+    /// Draw all the instances.
+    void draw(igl::opengl::ViewerCore& core);
+
+    /// Check whether the mesh has been loaded.
+    bool is_initialized(void) { return m_is_initialized; }
+
+private:
+    /// Level of detail of the mesh.
+    struct Level
+    {
+        // Mesh vertices (Nx3, row-major, as uploaded to the GPU)
+        Eigen::Matrix<float, Eigen::Dynamic, 3, Eigen::RowMajor> vertices;
+
+        // Mesh vertex normals (Nx3, row-major)
+        Eigen::Matrix<float, Eigen::Dynamic, 3, Eigen::RowMajor> normals;
+
+        // Mesh faces (Fx3, row-major)
+        Eigen::Matrix<unsigned int, Eigen::Dynamic, 3, Eigen::RowMajor> faces;
+
+        // Instance transforms of the current frame
+        std::vector<Eigen::Matrix4f> instances;
+
+        // Vertex array object
+        GLuint vao = 0;
+
+        // Vertex, normal, face and instance buffers
+        GLuint vbo_vertices = 0, vbo_normals = 0, ebo_faces = 0,
+            vbo_instances = 0;
+
+        // Capacity of the instance buffer (number of instances)
+        size_t instances_capacity = 0;
+    };
+
+    /// Set the mesh of a level of detail.
+    void set_level(Level& level, const Eigen::MatrixXd& vertices,
+        const Eigen::MatrixXi& faces);
+
+    /// Generate the shader program.
+    void initialize_program(void);
+
+    /// Generate the OpenGL buffers of a level of detail.
+    void initialize_buffers(Level& level);
+
+    /// Whether the mesh has been loaded.
+    bool m_is_initialized = false;
+
+    /// Levels of detail (level 0 is the original mesh).
+    std::vector<Level> m_levels;
+
+    /// Mesh color.
+    Eigen::Vector4f m_color;
+
+    /// Shader program.
+    GLuint m_program = 0;
+
+    /// Attribute locations (the instance transform spans four locations).
+    static constexpr GLuint m_position_loc = 0, m_normal_loc = 1,
+        m_instance_loc = 2;
+
+    /// Instanced vertex shader.
+    static const std::string m_vertex_shader;
+
+    /// Fragment shader.
+    static const std::string m_fragment_shader;
+};
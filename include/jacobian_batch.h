@@ -0,0 +1,88 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <stdexcept>
+#include <eigen3/Eigen/Dense>
+
+#include "animated_hand.h"
+#include "finger.h"
+#include "hand_kinematics.h"
+
+/// Class JacobianBatch
+/**
+ * This class evaluates the fingertip Jacobians of the hand (see
+ * Finger::get_jacobian) over a logged trajectory of hand poses (e.g. the
+ * hand angles of a recorded session, see AnimatedHand::get_hand_angles),
+ * and maps joint velocities to fingertip twists and fingertip wrenches to
+ * joint torques along it (see HandKinematics::get_tip_twists and
+ * HandKinematics::get_joint_torques). The poses are split in contiguous
+ * ranges that are evaluated by a pool of threads, one hand model (without
+ * meshes) per thread. The hand is placed at the origin, so the results are
+ * given with respect to its base frame \f$ f_{{W}_{0}} \f$.
+*/
+class JacobianBatch
+{
+public:
+    /// Evaluation parameters.
+    struct Parameters
+    {
+        // Hand (left: 0, right: 1)
+        bool type = 0;
+
+        // Number of threads (0: one per core)
+        size_t threads_num = 0;
+    };
+
+    /// Empty constructor.
+    JacobianBatch() {};
+
+    /// Initialize.
+    void initialize(const Parameters& parameters);
+
+    /// Get the number of links of the hand (Jacobian blocks per pose).
+    size_t get_links_num(void) { return m_links_num; }
+
+    /// Get the number of fingers of the hand (twists and wrenches per pose).
+    size_t get_fingers_num(void) { return m_hand.get_fingers().size(); }
+
+    /// Evaluate the Jacobians over a trajectory.
+    void evaluate(const std::vector<AnimatedHand::HandAngles>& poses,
+        std::vector<Finger::JacobianBlock>& jacobians);
+
+    /// Get the fingertip twists over a trajectory.
+    void get_tip_twists(const std::vector<AnimatedHand::HandAngles>& poses,
+        const std::vector<AnimatedHand::HandAngles>& euler_rates,
+        std::vector<HandKinematics::Twist>& twists);
+
+    /// Get the joint torques over a trajectory.
+    void get_joint_torques(const std::vector<AnimatedHand::HandAngles>& poses,
+        const std::vector<HandKinematics::Wrench>& wrenches,
+        std::vector<AnimatedHand::HandAngles>& torques);
+
+    /// Get the rates of a uniformly sampled trajectory (finite differences).
+    static void get_rates(const std::vector<AnimatedHand::HandAngles>& poses,
+        double sample_time, std::vector<AnimatedHand::HandAngles>& euler_rates);
+
+private:
+    /// Run a function over the poses on the threads.
+    template <typename Function>
+    void run(size_t poses_num, Function function);
+
+    /// Evaluation parameters.
+    Parameters m_parameters;
+
+    /// Hand model (copied to every thread).
+    HandKinematics m_hand;
+
+    /// Hand models of the threads.
+    std::vector<HandKinematics> m_hands;
+
+    /// Number of links of the hand.
+    size_t m_links_num = 0;
+
+    /// Minimum number of poses of a thread.
+    static constexpr size_t m_min_poses_per_thread = 256;
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <limits>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <eigen3/Eigen/Dense>
+
+#include "./nlohmann/json.hpp"
+
+/// Class JointCalibration
+/**
+ * This class converts the raw readings of the glove potentiometers (deg) to
+ * joint angles (deg) for a number of channels at once. Each channel removes
+ * the offset of its reading, applies its gain, corrects the nonlinearity of
+ * the sensor with a polynomial and clamps the result to the anatomical
+ * limits of the joint:
+ * \f$ \theta = clamp(P(g (r - r_{0})), \theta_{min}, \theta_{max}) \f$.
+ * The coefficients are stored as arrays (one row per degree of the
+ * polynomial, one column per channel), so a sample of all the channels is
+ * calibrated with a few vectorised operations (Horner's scheme). It runs on
+ * the acquisition thread, before the filter (see Exoskeleton::), and on the
+ * samples of the recorded sessions (see TrajectoryBatch:: and
+ * SessionRender::). The inverse conversion writes joint angles as glove
+ * readings (see #invert).
+*/
+class JointCalibration
+{
+public:
+    /// Parameters of a channel.
+    struct Parameters
+    {
+        // Offset of the reading (deg)
+        double offset = 0.0;
+
+        // Gain
+        double gain = 1.0;
+
+        // Coefficients of the nonlinearity correction, from degree 0
+        std::vector<double> polynomial = {0.0, 1.0};
+
+        // Anatomical limits of the joint (deg)
+        double min = -std::numeric_limits<double>::infinity();
+        double max = std::numeric_limits<double>::infinity();
+    };
+
+    /// Empty constructor.
+    JointCalibration() {};
+
+    /// Initialize the calibration (one set of parameters per channel).
+    void initialize(const std::vector<Parameters>& parameters);
+
+    /// Load the parameters of the channels from the calibration file (one
+    /// sign per channel, see AnimatedHand::get_channel_signs).
+    static bool load_parameters(const std::vector<double>& signs,
+        std::vector<Parameters>& parameters,
+        const std::string& config_rel_path=m_config_rel_path);
+
+    /// Calibrate a sample of all the channels (in place).
+    void apply(double* sample);
+
+    /// Calibrate a sample of all the channels (in place).
+    void apply(std::vector<double>& sample) {
+        if (sample.size() == (size_t) m_offset.size()) {
+            apply(sample.data()); } }
+
+    /// Convert a sample of joint angles of all the channels to readings (in
+    /// place, inverse of #apply).
+    void invert(double* sample);
+
+    /// Convert a sample of joint angles of all the channels to readings (in
+    /// place, inverse of #apply).
+    void invert(std::vector<double>& sample) {
+        if (sample.size() == (size_t) m_offset.size()) {
+            invert(sample.data()); } }
+
+    /// Get the number of channels.
+    size_t get_channels_num(void) { return m_offset.size(); }
+
+private:
+    /// Relative name of the calibration file.
+    static inline const std::string m_config_rel_path =
+        "share/calibration_config.json";
+
+    /// Maximum number of Newton iterations of the polynomial inversion.
+    static constexpr int m_max_iterations = 50;
+
+    /// Tolerance of the polynomial inversion (deg).
+    static constexpr double m_tolerance = 1e-12;
+
+    /// Offsets of the channels.
+    Eigen::ArrayXd m_offset;
+
+    /// Gains of the channels.
+    Eigen::ArrayXd m_gain;
+
+    /// Polynomial coefficients (row k: coefficients of degree k).
+    Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+        m_coefficients;
+
+    /// Anatomical limits of the channels.
+    Eigen::ArrayXd m_min, m_max;
+
+    /// Calibrated values of the current sample (preallocated).
+    Eigen::ArrayXd m_value;
+};
@@ -1,12 +1,18 @@
 #pragma once 
 
 #include <iostream>
+#include <chrono>
 #include <igl/opengl/glfw/Viewer.h>
 
 #include "animated_hand.h"
 #include "exoskeleton.h"
 #include "menu_handler.h"
 #include "hand.h"
+#include "hand_collision.h"
+#include "lod_selector.h"
+#include "pose_history.h"
+#include "thread_scheduler.h"
+#include "frame_arena.h"
 
 /// Class KinematicAnimation
 /**
@@ -26,6 +32,9 @@ public:
     /// Animation loop callback.
     bool animation_loop(igl::opengl::glfw::Viewer & viewer);
 
+    /// Draw callback of the instanced meshes.
+    bool draw_instances(igl::opengl::glfw::Viewer & viewer);
+
 
 private:
 
@@ -38,9 +47,59 @@ private:
     /// Menu handler pointer.
     MenuHandler* m_menu_handler;
 
+    /// Euler angles of the hand frames.
+    AnimatedHand::HandAngles m_euler_id;
+
+    /// Timestamped history of the hand poses.
+    PoseHistory m_pose_history;
+
+    /// Display time offset with respect to the current time (s). Positive 
+    /// values predict ahead (extrapolation), negative values render in the 
+    /// past (interpolation between samples).
+    double m_display_offset = 0.0;
+
+    /// Update the hand pose at the display time.
+    void update_hand_angles(void);
+
+    /// Scheduling options of the acquisition and compute threads.
+    ThreadScheduler m_thread_scheduler;
+
+    /// Scheduling status of the compute (viewer) thread.
+    ThreadScheduler::Status m_compute_status;
+
     /// Left and right hand.
     Hand m_left_hand, m_right_hand;
 
+    /// Render mode of the hands.
+    Hand::RenderMode m_render_mode = Hand::RenderMode::CPU;
+
+    /// Instanced joint and bone meshes (shared by both hands).
+    InstancedMesh m_joint_mesh, m_bone_mesh;
+
+    /// Number of levels of detail of the instanced meshes.
+    size_t m_lod_num = 4;
+
+    /// Triangle budget of all the hands (instanced mode).
+    size_t m_triangle_budget = 100000;
+
+    /// Level of detail selector of the hands (instanced mode).
+    LodSelector m_lod_selector;
+
+    /// Projected sizes of the hands.
+    std::vector<double> m_hand_sizes;
+
+    /// Select the level of detail of the hands and add their instances.
+    void add_hand_instances(igl::opengl::glfw::Viewer& viewer);
+
+    /// Capsules of the left and right hands (contact queries).
+    HandCollision m_left_collision, m_right_collision;
+
+    /// Update the capsules of the hands and report their distances.
+    void update_contacts(void);
+
+    /// Load the calibration file and hand it to the exoskeleton.
+    void load_calibration(void);
+
     /// Left hand origin.
     Eigen::Vector3d m_left_origin = Eigen::Vector3d(0.0, 0.2, 0.0);
 
@@ -50,6 +109,15 @@ private:
     /// Bool start animation.
     bool m_initialize_animation = 1;
 
+    /// Start time of the setup of the hands (cold start measurement).
+    std::chrono::steady_clock::time_point m_setup_time;
+
+    /// Whether the cold start time has been measured.
+    bool m_cold_start_measured = 0;
+
+    /// Per-frame arena for temporary matrices (reset on every frame).
+    FrameArena m_frame_arena;
+
     /// Setup exoskeletons.
     void setup_exoskeletons(igl::opengl::glfw::Viewer& viewer);
 
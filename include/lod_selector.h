@@ -0,0 +1,63 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <eigen3/Eigen/Dense>
+
+#include <igl/opengl/glfw/Viewer.h>
+
+/// Class LodSelector
+/**
+ * This class selects the level of detail (LOD) of a number of objects (e.g.
+ * the hands) on every frame. The desired level of each object follows its
+ * projected size on the screen: level 0 for objects larger than
+ * #m_full_detail_size pixels, and one level coarser every time the size
+ * halves. A level only changes once the size has crossed the level boundary
+ * by a relative margin (#m_hysteresis), so that objects near a boundary do not
+ * pop between levels. Finally, if the selected levels exceed the global
+ * triangle budget, the smallest objects are coarsened first until the budget
+ * is met (or every object is at the coarsest level).
+*/
+class LodSelector
+{
+public:
+    /// Empty constructor.
+    LodSelector() {};
+
+    /// Initialize the selector.
+    void initialize(const std::vector<size_t>& lod_triangles,
+        size_t triangle_budget, double full_detail_size=200.0,
+        double hysteresis=0.15);
+
+    /// Select the level of each object from its projected size.
+    const std::vector<size_t>& select(const std::vector<double>& sizes);
+
+    /// Get the selected levels.
+    const std::vector<size_t>& get_levels(void) { return m_levels; }
+
+    /// Get the number of triangles of the selected levels.
+    size_t get_triangles_num(void);
+
+    /// Projected size (diameter in pixels) of a bounding sphere.
+    static double projected_size(const Eigen::Vector3d& center, double radius,
+        const igl::opengl::ViewerCore& core);
+
+private:
+    /// Level of detail of a projected size (without hysteresis).
+    size_t size_level(double size);
+
+    /// Number of triangles of an object at each level of detail.
+    std::vector<size_t> m_lod_triangles;
+
+    /// Global triangle budget.
+    size_t m_triangle_budget;
+
+    /// Projected size (pixels) above which the full detail is used.
+    double m_full_detail_size;
+
+    /// Relative margin of the level boundaries.
+    double m_hysteresis;
+
+    /// Selected level of each object.
+    std::vector<size_t> m_levels;
+};
@@ -14,6 +14,10 @@
 #include <igl/opengl/glfw/imgui/ImGuiMenu.h>
 #include <igl/opengl/glfw/imgui/ImGuiHelpers.h>
 
+#include "clock_sync.h"
+#include "thread_scheduler.h"
+#include "stream_health.h"
+
 /// Class MenuHandler
 /**
  * This class handles the animation menu.
@@ -37,6 +41,50 @@ public:
     /// Get the USB port for the right exoskeleton.
     std::string get_right_exoskeleton_port(void) { return m_right_exoskeleton_port; }
 
+    /// Get the render mode of the hand meshes (see Hand::RenderMode).
+    int get_render_mode(void) { return m_render_mode; }
+
+    /// Set the cold start time (from the setup of the hands to the first 
+    /// frame).
+    void set_cold_start_time(double time_ms) { m_cold_start_time = time_ms; }
+
+    /// Set the timing statistics of the glove stream.
+    void set_timing_statistics(const ClockSync::Statistics& statistics) {
+        m_timing_statistics = statistics; }
+
+    /// Set the health counters of the glove stream.
+    void set_stream_health(const StreamHealth::Statistics& health) {
+        m_stream_health = health; }
+
+    /// Set the scheduling status of the acquisition and compute threads.
+    void set_scheduling_status(const ThreadScheduler::Status& acquisition,
+        const ThreadScheduler::Status& compute, bool is_memory_locked) {
+        m_acquisition_status = acquisition; m_compute_status = compute;
+        m_memory_locked = is_memory_locked; }
+
+    /// Whether a reload of the calibration file has been requested (the 
+    /// request is cleared).
+    bool take_calibration_request(void) {
+        bool is_requested = m_calibration_requested;
+        m_calibration_requested = 0; return is_requested; }
+
+    /// Set whether the calibration file has been loaded.
+    void set_calibration_loaded(bool is_loaded) {
+        m_calibration_loaded = is_loaded; }
+
+    /// Set the high-water mark of the frame arena (bytes) and its number of 
+    /// heap allocations (see FrameArena::).
+    void set_frame_arena(size_t high_water_mark, size_t allocations_num) {
+        m_arena_high_water_mark = high_water_mark;
+        m_arena_allocations_num = allocations_num; }
+
+    /// Set the distances between the thumb and the index of each hand and
+    /// between the hands (m, negative if they intersect).
+    void set_contact_distances(double left_pinch, double right_pinch,
+        double hands) {
+        m_pinch_distances[0] = left_pinch; m_pinch_distances[1] = right_pinch;
+        m_hands_distance = hands; }
+
 private:
     /// ImGui menu handle pointer.
     igl::opengl::glfw::imgui::ImGuiMenu *m_menu;
@@ -54,4 +102,43 @@ private:
 
     /// Flag that stores the state of the USB port (whether are set or not).
     bool m_ports_set = 0;
+
+    /// Render mode of the hand meshes (CPU skinning, GPU skinning, instanced).
+    int m_render_mode = 0;
+
+    /// Cold start time (ms, negative if not measured yet).
+    double m_cold_start_time = -1.0;
+
+    /// Timing statistics of the glove stream.
+    ClockSync::Statistics m_timing_statistics;
+
+    /// Health counters of the glove stream.
+    StreamHealth::Statistics m_stream_health;
+
+    /// Scheduling status of the acquisition and compute threads.
+    ThreadScheduler::Status m_acquisition_status, m_compute_status;
+
+    /// Whether the process memory is locked.
+    bool m_memory_locked = 0;
+
+    /// Whether a reload of the calibration file has been requested.
+    bool m_calibration_requested = 0;
+
+    /// Whether the calibration file has been loaded.
+    bool m_calibration_loaded = 0;
+
+    /// High-water mark of the frame arena (bytes) and its number of heap 
+    /// allocations.
+    size_t m_arena_high_water_mark = 0, m_arena_allocations_num = 0;
+
+    /// Distances between the thumb and the index of the left and right
+    /// hands (m).
+    double m_pinch_distances[2] = {0.0, 0.0};
+
+    /// Distance between the hands (m).
+    double m_hands_distance = 0.0;
+
+    /// Names of the render modes.
+    std::vector<std::string> m_render_modes = {"CPU skinning", "GPU skinning",
+        "Instanced"};
 };
\ No newline at end of file
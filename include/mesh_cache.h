@@ -0,0 +1,142 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <filesystem>
+#include <fstream>
+#include <cstdint>
+#include <eigen3/Eigen/Dense>
+
+/// Class MeshCache
+/**
+ * This class implements a binary cache of the scaled rest-pose meshes of a
+ * finger, so that the OBJ files do not have to be parsed and processed on
+ * every startup. The cache file is memory mapped and its arrays are laid out
+ * exactly as they are used, so the fingers use them in place: the vertices
+ * as 3xN column-major values (i.e. interleaved xyz) of the scalar type of
+ * the skinned vertices (#VertexScalar) and the faces as row-major index
+ * triplets, each aligned to 64 bytes. The file is keyed by a hash of the
+ * mesh files and the finger configuration (see #hash), and is rebuilt
+ * automatically when the key, the format version or the scalar type does
+ * not match.
+ *
+ * Layout: a 64-byte header (magic, version, size of the vertex scalar,
+ * number of meshes, key), a table with one entry per mesh (number of
+ * vertices and faces, and the offsets of their arrays) and the arrays.
+*/
+class MeshCache
+{
+public:
+    /// Scalar type of the cached vertices, the one the hand vertices are
+    /// skinned in (HAND_FLOAT_VERTICES build option, see HandKinematics::).
+#ifdef HAND_FLOAT_VERTICES
+    using VertexScalar = float;
+#else
+    using VertexScalar = double;
+#endif
+
+    /// Vertices matrix type (3xN, interleaved xyz).
+    using VerticesMatrix = Eigen::Matrix<VertexScalar, 3, Eigen::Dynamic>;
+
+    /// Faces matrix type (row-major index triplets).
+    using FacesMatrix = Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor>;
+
+    /// Empty constructor.
+    MeshCache() {};
+
+    /// Unmap the cache file.
+    ~MeshCache() { close(); }
+
+    /// The cache maps a file, so it can not be copied.
+    MeshCache(const MeshCache&) = delete;
+    MeshCache& operator=(const MeshCache&) = delete;
+
+    /// Map a cache file and validate it against a key.
+    bool open(const std::filesystem::path& filename, uint64_t key);
+
+    /// Unmap the cache file.
+    void close(void);
+
+    /// Get the number of meshes.
+    size_t get_meshes_num(void) { return m_entries_num; }
+
+    /// Get the vertices of a mesh (3xN, mapped).
+    Eigen::Map<const VerticesMatrix> get_vertices(size_t idx);
+
+    /// Get the faces of a mesh (Fx3, mapped).
+    Eigen::Map<const FacesMatrix> get_faces(size_t idx);
+
+    /// Write a cache file.
+    static bool write(const std::filesystem::path& filename, uint64_t key,
+        const std::vector<VerticesMatrix>& vertices,
+        const std::vector<FacesMatrix>& faces);
+
+    /// Get the format version (see #m_version).
+    static uint32_t get_version(void) { return m_version; }
+
+    /// Hash a block of memory (64-bit FNV-1a).
+    static uint64_t hash(const void* data, size_t size,
+        uint64_t seed=m_hash_seed);
+
+    /// Hash the contents of a file.
+    static uint64_t hash_file(const std::filesystem::path& filename,
+        uint64_t seed=m_hash_seed);
+
+private:
+    /// Header of the cache file.
+    struct Header
+    {
+        // Magic number
+        char magic[8];
+
+        // Format version
+        uint32_t version;
+
+        // Size of the vertex scalar (bytes)
+        uint32_t scalar_size;
+
+        // Number of meshes
+        uint64_t meshes_num;
+
+        // Key of the cached data
+        uint64_t key;
+
+        // Padding (64-byte header)
+        uint8_t padding[32];
+    };
+
+    /// Table entry of a mesh.
+    struct Entry
+    {
+        // Number of vertices and faces
+        uint64_t vertices_num, faces_num;
+
+        // Offsets of the vertex and face arrays (bytes)
+        uint64_t vertices_offset, faces_offset;
+    };
+
+    /// Alignment of the arrays (bytes).
+    static constexpr size_t m_alignment = 64;
+
+    /// Format version (bumped when the layout changes).
+    static constexpr uint32_t m_version = 2;
+
+    /// Magic number.
+    static constexpr char m_magic[8] = {'H', 'A', 'N', 'D', 'M', 'E', 'S', 'H'};
+
+    /// FNV-1a offset basis.
+    static constexpr uint64_t m_hash_seed = 14695981039346656037ULL;
+
+    /// Mapped file.
+    const uint8_t* m_data = nullptr;
+
+    /// Size of the mapped file (bytes).
+    size_t m_size = 0;
+
+    /// Table of the meshes (inside the mapped file).
+    const Entry* m_entries = nullptr;
+
+    /// Number of meshes.
+    size_t m_entries_num = 0;
+};
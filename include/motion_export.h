@@ -0,0 +1,114 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <charconv>
+#include <cstring>
+#include <eigen3/Eigen/Dense>
+
+#include "./nlohmann/json.hpp"
+
+#include "utils.h"
+#include "euler_rotations.h"
+#include "animated_hand.h"
+#include "hand_kinematics.h"
+
+/// Class MotionExport
+/**
+ * This class encodes the motion of the hand for animation tools. The
+ * skeleton is the joint hierarchy of the fingers (see HandKinematics:: and
+ * hand_config.json): a root joint at the base frame of the hand and, for
+ * each finger, a chain of one joint per finger frame ended by the fingertip.
+ * A frame of the motion holds the rotation of every finger joint, i.e. the
+ * euler angles of the hand frames (see AnimatedHand::get_hand_angles).
+ *
+ * Two formats are supported: BVH (text, one line per frame) and binary
+ * glTF (GLB), with one animation sampler per joint. The frames are assumed
+ * to be uniformly spaced. Since the GLB streams must be contiguous per
+ * joint, the number of frames must be known before the frames are encoded,
+ * and each block of frames is written to its place in every stream (see
+ * #get_glb_stream_offset). The right hand is a reflection of the left one,
+ * which neither format can hold, so it is exported as a mirrored skeleton
+ * (y offsets, roll and yaw negated), whose joint positions are the ones of
+ * the hand model.
+*/
+class MotionExport
+{
+public:
+    /// Empty constructor.
+    MotionExport() {};
+
+    /// Initialize the skeleton.
+    void initialize(HandKinematics& hand, bool type, double frame_time);
+
+    /// Get the BVH header (hierarchy and motion header).
+    std::string get_bvh_header(size_t frames_num);
+
+    /// Append a BVH frame.
+    void append_bvh_frame(const AnimatedHand::HandAngles& euler_arr,
+        std::string& output);
+
+    /// Get the beginning of the GLB file (up to the first stream).
+    std::string get_glb_header(size_t frames_num);
+
+    /// Get the number of GLB streams (time and one per animated joint).
+    size_t get_glb_streams_num(void) { return 1 + m_animated_num; }
+
+    /// Get the size of an element of a GLB stream (bytes).
+    static size_t get_glb_element_size(size_t stream_idx) {
+        return stream_idx == 0 ? sizeof(float) : 4 * sizeof(float); }
+
+    /// Get the offset of a GLB stream in the file (bytes).
+    size_t get_glb_stream_offset(size_t stream_idx, size_t frames_num);
+
+    /// Set a frame of a block of GLB streams.
+    void set_glb_frame(const AnimatedHand::HandAngles& euler_arr,
+        size_t frame_idx, size_t block_frame_idx, size_t block_frames_num,
+        char* block_data);
+
+private:
+    /// Joint of the skeleton.
+    struct Joint
+    {
+        // Joint name
+        std::string name;
+
+        // Parent joint idx (-1: root)
+        int parent;
+
+        // Offset from the parent joint (rest pose, m)
+        Eigen::Vector3d offset;
+
+        // Hand frame that rotates the joint (-1: not animated)
+        int frame_id;
+    };
+
+    /// Get the rotation of a joint (mirrored for the right hand).
+    Eigen::Vector3d get_euler(const AnimatedHand::HandAngles& euler_arr,
+        const Joint& joint);
+
+    /// Append the hierarchy of a BVH joint.
+    void append_bvh_joint(size_t joint_idx, size_t depth, std::string& output);
+
+    /// Get the GLB json chunk.
+    nlohmann::json get_glb_json(size_t frames_num);
+
+    /// Append a number to a text output.
+    static void append_number(double value, std::string& output);
+
+    /// Skeleton joints (depth first order).
+    std::vector<Joint> m_joints;
+
+    /// Number of animated joints.
+    size_t m_animated_num = 0;
+
+    /// Hand type (left: 0, right: 1).
+    bool m_type = 0;
+
+    /// Time between two frames (s).
+    double m_frame_time = 0.01;
+
+    /// Size of the GLB header, json chunk and binary chunk header (bytes).
+    size_t m_glb_header_size = 0;
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <math.h>
+#include <eigen3/Eigen/Dense>
+
+/// Class OneEuroFilter
+/**
+ * This class implements the one-euro filter (Casiez et al., CHI 2012) for a
+ * number of channels at once. Each channel is a first-order low-pass filter
+ * whose cutoff frequency adapts to the speed of the signal:
+ * \f$ f_{c} = f_{c_{min}} + \beta |\dot{\hat{x}}| \f$, so slow motions are
+ * smoothed strongly (low jitter) and fast motions lightly (low lag). The
+ * channels are stored as arrays, so a sample of all the channels is filtered
+ * with a few vectorised operations. A channel with a non-positive minimum
+ * cutoff is passed through unfiltered.
+*/
+class OneEuroFilter
+{
+public:
+    /// Parameters of a channel.
+    struct Parameters
+    {
+        // Minimum cutoff frequency (Hz, non-positive disables the filter)
+        double min_cutoff;
+
+        // Speed coefficient (1 / signal unit)
+        double beta;
+
+        // Cutoff frequency of the derivative (Hz)
+        double d_cutoff;
+    };
+
+    /// Empty constructor.
+    OneEuroFilter() {};
+
+    /// Initialize the filter (one set of parameters per channel).
+    void initialize(const std::vector<Parameters>& parameters);
+
+    /// Filter a sample of all the channels (in place).
+    void filter(double* sample, double dt);
+
+    /// Filter a sample of all the channels (in place).
+    void filter(std::vector<double>& sample, double dt) {
+        if (sample.size() == (size_t) m_min_cutoff.size()) {
+            filter(sample.data(), dt); } }
+
+    /// Reset the filter state (the next sample is passed through).
+    void reset(void) { m_is_initialized = false; }
+
+    /// Get the number of channels.
+    size_t get_channels_num(void) { return m_min_cutoff.size(); }
+
+private:
+    /// Minimum cutoff frequency of the channels.
+    Eigen::ArrayXd m_min_cutoff;
+
+    /// Speed coefficient of the channels.
+    Eigen::ArrayXd m_beta;
+
+    /// Cutoff frequency of the derivative of the channels.
+    Eigen::ArrayXd m_d_cutoff;
+
+    /// Whether each channel is filtered (1) or passed through (0).
+    Eigen::ArrayXd m_enabled;
+
+    /// Previous filtered values.
+    Eigen::ArrayXd m_x_hat;
+
+    /// Previous filtered derivatives.
+    Eigen::ArrayXd m_dx_hat;
+
+    /// Smoothing factors of the current sample (preallocated).
+    Eigen::ArrayXd m_alpha;
+
+    /// Whether the filter has received its first sample.
+    bool m_is_initialized = false;
+};
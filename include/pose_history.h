@@ -0,0 +1,74 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <eigen3/Eigen/Dense>
+#include <eigen3/Eigen/Geometry>
+
+#include "animated_hand.h"
+#include "euler_rotations.h"
+
+/// Class PoseHistory
+/**
+ * This class keeps a short history of timestamped hand poses (euler angles of
+ * the hand frames, see AnimatedHand::HandAngles) and samples it at an
+ * arbitrary (display) time. Between two poses the rotation of every frame is
+ * interpolated with slerp, and beyond the newest pose it is extrapolated along
+ * the same great arc. The extrapolation is bounded both in time
+ * (#m_max_extrapolation) and in size (at most one sample interval), which
+ * bounds the error to the motion of a single sample interval.
+*/
+class PoseHistory
+{
+public:
+    /// Timestamped hand pose.
+    struct Pose
+    {
+        // Time (s)
+        double time;
+
+        // Euler angles of the hand frames
+        AnimatedHand::HandAngles angles;
+    };
+
+    /// Empty constructor.
+    PoseHistory() {};
+
+    /// Initialize the history.
+    void initialize(size_t capacity=32, double max_extrapolation=0.02);
+
+    /// Push a pose (poses older than the newest one are dropped).
+    void push(double time, const AnimatedHand::HandAngles& angles);
+
+    /// Sample the history at a time.
+    bool sample(double time, AnimatedHand::HandAngles& angles);
+
+    /// Clear the history.
+    void clear(void) { m_size = 0; }
+
+    /// Get the number of poses.
+    size_t size(void) { return m_size; }
+
+private:
+    /// Get the pose i (0 is the oldest one).
+    const Pose& at(size_t i) {
+        return m_poses.at((m_head + m_poses.size() - m_size + i) %
+            m_poses.size()); }
+
+    /// Interpolate (or extrapolate) two poses with slerp.
+    static void slerp(const AnimatedHand::HandAngles& angles_a,
+        const AnimatedHand::HandAngles& angles_b, double u,
+        AnimatedHand::HandAngles& angles);
+
+    /// Poses (ring buffer).
+    std::vector<Pose> m_poses = std::vector<Pose>(32);
+
+    /// Index of the next pose in the ring buffer.
+    size_t m_head = 0;
+
+    /// Number of poses.
+    size_t m_size = 0;
+
+    /// Maximum extrapolation time beyond the newest pose (s).
+    double m_max_extrapolation = 0.02;
+};
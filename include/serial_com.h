@@ -1,6 +1,9 @@
 #pragma once 
 
 #include <boost/asio.hpp>
+#include <sys/ioctl.h>
+#include <poll.h>
+#include <linux/serial.h>
 
 /// Class SerialCOM
 /**
@@ -32,10 +35,25 @@ public:
     /// Blocks until a line is received from the serial device.
     std::string readLine(void);
 
+    /// Blocks until a line is received and stamps its arrival time.
+    std::string readLine(double& timestamp);
+
+    /// Blocks until a line is received into a buffer (false if overlong).
+    bool readLine(std::string& line, double& timestamp);
+
+    /// Wait until data can be read from the serial device (false on timeout).
+    bool wait_readable(int timeout_ms);
+
+    /// Get the overrun counters of the UART driver (TIOCGICOUNT).
+    bool get_overrun_counters(int& overrun, int& buf_overrun);
+
     // Initialize stream.
     void initialize_stream(int iter=3);
 
 private:
+    /// Maximum length of a line (longer lines are truncated).
+    static constexpr size_t m_max_line_length = 1024;
+
     /// Boost io service.
     boost::asio::io_service io;
     
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <eigen3/Eigen/Dense>
+
+#include <igl/opengl/glfw/Viewer.h>
+
+#include "utils.h"
+#include "animated_hand.h"
+#include "joint_calibration.h"
+#include "hand.h"
+#include "instanced_mesh.h"
+#include "stream_health.h"
+#include "frame_encoder.h"
+
+/// Class SessionRender
+/**
+ * This class replays a recorded session (see TrajectoryBatch:: for the
+ * format) through the hand meshes of the viewer (see Hand::) and renders
+ * every frame offscreen to a PNG file. The viewer window is hidden and the
+ * scene (both hands, camera) is the one of KinematicAnimation::. The frames
+ * are drawn into a framebuffer object of the requested size, read back and
+ * handed to a pool of encoder threads (see FrameEncoder::), so the
+ * rendering does not wait for the PNG compression.
+ *
+ * Every frame can also be rendered with a second pair of hands in another
+ * render mode and compared with it (see Parameters::compare), e.g. to check
+ * the skinning shader of GpuSkinning:: against the CPU skinning.
+ *
+ * An OpenGL 3.2 context is still needed: on a machine without a GPU, run
+ * it on a virtual display with the software rasterizer of Mesa (llvmpipe),
+ * see README.md.
+*/
+class SessionRender
+{
+public:
+    /// Rendering parameters.
+    struct Parameters
+    {
+        // Size of the frames (pixels)
+        int width = 1280, height = 800;
+
+        // Render mode of the hands
+        Hand::RenderMode render_mode = Hand::RenderMode::CPU;
+
+        // Number of encoder threads (0: one per core but the renderer's)
+        size_t encoders_num = 0;
+
+        // Render one frame every stride samples
+        size_t stride = 1;
+
+        // Render every frame in the reference mode as well and compare the
+        // two (e.g. the GPU skinning with the CPU one, see Statistics::)
+        bool compare = false;
+        Hand::RenderMode reference_mode = Hand::RenderMode::CPU;
+
+        // Create an EGL context without a display (null platform of GLFW
+        // 3.4, e.g. the surfaceless llvmpipe of Mesa) instead of a hidden
+        // window of the display
+        bool headless = false;
+
+        // Whether the session holds glove readings to calibrate (see
+        // JointCalibration::) or joint angles
+        bool calibrate = true;
+    };
+
+    /// Rendering statistics.
+    struct Statistics
+    {
+        // Lines of the session (empty lines excluded) and valid samples
+        uint64_t lines = 0, samples = 0;
+
+        // Malformed, short and overlong lines (skipped)
+        uint64_t malformed = 0, short_lines = 0, overlong = 0;
+
+        // Rendered frames and rendering time (s, update, draw and read back)
+        uint64_t frames = 0;
+        double render_time = 0.0;
+
+        // Statistics of the encoders
+        size_t encoders_num = 0;
+        FrameEncoder::Statistics encoder;
+
+        // Processing time (s)
+        double time = 0.0;
+
+        // OpenGL renderer and version of the context (the frame rates
+        // depend on them)
+        std::string renderer;
+
+        // Compared frames, largest number of different pixels of a frame
+        // (covered by the hands in one mode only, or at a different depth)
+        // and largest difference of a color channel. The CPU mode shades
+        // the meshes with their rest-pose normals (ViewerData::set_vertices
+        // keeps them), so only the geometry is expected to match
+        uint64_t compared_frames = 0, max_different_pixels = 0;
+        int max_color_difference = 0;
+    };
+
+    /// Empty constructor.
+    SessionRender() {};
+
+    /// Initialize.
+    void initialize(const Parameters& parameters);
+
+    /// Render a session file to a folder of PNG frames.
+    bool process(const std::string& input_filename,
+        const std::string& output_folder);
+
+    /// Get the statistics of the last rendered session.
+    const Statistics& get_statistics(void) { return m_statistics; }
+
+private:
+    /// Create the hidden window, the hands and the framebuffer.
+    bool setup_scene(void);
+
+    /// Release the framebuffer and close the window.
+    void shutdown_scene(void);
+
+    /// Render the current pose of the hands into a frame.
+    void render_frame(FrameEncoder::Frame& frame);
+
+    /// Update a pair of hands with the current hand angles.
+    void update_hands(Hand& left_hand, Hand& right_hand,
+        Hand::RenderMode render_mode);
+
+    /// Draw the hands of a render mode and read the pixels back.
+    void draw_hands(bool is_reference, unsigned char* pixels, float* depth);
+
+    /// Compare a frame with the reference one.
+    void compare_frame(const FrameEncoder::Frame& frame);
+
+    /// Rendering parameters.
+    Parameters m_parameters;
+
+    /// Statistics of the last rendered session.
+    Statistics m_statistics;
+
+    /// Glove mapping.
+    AnimatedHand m_anim_hand;
+
+    /// Calibration of the glove channels.
+    JointCalibration m_calibration;
+
+    /// Viewer (hidden window, OpenGL context and meshes).
+    igl::opengl::glfw::Viewer m_viewer;
+
+    /// Left and right hand.
+    Hand m_left_hand, m_right_hand;
+
+    /// Left and right hand in the reference mode (comparison), and index of
+    /// their first viewer data.
+    Hand m_reference_left_hand, m_reference_right_hand;
+    size_t m_reference_data_idx = 0;
+
+    /// Reference frame and depth of both frames (comparison).
+    std::vector<unsigned char> m_reference_pixels;
+    std::vector<float> m_depth, m_reference_depth;
+
+    /// Instanced joint and bone meshes (instanced mode).
+    InstancedMesh m_joint_mesh, m_bone_mesh;
+
+    /// Left and right hand origins (as in KinematicAnimation::).
+    Eigen::Vector3d m_left_origin = Eigen::Vector3d(0.0, 0.2, 0.0);
+    Eigen::Vector3d m_right_origin = Eigen::Vector3d(0.0, -0.2, 0.0);
+
+    /// Camera center (as in KinematicAnimation::).
+    Eigen::Matrix3d m_camera_center;
+
+    /// Framebuffer object and its color and depth renderbuffers.
+    GLuint m_framebuffer = 0;
+    GLuint m_renderbuffers[2] = {0, 0};
+
+    /// PNG encoders.
+    FrameEncoder m_encoder;
+
+    /// Euler angles of the hand frames.
+    AnimatedHand::HandAngles m_euler_id;
+
+    /// Maximum length of a line (as in SerialCOM::).
+    static constexpr size_t m_max_line_length = 1024;
+
+    /// Largest depth difference of a pixel of the compared frames (libigl
+    /// offsets the depth of the meshes, InstancedMesh:: does not).
+    static constexpr float m_depth_tolerance = 1e-2f;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <eigen3/Eigen/Dense>
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define SKINNING_KERNEL_X86
+#endif
+
+/// Class SkinningKernel
+/**
+ * This class implements the rigid skinning of the hand meshes. Every mesh
+ * (joint sphere or bone cylinder) is rigidly attached to a link of a finger,
+ * so its vertices are given by \f$ v = R v_{o} + p \f$, where \f$ R, p \f$
+ * is the global transform of the link and \f$ v_{o} \f$ the rest-pose vertex.
+ * The rest-pose vertices of the whole hand are stored in a single contiguous
+ * buffer of SoA streams (an Nx3 column-major matrix, i.e. all x, then all y,
+ * then all z) and are transformed in one pass. The skinned vertices are
+ * written interleaved (x, y, z of each vertex, an Nx3 row-major matrix), the
+ * layout of the OpenGL vertex buffers, so the vectorized kernels transpose
+ * them in registers. The inner loop is dispatched at runtime to AVX-512,
+ * AVX2 or a scalar implementation.
+*/
+class SkinningKernel
+{
+public:
+    /// Rigid transform of a link (row-major rotation and position).
+    template <typename T>
+    struct RigidTransform
+    {
+        // Rotation matrix (row-major)
+        T rot[9];
+
+        // Position vector
+        T pos[3];
+    };
+
+    /// Segment of the rest-pose streams that is driven by a single link.
+    template <typename T>
+    struct Segment
+    {
+        // Index of the first vertex in the rest-pose streams
+        size_t offset;
+
+        // Number of vertices
+        size_t size;
+
+        // Index of the link transform
+        size_t link;
+
+        // Output vertices (interleaved x, y, z)
+        T* out;
+    };
+
+    /// Instruction sets.
+    enum class ISA { Scalar = 0, AVX2 = 1, AVX512 = 2 };
+
+public:
+    /// Detect the best instruction set supported by the CPU.
+    static ISA detect_isa(void);
+
+    /// Get the instruction set that is used.
+    static ISA get_isa(void) { return m_isa; }
+
+    /// Set the instruction set (limited to the ones supported by the CPU).
+    static void set_isa(ISA isa);
+
+    /// Get the name of an instruction set.
+    static std::string get_isa_name(ISA isa);
+
+    /// Convert a homogeneous transformation matrix to a rigid transform.
+    template <typename T>
+    static RigidTransform<T> rigid_transform(const Eigen::Matrix4d& t_mat);
+
+    /// Skin the rest-pose streams (double precision).
+    static void skin(const double* rest, size_t rest_size,
+        const std::vector<Segment<double>>& segments,
+        const std::vector<RigidTransform<double>>& transforms);
+
+    /// Skin the rest-pose streams (single precision).
+    static void skin(const float* rest, size_t rest_size,
+        const std::vector<Segment<float>>& segments,
+        const std::vector<RigidTransform<float>>& transforms);
+
+private:
+    /// Instruction set that is used.
+    static ISA m_isa;
+};
+
+/**
+ * @brief Converts a homogeneous transformation matrix to the rigid transform
+ * structure used by the kernel.
+ * @tparam T The scalar type (float or double).
+ * @param t_mat The homogeneous transformation matrix.
+ * @return SkinningKernel::RigidTransform<T> The rigid transform.
+ */
+template <typename T>
+SkinningKernel::RigidTransform<T> SkinningKernel::rigid_transform(
+    const Eigen::Matrix4d& t_mat)
+{
+    RigidTransform<T> transform;
+
+    for (size_t i = 0; i < 3; i++)
+    {
+        for (size_t j = 0; j < 3; j++)
+        {
+            transform.rot[3 * i + j] = (T) t_mat(i, j);
+        }
+        transform.pos[i] = (T) t_mat(i, 3);
+    }
+
+    return transform;
+}
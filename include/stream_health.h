@@ -0,0 +1,129 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <stdint.h>
+
+#include "utils.h"
+
+/// Class StreamHealth
+/**
+ * This class keeps the health counters of the serial stream: received,
+ * malformed, short and overlong lines, sequence gaps (if the firmware numbers
+ * its lines), samples dropped before the hand over, UART overruns and the
+ * effective sample rate. The counters are written by the acquisition thread
+ * only and are lock-free atomics, so they can be read at any time from the
+ * UI thread. Since there is a single writer, an increment is a relaxed load
+ * and store (no locked instruction), which costs the reader nothing.
+*/
+class StreamHealth
+{
+public:
+    /// Status of a received line.
+    enum class LineStatus
+    {
+        // Every channel of the glove (and the optional tick and sequence)
+        Valid = 0,
+
+        // A value is empty or not a number
+        Malformed = 1,
+
+        // Fewer values than channels
+        Short = 2,
+
+        // More values than expected, or more characters than a line holds
+        Overlong = 3,
+    };
+
+    /// Snapshot of the health counters.
+    struct Statistics
+    {
+        // Received lines (all of them) and valid samples
+        uint64_t lines = 0, samples = 0;
+
+        // Malformed, short and overlong lines
+        uint64_t malformed = 0, short_lines = 0, overlong = 0;
+
+        // Whether the lines carry a sequence counter, the number of gaps,
+        // the number of lines lost in them and the repeated lines
+        bool has_sequence = false;
+        uint64_t sequence_gaps = 0, lost = 0, duplicates = 0;
+
+        // Samples dropped because the animation loop did not collect them
+        uint64_t dropped = 0;
+
+        // Whether the driver reports overruns, hardware and buffer overruns
+        bool has_overrun_counters = false;
+        uint64_t overruns = 0, buffer_overruns = 0;
+
+        // Effective sample rate (valid samples per second)
+        double sample_rate = 0.0;
+    };
+
+    /// Empty constructor.
+    StreamHealth() {};
+
+    /// Parse and classify a glove line (channels[, tick[, sequence]]).
+    static LineStatus parse_line(const std::string& line, bool is_complete,
+        size_t channels_num, std::vector<double>& values, double& tick,
+        double& sequence);
+
+    /// Initialize (reset the counters).
+    void initialize(double time, double rate_window=1.0,
+        unsigned int sequence_bits=64);
+
+    /// Count a received line (acquisition thread).
+    void add_line(LineStatus status);
+
+    /// Check the sequence counter of a valid line (acquisition thread).
+    void add_sequence(uint64_t sequence);
+
+    /// Count a dropped sample (acquisition thread).
+    void add_dropped(void) { increment(m_dropped); }
+
+    /// Set the UART overrun counters (since initialization).
+    void set_overrun_counters(uint64_t overruns, uint64_t buffer_overruns);
+
+    /// Get a snapshot of the counters and update the sample rate (UI thread).
+    Statistics get_statistics(double time);
+
+private:
+    /// Increment a counter (single writer).
+    static void increment(std::atomic<uint64_t>& counter, uint64_t value=1) {
+        counter.store(counter.load(std::memory_order_relaxed) + value,
+            std::memory_order_relaxed); }
+
+    /// Line counters.
+    std::atomic<uint64_t> m_lines{0}, m_samples{0}, m_malformed{0},
+        m_short_lines{0}, m_overlong{0};
+
+    /// Sequence counters.
+    std::atomic<uint64_t> m_sequence_gaps{0}, m_lost{0}, m_duplicates{0};
+    std::atomic<bool> m_has_sequence{false};
+
+    /// Dropped samples.
+    std::atomic<uint64_t> m_dropped{0};
+
+    /// UART overrun counters.
+    std::atomic<uint64_t> m_overruns{0}, m_buffer_overruns{0};
+    std::atomic<bool> m_has_overrun_counters{false};
+
+    /// Previous sequence counter (acquisition thread).
+    uint64_t m_prev_sequence = 0;
+
+    /// Mask of the sequence counter (it wraps around at the width of the
+    /// firmware counter).
+    uint64_t m_sequence_mask = UINT64_MAX;
+
+    /// Window of the sample rate (s).
+    double m_rate_window = 1.0;
+
+    /// Start time and samples of the current rate window (UI thread).
+    double m_rate_time = 0.0;
+    uint64_t m_rate_samples = 0;
+
+    /// Effective sample rate of the previous window (UI thread).
+    double m_sample_rate = 0.0;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <cerrno>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include "./nlohmann/json.hpp"
+
+/// Class ThreadScheduler
+/**
+ * This class loads the scheduling options of the acquisition thread (see
+ * Exoskeleton::) and of the compute thread (the thread of the viewer that
+ * runs the kinematics) from the thread configuration file, and applies them:
+ * real-time priority (SCHED_FIFO), CPU affinity and locking of the process
+ * memory (mlockall). Every option falls back to the default behaviour when
+ * the permissions are missing, and the resulting status is reported instead
+ * of an error.
+*/
+class ThreadScheduler
+{
+public:
+    /// Scheduling parameters of a thread.
+    struct Parameters
+    {
+        // SCHED_FIFO priority (1-99, 0: default scheduling)
+        int priority = 0;
+
+        // CPUs the thread runs on (empty: every CPU of the process)
+        std::vector<int> cpus;
+    };
+
+    /// Scheduling status of a thread.
+    struct Status
+    {
+        // Whether the thread runs with SCHED_FIFO and its priority
+        bool is_realtime = false;
+        int priority = 0;
+
+        // Whether the CPU affinity has been set
+        bool is_pinned = false;
+    };
+
+    /// Empty constructor.
+    ThreadScheduler() {};
+
+    /// Initialize (load the configuration file).
+    void initialize(const std::string& config_rel_path=m_config_rel_path);
+
+    /// Lock the process memory (if enabled).
+    bool lock_memory(void);
+
+    /// Apply scheduling parameters to the calling thread.
+    static Status apply(const Parameters& parameters);
+
+    /// Get the parameters of the acquisition thread.
+    const Parameters& get_acquisition_parameters(void) {
+        return m_acquisition_parameters; }
+
+    /// Get the parameters of the compute thread.
+    const Parameters& get_compute_parameters(void) {
+        return m_compute_parameters; }
+
+    /// Whether the process memory is locked.
+    bool is_memory_locked(void) { return m_memory_locked; }
+
+private:
+    /// Relative name of the thread configuration file.
+    static inline const std::string m_config_rel_path = "share/thread_config.json";
+
+    /// Parse the parameters of a thread.
+    static Parameters parse_parameters(const nlohmann::json& json_thread);
+
+    /// Parameters of the acquisition thread.
+    Parameters m_acquisition_parameters;
+
+    /// Parameters of the compute thread.
+    Parameters m_compute_parameters;
+
+    /// Whether to lock the process memory.
+    bool m_lock_memory = false;
+
+    /// Whether the process memory is locked.
+    bool m_memory_locked = false;
+};
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <eigen3/Eigen/Dense>
+
+#include "utils.h"
+#include "animated_hand.h"
+#include "joint_calibration.h"
+#include "hand_kinematics.h"
+#include "stream_health.h"
+#include "motion_export.h"
+
+/// Class TrajectoryBatch
+/**
+ * This class converts a recorded session into the trajectories of the
+ * joints and fingertips of the hand offline, or into an animation of its
+ * skeleton (see MotionExport::). A session is a capture of the glove stream
+ * (one line per sample, channels in degrees optionally followed by the
+ * device tick and the sequence counter, see Exoskeleton::). Every valid
+ * sample is calibrated (see JointCalibration::), mapped to the hand frames
+ * (see AnimatedHand::) and the forward kinematics of the fingers are
+ * computed without meshes (see HandKinematics::).
+ *
+ * The file is split in blocks of lines that are processed by a pool of
+ * workers, one hand model per worker. The blocks are written in file order
+ * by the calling thread, and at most a fixed number of blocks are in flight,
+ * so the memory stays bounded whatever the length of the session. The
+ * animation formats need the number of samples before the first block is
+ * written, so the workers first count the samples of every block.
+*/
+class TrajectoryBatch
+{
+public:
+    /// Output formats: a CSV table with a header line, a headerless table
+    /// of little-endian float64 rows (same columns, see #get_column_names),
+    /// or an animation of the skeleton in BVH or binary glTF (see
+    /// MotionExport::).
+    enum class Format { CSV = 0, Binary = 1, BVH = 2, GLB = 3 };
+
+    /// Processing parameters.
+    struct Parameters
+    {
+        // Hand of the session (left: 0, right: 1)
+        bool type = 0;
+
+        // Output format
+        Format format = Format::CSV;
+
+        // Number of workers (0: one per core)
+        size_t threads_num = 0;
+
+        // Size of a block of the input file (bytes)
+        size_t block_size = 1 << 18;
+
+        // Time between two samples of the animation formats (s)
+        double frame_time = 0.01;
+
+        // Whether the session holds glove readings to calibrate (see
+        // JointCalibration::) or joint angles
+        bool calibrate = true;
+    };
+
+    /// Processing statistics.
+    struct Statistics
+    {
+        // Lines of the session (empty lines excluded) and valid samples
+        uint64_t lines = 0, samples = 0;
+
+        // Malformed, short and overlong lines (skipped)
+        uint64_t malformed = 0, short_lines = 0, overlong = 0;
+
+        // Number of workers and processing time (s)
+        size_t threads_num = 0;
+        double time = 0.0;
+    };
+
+    /// Empty constructor.
+    TrajectoryBatch() {};
+
+    /// Initialize.
+    void initialize(const Parameters& parameters);
+
+    /// Process a session file.
+    bool process(const std::string& input_filename,
+        const std::string& output_filename);
+
+    /// Get the names of the output columns.
+    std::vector<std::string> get_column_names(void);
+
+    /// Get the statistics of the last processed session.
+    const Statistics& get_statistics(void) { return m_statistics; }
+
+private:
+    /// State of a worker.
+    struct Worker
+    {
+        // Hand model (kinematics only), glove mapping and calibration
+        HandKinematics hand;
+        AnimatedHand anim_hand;
+        JointCalibration calibration;
+
+        // Input block and current line
+        std::string input, line;
+
+        // Values of the line (joint angles) and hand angles
+        std::vector<double> values;
+        AnimatedHand::HandAngles euler_arr;
+
+        // Row of the output table
+        std::vector<double> row;
+
+        // Current block, and number of samples of the block so far
+        size_t block_idx = 0, block_samples = 0;
+
+        // Whether the worker only counts the samples
+        bool is_counting = false;
+
+        // Statistics of the worker
+        Statistics statistics;
+    };
+
+    /// Output block.
+    struct Slot
+    {
+        // Output of the block
+        std::string output;
+
+        // Whether the block has been processed
+        bool ready = false;
+    };
+
+    /// Run a worker.
+    void run_worker(Worker& worker);
+
+    /// Count the samples of every block (animation formats).
+    void count_samples(std::vector<Worker>& workers);
+
+    /// Write a block to the output file.
+    bool write_block(size_t block_idx, const std::string& output);
+
+    /// Write data to the output file at an offset.
+    bool write_output(const char* data, size_t size, size_t offset);
+
+    /// Process a block of the input file.
+    void process_block(Worker& worker, size_t block_idx, std::string& output);
+
+    /// Process a line of the input file.
+    void process_line(Worker& worker, const char* begin, const char* end,
+        std::string& output);
+
+    /// Append a row to the output block.
+    void append_row(const std::vector<double>& row, std::string& output);
+
+    /// Processing parameters.
+    Parameters m_parameters;
+
+    /// Glove mapping, calibration and hand model (copied to every worker).
+    AnimatedHand m_anim_hand;
+    JointCalibration m_calibration;
+    HandKinematics m_hand;
+
+    /// Skeleton of the animation formats.
+    MotionExport m_motion_export;
+
+    /// Number of output columns.
+    size_t m_columns_num = 0;
+
+    /// Maximum length of a line (as in SerialCOM::).
+    static constexpr size_t m_max_line_length = 1024;
+
+    /// Statistics of the last processed session.
+    Statistics m_statistics;
+
+private:
+    /// Input file descriptor and size.
+    int m_input_fd = -1;
+    size_t m_input_size = 0;
+
+    /// Output file descriptor and end of the written output (sequential
+    /// formats).
+    int m_output_fd = -1;
+    size_t m_output_size = 0;
+
+    /// Number of blocks of the input file.
+    size_t m_blocks_num = 0;
+
+    /// Index of the first sample of every block, and total number of
+    /// samples (last entry, animation formats).
+    std::vector<size_t> m_block_offsets;
+
+    /// Ring of output blocks (the blocks in flight).
+    std::vector<Slot> m_slots;
+
+    /// Next block to process and next block to write.
+    size_t m_next_block = 0, m_next_write = 0;
+
+    /// Synchronization of the workers and the writer.
+    std::mutex m_mutex;
+    std::condition_variable m_block_done, m_slot_free;
+};
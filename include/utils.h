@@ -5,6 +5,9 @@
 #include <vector>
 #include <algorithm>
 #include <math.h>
+#include <stdlib.h>
+#include <charconv>
+#include <time.h>
 
 /// Class Utils
 /**
@@ -26,10 +29,25 @@ public:
 
     /// Convert degrees to rad
     inline static double deg2rad(double deg) { return (deg * (M_PI / 180.0)); }
+
+    /// Convert rad to degrees
+    inline static double rad2deg(double rad) { return (rad * (180.0 / M_PI)); }
+
+    /// Monotonic time (s, CLOCK_MONOTONIC_RAW, i.e. not slewed by NTP). All 
+    /// the sample timestamps use this clock.
+    inline static double monotonic_time(void) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+        return ts.tv_sec + 1e-9 * ts.tv_nsec; }
     
     /// Convert comma-delimited string to int vector of analog values
     static std::vector<int> analog_str_buf_to_int_vec(const std::string& str);
 
     /// Convert comma-delimited string to double vector of analog values
     static std::vector<double> analog_str_buf_to_double_vec(const std::string& str);
+
+    /// Parse comma-delimited string to double vector without throwing (false 
+    /// if a value is malformed).
+    static bool parse_double_vec(const std::string& str,
+        std::vector<double>& data_vec);
 };
\ No newline at end of file
@@ -1,28 +1,327 @@
 #include "../include/animated_hand.h"
 
-// Generate hand angles 
+/**
+ * @brief Loads the glove channel map from the glove configuration file
+ * (#m_config_rel_path) and compiles it into a flat scatter table. If the file
+ * does not exist, or describes the default topology, the compile-time
+ * default topology is used instead.
+ * @param config_rel_path Relative path of the glove configuration file.
+ */
+void AnimatedHand::initialize(const std::string& config_rel_path)
+{
+    // Define absolute path of glove configuration file
+    auto config_abs_path = std::filesystem::current_path() / config_rel_path;
+
+    // Keep default topology if there is no configuration
+    if (!std::filesystem::exists(config_abs_path)) { return; }
+
+    // Parse json file
+    std::ifstream file(config_abs_path);
+    nlohmann::json json_file = nlohmann::json::parse(file);
+
+    // Set channel map
+    set_channel_map(parse_json_file(json_file));
+}
+
+// Generate hand angles
 std::vector<Eigen::Vector3d> AnimatedHand::get_hand_angles(const
     std::vector<double>& joint_angles)
 {
     // Initialize euler container
-    std::vector<Eigen::Vector3d> euler_vec;
+    HandAngles euler_arr;
+
+    // Generate euler angles
+    get_hand_angles(joint_angles, euler_arr);
+
+    return std::vector<Eigen::Vector3d>(euler_arr.begin(), euler_arr.end());
+}
+
+/**
+ * @brief Generates the euler angles of the hand frames without allocating
+ * (see the overload on a pointer).
+ * @param joint_angles The joint angles of the glove channels (rad).
+ * @param euler_arr The output euler angles of the hand frames.
+ */
+void AnimatedHand::get_hand_angles(const std::vector<double>& joint_angles,
+    HandAngles& euler_arr)
+{
+    // Check number of channels
+    if (joint_angles.size() < m_channels_num)
+    {
+        throw std::out_of_range("AnimatedHand: not enough joint angles");
+    }
+
+    get_hand_angles(joint_angles.data(), euler_arr);
+}
 
+/**
+ * @brief Generates the euler angles of the hand frames without allocating.
+ * The default glove topology is scattered with straight-line code, while
+ * custom channel maps (see #set_channel_map) go through the precompiled
+ * scatter table.
+ * @param joint_angles Pointer to the joint angles of the glove channels
+ * (rad, one per channel, e.g. a column of the samples handed over by
+ * Exoskeleton::get_joint_samples).
+ * @param euler_arr The output euler angles of the hand frames.
+ */
+void AnimatedHand::get_hand_angles(const double* joint_angles,
+    HandAngles& euler_arr)
+{
     // Zero all euler angles
-    for (size_t i = 0; i < m_hand_frames_num; i++)
+    for (auto& euler : euler_arr) { euler.setZero(); }
+
+    // Default topology
+    if (!m_custom_map)
+    {
+        scatter_default(joint_angles, euler_arr,
+            std::make_index_sequence<channels_num>{});
+        return;
+    }
+
+    // Custom topology
+    for (const auto& entry : m_scatter_table)
+    {
+        euler_arr[entry.frame_id](entry.axis) =
+            entry.gain * joint_angles[entry.channel] + entry.offset;
+    }
+}
+
+/**
+ * @brief Generates the joint angles of the glove channels that map to the
+ * given hand angles (inverse of #get_hand_angles), e.g. to write the hand
+ * angles solved from fingertip positions as a glove session (see HandIK::).
+ * The axes that are not driven by a channel are ignored.
+ * @param euler_arr The euler angles of the hand frames.
+ * @param joint_angles The joint angles of the glove channels (rad, resized
+ * to #get_channels_num).
+ */
+void AnimatedHand::get_joint_angles(const HandAngles& euler_arr,
+    std::vector<double>& joint_angles)
+{
+    joint_angles.assign(m_channels_num, 0.0);
+
+    // Default topology
+    if (!m_custom_map)
+    {
+        for (size_t i = 0; i < channels_num; i++)
+        {
+            const HandMap& map_i = default_hand_map[i];
+            joint_angles.at(i) = map_i.rot_dir *
+                euler_arr[map_i.frame_id](map_i.rot_type);
+        }
+        return;
+    }
+
+    // Custom topology
+    for (const auto& entry : m_scatter_table)
+    {
+        if (entry.gain == 0.0) { continue; }
+        joint_angles.at(entry.channel) =
+            (euler_arr[entry.frame_id](entry.axis) - entry.offset) / entry.gain;
+    }
+}
+
+/**
+ * @brief Returns the axes of the hand frames that are driven by a glove
+ * channel with a nonzero gain (the other axes are not inverted by
+ * #get_joint_angles and stay at zero, see #get_hand_angles).
+ * @return HandAxes Whether each axis (roll, pitch, yaw) of each hand frame
+ * is driven.
+ */
+AnimatedHand::HandAxes AnimatedHand::get_driven_axes(void)
+{
+    HandAxes driven_axes{};
+
+    // Default topology
+    if (!m_custom_map)
     {
-        euler_vec.push_back(Eigen::Vector3d(0.0, 0.0, 0.0));
+        for (const auto& map_i : default_hand_map)
+        {
+            driven_axes[map_i.frame_id][map_i.rot_type] = true;
+        }
+        return driven_axes;
     }
-    
-    // Set euler angles
-    for(size_t i = 0; i < m_hand_map.size(); i++)
+
+    // Custom topology
+    for (const auto& entry : m_scatter_table)
     {
-        // Get hand map i
-        HandMap config_i = m_hand_map.at(i);
-        
-        // Define euler vector
-        euler_vec.at(config_i.frame_id)(config_i.rot_type) = 
-            config_i.rot_dir * joint_angles.at(i);
+        if (entry.gain == 0.0) { continue; }
+        driven_axes[entry.frame_id][entry.axis] = true;
+    }
+    return driven_axes;
+}
+
+/**
+ * @brief Returns the direction in which each glove channel turns the axis
+ * of the hand frame it drives: 1 if a positive reading is a positive angle
+ * of the axis, -1 otherwise (rot_dir of the default topology, sign of the
+ * gain of a custom one). A channel that drives several axes takes the
+ * direction of the first one, and a channel that drives none is positive.
+ * @return std::vector<double> The sign of each channel
+ * (#get_channels_num).
+ */
+std::vector<double> AnimatedHand::get_channel_signs(void)
+{
+    std::vector<double> channel_signs(m_channels_num, 1.0);
+
+    // Default topology
+    if (!m_custom_map)
+    {
+        for (size_t i = 0; i < channels_num; i++)
+        {
+            channel_signs.at(i) = default_hand_map[i].rot_dir < 0.0 ?
+                -1.0 : 1.0;
+        }
+        return channel_signs;
+    }
+
+    // Custom topology (first driven axis of each channel)
+    for (auto entry = m_scatter_table.rbegin();
+        entry != m_scatter_table.rend(); entry++)
+    {
+        if (entry->gain == 0.0) { continue; }
+        channel_signs.at(entry->channel) = entry->gain < 0.0 ? -1.0 : 1.0;
+    }
+    return channel_signs;
+}
+
+/**
+ * @brief Replaces the default glove topology with a custom one.
+ * @param hand_map The custom hand map (entry i is driven by channel i).
+ */
+void AnimatedHand::set_hand_map(const std::vector<HandMap>& hand_map)
+{
+    // Initialize channel map
+    std::vector<ChannelMap> channel_map;
+
+    for (size_t i = 0; i < hand_map.size(); i++)
+    {
+        channel_map.push_back(ChannelMap{(int) i, hand_map.at(i).frame_id,
+            hand_map.at(i).rot_type, hand_map.at(i).rot_dir, 0.0, 1.0});
+    }
+
+    set_channel_map(channel_map);
+}
+
+/**
+ * @brief Compiles a channel map into the flat scatter table that is used
+ * on every frame. Sign and scale are folded into a single gain. If the
+ * channel map is identical to the default topology the straight-line
+ * default path is kept.
+ * @param channel_map The channel map.
+ */
+void AnimatedHand::set_channel_map(const std::vector<ChannelMap>& channel_map)
+{
+    // Initialize scatter table
+    std::vector<ScatterEntry> scatter_table;
+
+    // Number of channels
+    size_t channels = 0;
+
+    // Whether the map describes the default topology
+    bool is_default = (channel_map.size() == channels_num);
+
+    for (size_t i = 0; i < channel_map.size(); i++)
+    {
+        // Get channel map i
+        const ChannelMap& config_i = channel_map.at(i);
+
+        // Validate channel map
+        if (config_i.index < 0 || config_i.frame_id < 0 ||
+            config_i.frame_id >= (int) frames_num ||
+            config_i.axis < 0 || config_i.axis > 2)
+        {
+            throw std::invalid_argument("AnimatedHand: invalid channel map");
+        }
+
+        // Push back scatter entry
+        scatter_table.push_back(ScatterEntry{config_i.index, config_i.frame_id,
+            config_i.axis, config_i.sign * config_i.scale, config_i.offset});
+
+        // Update number of channels
+        channels = std::max(channels, (size_t) config_i.index + 1);
+
+        // Compare with default topology
+        if (is_default)
+        {
+            const HandMap& default_i = default_hand_map[i];
+            is_default = config_i.index == (int) i &&
+                config_i.frame_id == default_i.frame_id &&
+                config_i.axis == default_i.rot_type &&
+                config_i.sign * config_i.scale == default_i.rot_dir &&
+                config_i.offset == 0.0;
+        }
+    }
+
+    m_scatter_table = scatter_table;
+    m_channels_num = channels;
+    m_custom_map = !is_default;
+}
+
+/**
+ * @brief Returns the one-euro filter parameters of the glove channels, as 
+ * given by the "MinCutoff", "Beta" and "DCutoff" entries of the channels in 
+ * the glove configuration file. Channels without parameters are not 
+ * filtered.
+ * @return std::vector<OneEuroFilter::Parameters> The parameters of each 
+ * channel (#get_channels_num).
+ */
+std::vector<OneEuroFilter::Parameters> AnimatedHand::get_filter_parameters(void)
+{
+    std::vector<OneEuroFilter::Parameters> filter_parameters =
+        m_filter_parameters;
+    filter_parameters.resize(m_channels_num,
+        OneEuroFilter::Parameters{0.0, 0.0, 1.0});
+
+    return filter_parameters;
+}
+
+/**
+ * @brief Simply parses the glove configuration file.
+ *
+ * @param json_file The json file.
+ * @return std::vector<AnimatedHand::ChannelMap> The channel map.
+ */
+std::vector<AnimatedHand::ChannelMap> AnimatedHand::parse_json_file(
+    const nlohmann::json& json_file)
+{
+    // Get selected revision
+    std::string revision = json_file["Revision"];
+
+    // Get channels and width of the sequence counter
+    auto channels_json = json_file[revision]["Channels"];
+    m_sequence_bits = json_file[revision].value("SequenceBits", 64u);
+
+    // Initialize channel map
+    std::vector<ChannelMap> channel_map;
+
+    // Initialize filter parameters
+    m_filter_parameters.clear();
+
+    for (size_t i = 0; i < channels_json.size(); i++)
+    {
+        auto channel_json = channels_json.at(i);
+
+        // Filter parameters of the channel
+        size_t index = channel_json.at("Index");
+        if (m_filter_parameters.size() <= index)
+        {
+            m_filter_parameters.resize(index + 1,
+                OneEuroFilter::Parameters{0.0, 0.0, 1.0});
+        }
+        m_filter_parameters.at(index) = OneEuroFilter::Parameters{
+            channel_json.value("MinCutoff", 0.0),
+            channel_json.value("Beta", 0.0),
+            channel_json.value("DCutoff", 1.0)};
+
+        channel_map.push_back(ChannelMap{
+            channel_json.at("Index"),
+            channel_json.at("Frame"),
+            channel_json.at("Axis"),
+            channel_json.value("Sign", 1.0),
+            channel_json.value("Offset", 0.0),
+            channel_json.value("Scale", 1.0)});
     }
 
-    return euler_vec;
-}
\ No newline at end of file
+    return channel_map;
+}
@@ -0,0 +1,380 @@
+#include "../include/clock_sync.h"
+
+/**
+ * @brief Initializes the sliding window.
+ * @param tick_period The nominal tick period of the device (s). It is only
+ * used to express the drift in ppm.
+ * @param window The number of arrivals of the sliding window.
+ */
+void ClockSync::initialize(double tick_period, size_t window)
+{
+    m_tick_period = tick_period;
+    m_host.assign(std::max(window, m_min_fit_samples), 0.0);
+    m_ticks.assign(m_host.size(), NAN);
+    m_front_hull.assign(m_host.size(), 0);
+    m_back_hull.assign(m_host.size(), 0);
+    m_front_undo_position.assign(m_host.size(), 0);
+    m_front_undo_vertex.assign(m_host.size(), 0);
+    m_head = 0;
+    m_size = 0;
+    m_rebase_countdown = 0;
+    m_statistics = Statistics();
+}
+
+/**
+ * @brief Adds the arrival of a line without device tick (only the
+ * inter-arrival statistics are updated).
+ * @param host_time The host arrival time (s).
+ * @return double The host arrival time (s).
+ */
+double ClockSync::add_arrival(double host_time)
+{
+    return add_arrival(host_time, NAN);
+}
+
+/**
+ * @brief Adds the arrival of a line stamped with a device tick and returns
+ * its send time mapped to the host clock. A tick that goes backwards
+ * (device reset or wrap-around) restarts the fit. Until enough ticked
+ * arrivals are available, the host arrival time is returned.
+ * @param host_time The host arrival time (s).
+ * @param device_tick The device tick (NaN if the line carries no tick).
+ * @return double The mapped host time (s).
+ */
+double ClockSync::add_arrival(double host_time, double device_tick)
+{
+    // Restart on device reset
+    if (m_size > 0 && !std::isnan(device_tick) &&
+        device_tick <= m_ticks.at(idx(m_size - 1)))
+    {
+        m_size = 0;
+        m_rebase_countdown = 0;
+    }
+
+    // Evict oldest arrival
+    if (m_size == m_host.size())
+    {
+        if (m_rebase_countdown > 0)
+        {
+            add_point(0, -1.0);
+            add_interval(1, -1.0);
+        }
+        m_size--;
+    }
+
+    // Push arrival
+    m_host.at(m_head) = host_time;
+    m_ticks.at(m_head) = device_tick;
+    m_head = (m_head + 1) % m_host.size();
+    m_size++;
+
+    // Update running sums
+    if (m_rebase_countdown == 0)
+    {
+        rebase();
+    }
+    else
+    {
+        add_point(m_size - 1, 1.0);
+        add_interval(m_size - 1, 1.0);
+        m_rebase_countdown--;
+    }
+
+    // Update fit and statistics
+    update();
+
+    if (std::isnan(device_tick) || !m_statistics.is_synchronized)
+    {
+        return host_time;
+    }
+
+    return map(device_tick);
+}
+
+/**
+ * @brief Maps a device tick to the host clock (lower envelope of the
+ * arrivals, i.e. send time plus the minimum delay).
+ * @param device_tick The device tick.
+ * @return double The host time (s).
+ */
+double ClockSync::map(double device_tick)
+{
+    return m_host_ref + m_slope * (device_tick - m_tick_ref);
+}
+
+/**
+ * @brief Recomputes the running sums of the window relative to its oldest
+ * arrival (and to its first ticked arrival), so the large absolute values
+ * of the clocks and the rounding errors of the additions and subtractions
+ * do not cost precision. The ticked arrivals are pushed into the front hull
+ * from the newest one (Andrew's monotone chain), recording what each push
+ * overwrote, and the back hull is emptied. The window is rebased once per
+ * window length, so the arrivals of the front hull are the ones that are
+ * evicted until the next rebase. The range of the intervals is scanned
+ * again by the next update.
+ */
+void ClockSync::rebase(void)
+{
+    m_sum_host_ref = m_host.at(idx(0));
+    m_sum_tick_ref = NAN;
+    m_interval_sum = 0.0;
+    m_interval_sum_sq = 0.0;
+    m_device_sum = 0.0;
+    m_device_sum_sq = 0.0;
+    m_device_intervals = 0;
+    m_sx = 0.0; m_sy = 0.0; m_sxx = 0.0; m_sxy = 0.0; m_syy = 0.0;
+    m_ticked = 0;
+
+    // Running sums (the back hull is discarded)
+    for (size_t i = 0; i < m_size; i++)
+    {
+        add_point(i, 1.0);
+        add_interval(i, 1.0);
+    }
+    m_back_size = 0;
+
+    // Front hull
+    m_front_size = 0;
+    m_front_pushes = 0;
+    for (size_t j = m_size; j-- > 0;)
+    {
+        size_t i = idx(j);
+        if (std::isnan(m_ticks.at(i))) { continue; }
+
+        while (m_front_size >= 2 && cross(i, m_front_hull.at(m_front_size -
+            1), m_front_hull.at(m_front_size - 2)) <= 0.0)
+        {
+            m_front_size--;
+        }
+        m_front_undo_position.at(m_front_pushes) = m_front_size;
+        m_front_undo_vertex.at(m_front_pushes) =
+            m_front_hull.at(m_front_size);
+        m_front_pushes++;
+        m_front_hull.at(m_front_size++) = i;
+    }
+
+    m_is_interval_range_stale = true;
+    m_rebase_countdown = m_host.size();
+}
+
+/**
+ * @brief Adds or subtracts a ticked arrival to the sums of the fit and to
+ * the lower hulls (arrivals without tick are ignored). The first ticked
+ * arrival after a rebase sets the tick reference. The arrivals are added
+ * newest last, so an added arrival is pushed into the back hull, and
+ * subtracted oldest first, so a subtracted one is the last push into the
+ * front hull, which is undone.
+ * @param i The arrival of the window (0 is the oldest one).
+ * @param sign 1 to add the arrival, -1 to subtract it.
+ */
+void ClockSync::add_point(size_t i, double sign)
+{
+    double tick = m_ticks.at(idx(i));
+    if (std::isnan(tick)) { return; }
+    if (std::isnan(m_sum_tick_ref)) { m_sum_tick_ref = tick; }
+
+    double x = tick - m_sum_tick_ref, y = m_host.at(idx(i)) - m_sum_host_ref;
+    m_sx += sign * x;
+    m_sy += sign * y;
+    m_sxx += sign * x * x;
+    m_sxy += sign * x * y;
+    m_syy += sign * y * y;
+
+    if (sign < 0.0)
+    {
+        m_ticked--;
+        if (m_front_pushes == 0) { return; }
+
+        // Undo push into front hull (its size was the one after the
+        // previous push)
+        m_front_pushes--;
+        size_t position = m_front_undo_position.at(m_front_pushes);
+        m_front_hull.at(position) = m_front_undo_vertex.at(m_front_pushes);
+        m_front_size = m_front_pushes > 0 ?
+            m_front_undo_position.at(m_front_pushes - 1) + 1 : 0;
+        return;
+    }
+
+    m_ticked++;
+
+    // Push into back hull
+    while (m_back_size >= 2 && cross(m_back_hull.at(m_back_size - 2),
+        m_back_hull.at(m_back_size - 1), idx(i)) <= 0.0)
+    {
+        m_back_size--;
+    }
+    m_back_hull.at(m_back_size++) = idx(i);
+}
+
+/**
+ * @brief Adds or subtracts the interval that ends at an arrival to the sums
+ * of the host intervals and, if both arrivals are ticked, of the device
+ * intervals. An added interval extends the range of the intervals, and a
+ * subtracted one on the boundary of the range makes it stale.
+ * @param i The arrival of the window (0 is the oldest one, which ends no
+ * interval).
+ * @param sign 1 to add the interval, -1 to subtract it.
+ */
+void ClockSync::add_interval(size_t i, double sign)
+{
+    if (i == 0 || i >= m_size) { return; }
+
+    Statistics& stats = m_statistics;
+    double interval = m_host.at(idx(i)) - m_host.at(idx(i - 1));
+    m_interval_sum += sign * interval;
+    m_interval_sum_sq += sign * interval * interval;
+
+    if (!m_is_interval_range_stale && sign > 0.0)
+    {
+        stats.interval_min = std::min(stats.interval_min, interval);
+        stats.interval_max = std::max(stats.interval_max, interval);
+    }
+    else if (interval <= stats.interval_min || interval >= stats.interval_max)
+    {
+        m_is_interval_range_stale = true;
+    }
+
+    double device_interval = (m_ticks.at(idx(i)) -
+        m_ticks.at(idx(i - 1))) * m_tick_period;
+    if (!std::isnan(device_interval))
+    {
+        m_device_sum += sign * device_interval;
+        m_device_sum_sq += sign * device_interval * device_interval;
+        if (sign > 0.0) { m_device_intervals++; }
+        else { m_device_intervals--; }
+    }
+}
+
+/**
+ * @brief Scans the window for the minimum and maximum host intervals.
+ */
+void ClockSync::scan_intervals(void)
+{
+    Statistics& stats = m_statistics;
+    stats.interval_min = INFINITY;
+    stats.interval_max = 0.0;
+    for (size_t i = 1; i < m_size; i++)
+    {
+        double interval = m_host.at(idx(i)) - m_host.at(idx(i - 1));
+        stats.interval_min = std::min(stats.interval_min, interval);
+        stats.interval_max = std::max(stats.interval_max, interval);
+    }
+    m_is_interval_range_stale = false;
+}
+
+/**
+ * @brief Computes the cross product of two ticked arrivals relative to a
+ * third one (tick on the x axis, host time on the y axis).
+ * @param a The ring index of the origin arrival.
+ * @param b The ring index of the first arrival.
+ * @param c The ring index of the second arrival.
+ * @return double The cross product (positive if a, b and c turn
+ * counterclockwise, i.e. b is below the segment from a to c).
+ */
+double ClockSync::cross(size_t a, size_t b, size_t c)
+{
+    return (m_ticks.at(b) - m_ticks.at(a)) * (m_host.at(c) - m_host.at(a)) -
+        (m_host.at(b) - m_host.at(a)) * (m_ticks.at(c) - m_ticks.at(a));
+}
+
+/**
+ * @brief Finds the vertex of a lower hull with the lowest envelope for a
+ * slope. The envelope is convex along the hull, so the vertex is found by
+ * binary search.
+ * @param hull The ring indices of the vertices of the hull.
+ * @param size The number of vertices (at least 1).
+ * @param slope The slope of the fit.
+ * @return size_t The ring index of the vertex.
+ */
+size_t ClockSync::get_envelope_vertex(const std::vector<size_t>& hull,
+    size_t size, double slope)
+{
+    size_t first = 0, last = size - 1;
+    while (first < last)
+    {
+        size_t k = (first + last) / 2;
+        if (get_envelope(hull.at(k + 1), slope) <
+            get_envelope(hull.at(k), slope))
+        {
+            first = k + 1;
+        }
+        else
+        {
+            last = k;
+        }
+    }
+    return hull.at(first);
+}
+
+/**
+ * @brief Updates the inter-arrival statistics and, if enough arrivals carry
+ * a device tick, the fit of host time against device ticks from the running
+ * sums. The residual spread follows from the sums as well, and the lower
+ * envelope is the lowest of the envelope vertices of the two hulls.
+ */
+void ClockSync::update(void)
+{
+    Statistics& stats = m_statistics;
+    stats.samples = m_size;
+
+    // Inter-arrival intervals
+    size_t intervals = m_size > 0 ? m_size - 1 : 0;
+    if (intervals > 0)
+    {
+        stats.interval_mean = m_interval_sum / intervals;
+        stats.interval_std = sqrt(std::max(m_interval_sum_sq / intervals -
+            stats.interval_mean * stats.interval_mean, 0.0));
+        if (m_is_interval_range_stale) { scan_intervals(); }
+    }
+    else
+    {
+        stats.interval_min = 0.0;
+        stats.interval_max = 0.0;
+        m_is_interval_range_stale = true;
+    }
+
+    if (m_device_intervals > 0)
+    {
+        double device_mean = m_device_sum / m_device_intervals;
+        stats.device_interval_std = sqrt(std::max(m_device_sum_sq /
+            m_device_intervals - device_mean * device_mean, 0.0));
+    }
+
+    // Not enough ticked arrivals
+    double n = m_ticked;
+    double denominator = n * m_sxx - m_sx * m_sx;
+    if (m_ticked < m_min_fit_samples || denominator <= 0.0)
+    {
+        stats.is_synchronized = false;
+        return;
+    }
+
+    // Least squares fit and residuals (their mean is zero)
+    double slope = (n * m_sxy - m_sx * m_sy) / denominator;
+    double intercept = (m_sy - slope * m_sx) / n;
+    double residual_sum_sq = m_syy - intercept * m_sy - slope * m_sxy;
+
+    // Lower envelope
+    size_t envelope = m_front_size > 0 ?
+        get_envelope_vertex(m_front_hull, m_front_size, slope) :
+        get_envelope_vertex(m_back_hull, m_back_size, slope);
+    if (m_front_size > 0 && m_back_size > 0)
+    {
+        size_t back = get_envelope_vertex(m_back_hull, m_back_size, slope);
+        if (get_envelope(back, slope) < get_envelope(envelope, slope))
+        {
+            envelope = back;
+        }
+    }
+
+    // Set mapping
+    m_slope = slope;
+    m_tick_ref = m_sum_tick_ref;
+    m_host_ref = m_host.at(envelope) -
+        slope * (m_ticks.at(envelope) - m_sum_tick_ref);
+
+    // Set statistics
+    stats.residual_std = sqrt(std::max(residual_sum_sq / n, 0.0));
+    stats.drift_ppm = (m_tick_period / slope - 1.0) * 1e6;
+    stats.is_synchronized = true;
+}
@@ -1,23 +1,80 @@
 #include "../include/exoskeleton.h"
 
 /**
- * @brief It initialiazes the serial communication and sets the asychronous 
- * callback function. See https://en.cppreference.com/w/cpp/thread/async.
+ * @brief It initialiazes the serial communication and starts the acquisition 
+ * thread, which runs the asychronous callback function until the 
+ * exoskeleton is stopped (see #stop).
  * 
  * @param serial_com The serial communication port.
  * @param serial_baudrate The serial communication baudrate.
+ * @param meas_num The number of channels of the glove (see
+ * AnimatedHand::get_channels_num).
+ * @param filter_parameters The filter parameters of the channels (see 
+ * AnimatedHand::get_filter_parameters). Missing channels are not filtered.
+ * @param acquisition_parameters The scheduling parameters of the acquisition 
+ * thread (see ThreadScheduler::).
+ * @param sequence_bits The width of the sequence counter of the glove (see
+ * AnimatedHand::get_sequence_bits).
  */
 void Exoskeleton::initialize(const std::string& serial_com,
-    unsigned int serial_baudrate)
+    unsigned int serial_baudrate, int meas_num,
+    const std::vector<OneEuroFilter::Parameters>& filter_parameters,
+    const ThreadScheduler::Parameters& acquisition_parameters,
+    unsigned int sequence_bits)
 {
+    // Stop previous stream
+    stop();
+
+    // Set measurements num
+    m_meas_num = meas_num;
+
+    // Install calibrations set before the stream starts (identity until one 
+    // is set)
+    install_calibration();
+    hand_over_calibration();
+    install_calibration();
+    if (m_calibration.get_channels_num() != (size_t) m_meas_num)
+    {
+        m_calibration.initialize(std::vector<JointCalibration::Parameters>(
+            m_meas_num));
+    }
+
+    // Initialize filter
+    std::vector<OneEuroFilter::Parameters> parameters = filter_parameters;
+    parameters.resize(m_meas_num, OneEuroFilter::Parameters{0.0, 0.0, 1.0});
+    m_filter.initialize(parameters);
+
+    // Set scheduling parameters of the acquisition thread
+    m_acquisition_parameters = acquisition_parameters;
+
+    // Initialize clock synchronization
+    m_clock_sync.initialize();
+
+    // Zero sensor data until the first complete line arrives
+    m_raw_sensor_data = std::vector<double>(m_meas_num, 0.0);
+
+    // Preallocate pending samples
+    m_pending_samples.assign(m_max_pending_samples, PendingSample{
+        JointSample{0.0, 0.0, std::vector<double>(m_meas_num, 0.0)},
+        ClockSync::Statistics()});
+    m_pending_head = 0;
+    m_pending_tail = 0;
+
     // Generate serial communication channel
     m_serial = std::make_shared<SerialCOM>(serial_com, serial_baudrate);
 
     // Initialize stream
     m_serial->initialize_stream();
 
-    // Initialize asychronous function
-    m_future_fun = std::async(&Exoskeleton::incoming_data_callback, this);
+    // Initialize health counters
+    m_stream_health.initialize(Utils::monotonic_time(), 1.0, sequence_bits);
+    m_serial->get_overrun_counters(m_overrun_baseline,
+        m_buffer_overrun_baseline);
+
+    // Start acquisition thread
+    m_is_stopped = false;
+    m_acquisition_thread = std::thread(&Exoskeleton::incoming_data_callback,
+        this);
 }
 
 /**
@@ -31,43 +88,266 @@ void Exoskeleton::initialize(const std::string& serial_com,
  *          \right]^{T}
  * \f]
  *   \image html hand_kinematics.png width=600px
- * @return std::vector<double> The raw angle data coming from the exoskeleton board.
- * 
+ * An extra trailing value is the device tick of the line, which is mapped 
+ * to the host clock (see ClockSync::), and a second one is the sequence 
+ * counter of the line, which reveals lost lines (see StreamHealth::). Lines 
+ * that are malformed, short or overlong are counted and dropped. Each 
+ * valid sample is calibrated and clamped to the joint limits (see 
+ * JointCalibration::), then smoothed by the one-euro filter of the channels 
+ * (see OneEuroFilter::) before it is published to the animation loop with 
+ * its timestamp. It runs on the acquisition thread for the whole stream, so 
+ * its scheduling parameters are applied once (see ThreadScheduler::apply). 
+ * It returns when the exoskeleton is stopped (checked at least every 
+ * #m_poll_timeout) or when the serial port fails (e.g. the glove is 
+ * unplugged).
+ */
+void Exoskeleton::incoming_data_callback(void)
+{
+    // Apply scheduling parameters
+    m_acquisition_status = ThreadScheduler::apply(m_acquisition_parameters);
+    m_is_running.store(true, std::memory_order_release);
+
+    try
+    {
+        while (!m_is_stopped.load(std::memory_order_relaxed))
+        {
+            // Wait for a line, checking the termination flag meanwhile
+            if (!m_serial->wait_readable(m_poll_timeout)) { continue; }
+
+            // Read line and its arrival time
+            double arrival_time;
+            bool is_complete = m_serial->readLine(m_line, arrival_time);
+
+            // Parse and classify line
+            double tick, sequence;
+            StreamHealth::LineStatus status = StreamHealth::parse_line(
+                m_line, is_complete, m_meas_num, m_line_data, tick,
+                sequence);
+            m_stream_health.add_line(status);
+
+            // Sample time (mapped device tick if the line carries one)
+            double sample_time = m_clock_sync.add_arrival(arrival_time,
+                tick);
+
+            // Keep only lines that carry every channel of the glove
+            if (status != StreamHealth::LineStatus::Valid) { continue; }
+
+            // Check sequence counter
+            if (!std::isnan(sequence))
+            {
+                m_stream_health.add_sequence((uint64_t) sequence);
+            }
+
+            // Calibrate and filter sample at sensor rate (before it is 
+            // published)
+            install_calibration();
+            m_calibration.apply(m_line_data);
+            m_filter.filter(m_line_data, sample_time - m_prev_sample_time);
+            m_prev_sample_time = sample_time;
+
+            // Publish timestamped sample (dropped if the ring is full)
+            size_t head = m_pending_head.load(std::memory_order_relaxed);
+            if (head - m_pending_tail.load(std::memory_order_acquire) ==
+                m_pending_samples.size())
+            {
+                m_stream_health.add_dropped();
+                continue;
+            }
+
+            PendingSample& pending = m_pending_samples.at(head %
+                m_pending_samples.size());
+            pending.sample.time = sample_time;
+            pending.sample.arrival_time = arrival_time;
+            std::copy(m_line_data.begin(), m_line_data.end(),
+                pending.sample.joint_angles.begin());
+            pending.timing = m_clock_sync.get_statistics();
+            m_pending_head.store(head + 1, std::memory_order_release);
+        }
+    }
+    catch (const boost::system::system_error& error)
+    {
+        std::cerr << "[Exoskeleton] Serial port: " << error.what() <<
+            std::endl;
+    }
+}
+
+/**
+ * @brief It stops the acquisition thread and waits for it to return (at 
+ * most #m_poll_timeout, or the end of the line being read). It is called by 
+ * the destructor.
+ */
+void Exoskeleton::stop(void)
+{
+    m_is_stopped = true;
+    if (m_acquisition_thread.joinable()) { m_acquisition_thread.join(); }
+}
+
+/**
+ * @brief It returns a snapshot of the health counters of the stream (see 
+ * StreamHealth::). The counters are lock-free, so it does not wait for the 
+ * acquisition thread. It also reads the UART overrun counters.
+ * @return StreamHealth::Statistics The health counters.
+ */
+StreamHealth::Statistics Exoskeleton::get_stream_health(void)
+{
+    // UART overruns since the port was opened
+    int overrun, buf_overrun;
+    if (m_serial && m_serial->get_overrun_counters(overrun, buf_overrun))
+    {
+        m_stream_health.set_overrun_counters(overrun - m_overrun_baseline,
+            buf_overrun - m_buffer_overrun_baseline);
+    }
+
+    return m_stream_health.get_statistics(Utils::monotonic_time());
+}
+
+/**
+ * @brief It hands over the samples published by the acquisition thread 
+ * since the previous call, oldest first, and frees their slots of the ring 
+ * buffer. It also hands over the timing statistics at the arrival of the 
+ * newest sample and the scheduling status of the acquisition thread.
+ * @param head The head of the ring buffer (loaded by the caller, samples 
+ * published later are handed over on the next call).
+ * @param function The function called with each sample (const 
+ * JointSample&).
  */
-std::vector<double> Exoskeleton::incoming_data_callback(void)
+template <typename Function>
+void Exoskeleton::take_pending_samples(size_t head, Function function)
 {
-    while(!m_return_value)
+    size_t tail = m_pending_tail.load(std::memory_order_relaxed);
+    for (size_t i = tail; i < head; i++)
+    {
+        const PendingSample& pending = m_pending_samples.at(i %
+            m_pending_samples.size());
+        function(pending.sample);
+
+        // Keep latest sample
+        if (i + 1 == head)
+        {
+            m_timing_statistics = pending.timing;
+            std::copy(pending.sample.joint_angles.begin(),
+                pending.sample.joint_angles.end(), m_raw_sensor_data.begin());
+        }
+    }
+    m_pending_tail.store(head, std::memory_order_release);
+
+    // Hand over scheduling status once it is applied
+    if (m_is_running.load(std::memory_order_acquire))
     {
-        m_raw_sensor_data =
-            Utils::analog_str_buf_to_double_vec(m_serial->readLine());
+        m_scheduling_status = m_acquisition_status;
     }
-    return m_raw_sensor_data;
 }
 
 /**
  * @brief It is the point of entry that feeds the animation
  * loop with the exoskeleton data. It returns a vector
- * of the raw jont angle data converted to radians. It also manages the 
- * asynchronous threading.
+ * of the latest jont angle data (calibrated and filtered on the acquisition 
+ * thread) converted to radians, or the previous ones if no sample has 
+ * arrived since the previous call. It hands over (and discards) the 
+ * pending samples, so it is an alternative to #get_joint_samples.
  * @return std::vector<double>  The joint angles.
  */
 std::vector<double> Exoskeleton::get_joint_angles(void)
 {
-    // Set termination flag for asychronous function
-    m_return_value = 1;
-
-    // Get joint angles from future function
-    std::vector<double> joint_angles = m_future_fun.get();
+    // Take pending samples, keeping the latest one
+    take_pending_samples(m_pending_head.load(std::memory_order_acquire),
+        [](const JointSample&) {});
+    hand_over_calibration();
 
     // Convert to rad
+    std::vector<double> joint_angles = m_raw_sensor_data;
     for (size_t i = 0; i < joint_angles.size(); i++)
     {
         joint_angles.at(i) = Utils::deg2rad(joint_angles.at(i));
     }
 
-    // Reinitialize async function
-    m_return_value = 0;
-    m_future_fun = std::async(&Exoskeleton::incoming_data_callback, this);
-
     return joint_angles;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief It returns the timestamped samples (joint angles converted to 
+ * radians) that have arrived since the previous call, oldest first (see 
+ * PoseHistory::). The samples are taken from the ring buffer of the 
+ * acquisition thread, which keeps running, so the call neither locks nor 
+ * waits for the serial port. The number of samples changes from frame to 
+ * frame, so they are copied to a matrix of the frame arena (see 
+ * FrameArena::) instead of a container that would be reallocated.
+ * @param arena The frame arena of the caller.
+ * @return Eigen::Map<Eigen::MatrixXd> The samples, one column per sample 
+ * (rows #time_row, #arrival_time_row, then the joint angles from 
+ * #joint_angles_row). It is valid until the arena is reset.
+ */
+Eigen::Map<Eigen::MatrixXd> Exoskeleton::get_joint_samples(FrameArena& arena)
+{
+    // Samples published so far (more can arrive while they are copied, 
+    // they are handed over on the next call)
+    size_t head = m_pending_head.load(std::memory_order_acquire);
+
+    // Hand over pending samples (oldest first)
+    Eigen::Map<Eigen::MatrixXd> samples = arena.matrix(
+        joint_angles_row + m_meas_num,
+        head - m_pending_tail.load(std::memory_order_relaxed));
+    Eigen::Index i = 0;
+    take_pending_samples(head, [&](const JointSample& sample) {
+        samples(time_row, i) = sample.time;
+        samples(arrival_time_row, i) = sample.arrival_time;
+
+        // Convert to rad
+        for (int j = 0; j < m_meas_num; j++)
+        {
+            samples(joint_angles_row + j, i) = Utils::deg2rad(
+                sample.joint_angles.at(j));
+        }
+        i++; });
+
+    // Hand over queued calibration
+    hand_over_calibration();
+
+    return samples;
+}
+
+/**
+ * @brief It sets the calibration of the channels (see JointCalibration::), 
+ * e.g. after the calibration file has been edited. The calibration is 
+ * loaded by the caller and installed by the acquisition thread before its 
+ * next sample (see #install_calibration), so the stream is not paused and 
+ * the acquisition thread neither parses nor allocates. If the previous 
+ * calibration has not been installed yet, the new one is queued and handed 
+ * over on the next call of #get_joint_samples.
+ * @param calibration The calibration (one channel per glove channel).
+ */
+void Exoskeleton::set_calibration(const JointCalibration& calibration)
+{
+    m_queued_calibration = calibration;
+    m_calibration_queued = 1;
+    hand_over_calibration();
+}
+
+/**
+ * @brief It hands the queued calibration over to the acquisition thread, 
+ * unless the previous one is still pending (UI thread).
+ */
+void Exoskeleton::hand_over_calibration(void)
+{
+    if (!m_calibration_queued ||
+        m_calibration_pending.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    std::swap(m_next_calibration, m_queued_calibration);
+    m_calibration_queued = 0;
+    m_calibration_pending.store(true, std::memory_order_release);
+}
+
+/**
+ * @brief It installs the pending calibration, if any (acquisition thread, 
+ * or before it is started).
+ */
+void Exoskeleton::install_calibration(void)
+{
+    if (!m_calibration_pending.load(std::memory_order_acquire)) { return; }
+
+    std::swap(m_calibration, m_next_calibration);
+    m_calibration_pending.store(false, std::memory_order_release);
+}
@@ -2,41 +2,65 @@
 
 /**
  * @brief This initialization function first parses the finger configuration 
- * file (see Hand::m_config_rel_path) and sets up the properties of the finger.
- * It also loads and processes the meshes for the links and the joints and 
- * initializes the finger state.
+ * file (see HandKinematics::m_config_rel_path) and sets up the properties of 
+ * the finger.
+ * It also loads and processes the meshes for the links and the joints (or 
+ * maps them from the mesh cache, see MeshCache::) and initializes the finger 
+ * state. If the meshes are not loaded, only the kinematics of the finger 
+ * are computed (e.g. when the meshes are drawn as instances, see 
+ * InstancedMesh::). The finger does not depend on the viewer, the meshes 
+ * are added to it by Hand::.
  * @param name_id The name id of the finger.
  * @param json_file The json finger configuration file.
- * @param viewer Pointer to the viewer handle.
- * @param mesh_idx The mesh index.
+ * @param load_meshes Whether the meshes are loaded.
+ * @param root_transform The root transform of the finger chain (see
+ * #m_root_transform).
  */
 void Finger::initialize(const std::string& name_id,
-    const nlohmann::json& json_file, igl::opengl::glfw::Viewer *viewer,
-    int mesh_idx)
+    const nlohmann::json& json_file, bool load_meshes,
+    const Eigen::Affine3d& root_transform)
 {
     // Get finger id
     m_name_id = name_id;
 
+    // Set root transform
+    m_root_transform = root_transform;
+
     // Parse the json file
     parse_json_file(json_file);
 
     // Initialize mesh files
     initialize_mesh_containers();
 
-    // Load mesh files
-    load_mesh_files(viewer);
+    // Kinematics only
+    if (!load_meshes)
+    {
+        // Initialize state
+        initialize_state(m_link_lengths, m_origin);
+
+        // Initialize kinematics
+        update_kinematics(m_state_vec);
+
+        return;
+    }
+
+    // Map meshes from the cache (if it is valid)
+    if (!load_mesh_cache())
+    {
+        // Load mesh files
+        load_mesh_files();
+
+        // Postprocess meshes
+        postprocess_meshes();
+
+        // Write mesh cache and map it (or keep the meshes of the files)
+        MeshCache::write(std::filesystem::current_path() /
+            m_cache_rel_dir / (m_name_id + ".bin"), get_mesh_cache_key(),
+            m_mesh_files->vertices, m_mesh_files->faces);
+        if (load_mesh_cache()) { m_mesh_files.reset(); }
+        else { map_mesh_files(); }
+    }
 
-    // Set viewer data indices
-    m_viewer_data_lower_idx = mesh_idx;
-    m_viewer_data_upper_idx = m_viewer_data_lower_idx +
-        (m_meshes_filenames.size() - 1);
-    
-    // Get mesh data
-    get_mesh_data(viewer);
-    
-    // Postprocess meshes
-    postprocess_meshes();
-    
     // Initialize state
     initialize_state(m_link_lengths, m_origin);
 
@@ -44,6 +68,42 @@ void Finger::initialize(const std::string& name_id,
     update(m_state_vec);
 }
 
+/**
+ * @brief This function updates the finger's state and transforms the vertices 
+ * of its meshes with the global transforms of the links (see 
+ * #update_kinematics). Mesh \f$ 2i \f$ (joint) and \f$ 2i+1 \f$ (link) 
+ * are attached to link \f$ i \f$.
+ * @param state The vector of joint euler angles and postions as
+ * defined in dm::JointStateu.
+ */
+void Finger::update(const std::vector<dm::JointState>& state)
+{
+    // Update forward kinematics
+    update_kinematics(state);
+
+    // Resize vertices data
+    m_vertices_data.resize(2 * m_state_size);
+
+    // Loop through global transformation matrices
+    for (size_t i = 0; i < m_global_transform.size(); i++)
+    {
+        // Get global rotation and position
+        const Eigen::Matrix3d rot = m_global_transform.at(i).block<3, 3>(0, 0);
+        const Eigen::Vector3d pos = m_global_transform.at(i).block<3, 1>(0, 3);
+
+        /****************** Transform vertices ********************/
+        // Joint vertices
+        m_vertices_data.at(2*i).noalias() = (rot.lazyProduct(
+            get_rest_vertices(2*i).cast<double>()).colwise() +
+            pos).transpose();
+
+        // Link vertices
+        m_vertices_data.at(2*i+1).noalias() = (rot.lazyProduct(
+            get_rest_vertices(2*i+1).cast<double>()).colwise() +
+            pos).transpose();
+    }
+}
+
 /**
  * @brief This function updates the finger's state (position and orientation 
  * of its links and joints). It performs the forward kinematics for each link 
@@ -53,11 +113,13 @@ void Finger::initialize(const std::string& name_id,
  * and iterative compound transormation (post-miltiply rules, see 
  * Forward Kinematics Spong * Robot Modeling and Control). The frame conventions 
  * and the definitions of the rotation and translation matrices used are 
- * given in the handover document.
+ * given in the handover document. The root transform (#m_root_transform) is 
+ * pre-multiplied to the chain, so the global transforms are given with 
+ * respect to the inertial frame.
  * @param state The vector of joint euler angles and postions as
  * defined in dm::JointStateu.
  */
-void Finger::update(const std::vector<dm::JointState>& state)
+void Finger::update_kinematics(const std::vector<dm::JointState>& state)
 {
     // Update state vector
     m_state_vec =  state;
@@ -87,7 +149,8 @@ void Finger::update(const std::vector<dm::JointState>& state)
         /*********** Global transformation ***********/
         if (i == 0) {
             // Global transform
-            m_global_transform.at(i) = m_local_transform.at(i);
+            m_global_transform.at(i) = m_root_transform.matrix() *
+                m_local_transform.at(i);
         }
         else {
             // Global transform
@@ -96,34 +159,77 @@ void Finger::update(const std::vector<dm::JointState>& state)
         }
     }
 
-    // Resize vertices data
-    m_vertices_data.resize(2 * m_state_size);
+    /*********** Jacobian of the fingertip ***********/
+    update_jacobian();
+}
 
-    // Loop through global transformation matrices
-    for (size_t i = 0; i < m_global_transform.size(); i++)
-    {
-        // Get global transformation matrix
-        Eigen::Matrix4d t_mat = m_global_transform.at(i);
+/**
+ * @brief It updates the geometric Jacobian of the fingertip from the global
+ * transforms (see #update_kinematics). The euler angles of link \f$ i \f$
+ * rotate it about \f$ z \f$ of its parent frame (psi), then \f$ y' \f$
+ * (theta) and \f$ x'' \f$ (phi), which is the x axis of the link frame.
+ * The angular column of an angle is its axis in the inertial frame, and the
+ * linear column is the cross product of the axis with the vector from the
+ * origin of the link to the fingertip. The axes are pseudovectors, so they
+ * are negated if the root transform is a reflection (right hand): the
+ * linear columns are then still the derivatives of the fingertip position.
+ * The blocks are fixed-size and are only allocated on the first update.
+ */
+void Finger::update_jacobian(void)
+{
+    m_jacobian.resize(m_state_size);
 
-        /****************** Transform vertices ********************/
-        // Joint vertices
-        Eigen::MatrixXd joint_vert =
-            (t_mat * m_vertices_data_oh.at(2*i).transpose()).transpose();
+    // Position of the fingertip
+    const Eigen::Vector3d tip_position = get_tip_position();
 
-        // Link vertices
-        Eigen::MatrixXd link_vert =
-            (t_mat * m_vertices_data_oh.at(2*i+1).transpose()).transpose();
+    // Handedness of the root transform
+    const double handedness =
+        m_root_transform.linear().determinant() < 0.0 ? -1.0 : 1.0;
 
-        // Push back vertices
-        m_vertices_data.at(2*i) = joint_vert.leftCols<3>();
-        m_vertices_data.at(2*i+1) = link_vert.leftCols<3>();
+    for (size_t i = 0; i < m_global_transform.size(); i++)
+    {
+        // Rotation of the parent frame (root transform for the first link)
+        const Eigen::Matrix3d parent_rot = (i == 0) ?
+            Eigen::Matrix3d(m_root_transform.linear()) :
+            Eigen::Matrix3d(m_global_transform.at(i-1).block<3, 3>(0, 0));
+        const double psi = m_state_vec.at(i).euler(2);
+
+        // Angular columns (phi, theta, psi)
+        JacobianBlock& block = m_jacobian.at(i);
+        block.block<3, 1>(3, 0) = handedness *
+            m_global_transform.at(i).block<3, 1>(0, 0);
+        block.block<3, 1>(3, 1) = handedness * (std::cos(psi) *
+            parent_rot.col(1) - std::sin(psi) * parent_rot.col(0));
+        block.block<3, 1>(3, 2) = handedness * parent_rot.col(2);
+
+        // Linear columns
+        const Eigen::Vector3d lever = tip_position -
+            m_global_transform.at(i).block<3, 1>(0, 3);
+        for (int k = 0; k < 3; k++)
+        {
+            block.block<3, 1>(0, k) = block.block<3, 1>(3, k).cross(lever);
+        }
     }
 }
 
+/**
+ * @brief Returns the position of the fingertip with respect to the inertial
+ * frame. The links are aligned with the x axis of their frames, so the tip
+ * is the end of the distal link, i.e. the last link length along the x axis
+ * of the last frame (see #update_kinematics).
+ * @return Eigen::Vector3d The position of the fingertip.
+ */
+Eigen::Vector3d Finger::get_tip_position(void)
+{
+    const Eigen::Matrix4d& distal_transform = m_global_transform.back();
+    return distal_transform.block<3, 1>(0, 3) +
+        m_link_lengths.back() * distal_transform.block<3, 1>(0, 0);
+}
+
 /**
  * @brief It initializes the state of the finger based on the link_lengths and 
  * their origins as defined from the configuration file
- * (Hand::m_config_rel_path)
+ * (HandKinematics::m_config_rel_path)
  * @param link_lengths The lengths of the links.
  * @param origin The origins of the links.
  */
@@ -155,7 +261,7 @@ void Finger::initialize_state(const std::vector<double>& link_lengths,
 /**
  * @brief It initializes the mesh containers for its link and joint 
  * based on their properties defined in the configuration file
- * Hand::m_config_rel_path.
+ * HandKinematics::m_config_rel_path.
  */
 void Finger::initialize_mesh_containers(void)
 {
@@ -177,66 +283,141 @@ void Finger::initialize_mesh_containers(void)
 }
 
 /**
- * @brief Simply loads the meshes to the viewer.
- * 
- * @param viewer Pointer to the viewer object.
+ * @brief It reads the mesh files of the finger (#m_mesh_files). The
+ * vertices are converted from the libigl layout (Nx3) to the layout of the
+ * mesh cache (3xN, see MeshCache::). Each file is read once, the meshes of
+ * the same file are copied.
  */
-void Finger::load_mesh_files(igl::opengl::glfw::Viewer *viewer)
+void Finger::load_mesh_files(void)
 {
+    m_mesh_files = std::make_shared<MeshFiles>();
+    std::vector<MeshCache::VerticesMatrix>& vertices_data =
+        m_mesh_files->vertices;
+    std::vector<MeshCache::FacesMatrix>& faces_data = m_mesh_files->faces;
+
     for (size_t i = 0; i < m_meshes_filenames.size(); i++)
     {
-        viewer->load_mesh_from_file(m_meshes_filenames.at(i));
+        // Copy mesh of a file that has already been read
+        auto it = std::find(m_meshes_filenames.begin(),
+            m_meshes_filenames.begin() + i, m_meshes_filenames.at(i));
+        if (it != m_meshes_filenames.begin() + i)
+        {
+            size_t idx = it - m_meshes_filenames.begin();
+            vertices_data.push_back(vertices_data.at(idx));
+            faces_data.push_back(faces_data.at(idx));
+            continue;
+        }
+
+        // Read mesh file
+        Eigen::MatrixXd vertices;
+        Eigen::MatrixXi faces;
+        igl::read_triangle_mesh(m_meshes_filenames.at(i), vertices, faces);
+
+        vertices_data.push_back(
+            vertices.transpose().cast<MeshCache::VertexScalar>());
+        faces_data.push_back(faces);
     }
 }
 
 /**
- * @brief It passes a copy of the vertex data from the viewer to the local 
- * member variables of the finger instance.
- * @param viewer Pointer to the viewer object.
+ * @brief It uses the meshes read from the mesh files (#m_mesh_files) as the
+ * rest-pose meshes, when the mesh cache can not be written (e.g. read-only
+ * directory) and therefore not mapped.
  */
-void Finger::get_mesh_data(igl::opengl::glfw::Viewer *viewer)
+void Finger::map_mesh_files(void)
 {
-    for (size_t i = m_viewer_data_lower_idx; i <= m_viewer_data_upper_idx; i++)
+    m_meshes.clear();
+    for (size_t i = 0; i < m_mesh_files->vertices.size(); i++)
     {
-        // Push back vertices data
-        m_vertices_data_o.push_back(viewer->data_list.at(i).V);
-
-        // Push back faces data
-        m_faces_data.push_back(viewer->data_list.at(i).F);
+        const MeshCache::VerticesMatrix& vertices =
+            m_mesh_files->vertices.at(i);
+        const MeshCache::FacesMatrix& faces = m_mesh_files->faces.at(i);
+        m_meshes.push_back(MeshView{vertices.data(), faces.data(),
+            vertices.cols(), faces.rows()});
     }
 }
 
 /**
- * @brief It sets the scale of the meshes based on the links length and the
- *  joints desired size.
+ * @brief It maps the scaled rest-pose meshes from the mesh cache of the 
+ * finger (#m_cache_rel_dir), skipping the parsing and the processing of 
+ * the mesh files. The cache is only used if its key matches the current 
+ * mesh files and configuration (see #get_mesh_cache_key). The meshes are
+ * used in place, so the cache stays mapped as long as the finger (or a
+ * copy of it) exists.
+ * @return true The meshes have been mapped from the cache.
+ * @return false The cache is missing or stale.
  */
-void Finger::postprocess_meshes(void)
+bool Finger::load_mesh_cache(void)
 {
-    // Scale meshes
-    for (size_t i = 0; i < m_vertices_data_o.size(); i++)
+    // Map cache file
+    std::shared_ptr<MeshCache> cache = std::make_shared<MeshCache>();
+    if (!cache->open(std::filesystem::current_path() / m_cache_rel_dir /
+        (m_name_id + ".bin"), get_mesh_cache_key()) ||
+        cache->get_meshes_num() != m_meshes_filenames.size())
+    {
+        return false;
+    }
+
+    m_meshes.clear();
+    for (size_t i = 0; i < cache->get_meshes_num(); i++)
     {
-        /************** Scale data *******************/
-        Eigen::Matrix3d scale_matrix;
-        scale_matrix << m_geom_scales.at(i), 0.0, 0.0,
-            0.0, m_geom_scales.at(i), 0.0, 0.0, 0.0, m_geom_scales.at(i);
+        Eigen::Map<const MeshCache::VerticesMatrix> vertices =
+            cache->get_vertices(i);
+        Eigen::Map<const MeshCache::FacesMatrix> faces = cache->get_faces(i);
+        m_meshes.push_back(MeshView{vertices.data(), faces.data(),
+            vertices.cols(), faces.rows()});
+    }
+    m_mesh_cache = cache;
 
-        m_vertices_data_o.at(i) = (scale_matrix *
-            m_vertices_data_o.at(i).transpose()).transpose();
+    return true;
+}
 
-        /************** Generate homogeneous vertices data *******************/
-        // Get mesh i
-        Eigen::MatrixXd mesh_i = m_vertices_data_o.at(i);
+/**
+ * @brief It generates the key of the mesh cache of the finger. It hashes 
+ * the cache format (version and vertex scalar), the finger name, the 
+ * contents of the mesh files and the mesh scales (i.e. the configuration), 
+ * so any change invalidates the cache.
+ * @return uint64_t The key.
+ */
+uint64_t Finger::get_mesh_cache_key(void)
+{
+    // Hash cache format
+    uint32_t format[2] = {MeshCache::get_version(),
+        sizeof(MeshCache::VertexScalar)};
+    uint64_t key = MeshCache::hash(format, sizeof(format));
+
+    // Hash finger name
+    key = MeshCache::hash(m_name_id.data(), m_name_id.size(), key);
 
-        // Initialize homogeneous coordinates
-        Eigen::MatrixXd mesh_i_oh = Eigen::MatrixXd::Ones(mesh_i.rows(),
-            mesh_i.cols() + 1);
+    // Hash mesh files (each file once)
+    std::vector<std::string> hashed_filenames;
+    for (const auto& filename : m_meshes_filenames)
+    {
+        if (std::find(hashed_filenames.begin(), hashed_filenames.end(),
+            filename) != hashed_filenames.end()) { continue; }
+
+        key = MeshCache::hash_file(filename, key);
+        hashed_filenames.push_back(filename);
+    }
 
-        // Generate matrix of homogeneous coordinates
-        mesh_i_oh.col(0) = mesh_i.col(0);
-        mesh_i_oh.col(1) = mesh_i.col(1);
-        mesh_i_oh.col(2) = mesh_i.col(2);
+    // Hash mesh scales
+    key = MeshCache::hash(m_geom_scales.data(),
+        m_geom_scales.size() * sizeof(double), key);
 
-        m_vertices_data_oh.push_back(mesh_i_oh);
+    return key;
+}
+
+/**
+ * @brief It sets the scale of the meshes based on the links length and the
+ *  joints desired size.
+ */
+void Finger::postprocess_meshes(void)
+{
+    // Scale meshes
+    for (size_t i = 0; i < m_mesh_files->vertices.size(); i++)
+    {
+        m_mesh_files->vertices.at(i) *= (MeshCache::VertexScalar)
+            m_geom_scales.at(i);
     }
 }
 
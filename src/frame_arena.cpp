@@ -0,0 +1,80 @@
+#include "../include/frame_arena.h"
+
+/**
+ * @brief Reserves arena capacity so that the first frames are also served
+ * from the main block.
+ * @param size The capacity (number of doubles).
+ */
+void FrameArena::reserve(size_t size)
+{
+    if (size > m_buffer.size())
+    {
+        m_buffer.resize(size);
+        m_allocation_num++;
+    }
+}
+
+/**
+ * @brief Releases all the memory handed out during the previous frame. If
+ * the previous frame overflowed, the main block grows to the high-water mark
+ * so that following frames fit in it.
+ */
+void FrameArena::reset(void)
+{
+    // Grow main block if last frame overflowed
+    if (!m_overflow.empty())
+    {
+        m_overflow.clear();
+        m_buffer.resize(m_high_water_mark);
+        m_growth_num++;
+        m_allocation_num++;
+    }
+
+    // Rewind
+    m_offset = 0;
+}
+
+/**
+ * @brief Allocates a matrix view from the arena. The view is valid until the
+ * next call of #reset.
+ * @param rows The number of rows.
+ * @param cols The number of columns.
+ * @return Eigen::Map<Eigen::MatrixXd> The matrix view (uninitialized).
+ */
+Eigen::Map<Eigen::MatrixXd> FrameArena::matrix(Eigen::Index rows,
+    Eigen::Index cols)
+{
+    return Eigen::Map<Eigen::MatrixXd>(allocate(rows * cols), rows, cols);
+}
+
+/**
+ * @brief Bumps the arena offset by the requested size (rounded up to
+ * #m_alignment).
+ * @param size The number of doubles.
+ * @return double* Pointer to the allocated block.
+ */
+double* FrameArena::allocate(size_t size)
+{
+    // Round up size
+    size = (size + m_alignment - 1) / m_alignment * m_alignment;
+
+    // Pointer to allocated block
+    double* ptr;
+
+    if (m_offset + size <= m_buffer.size())
+    {
+        ptr = m_buffer.data() + m_offset;
+    }
+    else
+    {
+        m_overflow.push_back(std::make_unique<double[]>(size));
+        ptr = m_overflow.back().get();
+        m_allocation_num++;
+    }
+
+    // Update offset and high-water mark
+    m_offset += size;
+    m_high_water_mark = std::max(m_high_water_mark, m_offset);
+
+    return ptr;
+}
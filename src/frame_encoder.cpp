@@ -0,0 +1,154 @@
+#include "../include/frame_encoder.h"
+
+#include <igl/png/writePNG.h>
+
+#include "../include/utils.h"
+
+/**
+ * @brief It allocates the frame buffers and starts the encoder threads.
+ * @param encoders_num The number of encoder threads (at least one).
+ * @param frames_num The number of frame buffers (at least one per encoder
+ * plus the one being rendered).
+ * @param width The width of the frames (pixels).
+ * @param height The height of the frames (pixels).
+ */
+void FrameEncoder::initialize(size_t encoders_num, size_t frames_num,
+    int width, int height)
+{
+    finish();
+
+    encoders_num = std::max(encoders_num, (size_t) 1);
+    frames_num = std::max(frames_num, encoders_num + 1);
+
+    // Allocate frames
+    m_frames.assign(frames_num, Frame());
+    m_free_frames.clear();
+    m_queued_frames.clear();
+    for (auto& frame : m_frames)
+    {
+        frame.width = width;
+        frame.height = height;
+        frame.pixels.resize(4 * (size_t) width * height);
+        m_free_frames.push_back(&frame);
+    }
+
+    // Start encoders
+    m_statistics = Statistics();
+    m_stop = false;
+    for (size_t i = 0; i < encoders_num; i++)
+    {
+        m_encoders.emplace_back(&FrameEncoder::run_encoder, this);
+    }
+}
+
+/**
+ * @brief It returns a free frame. If every frame is queued or being
+ * encoded, it waits until an encoder releases one.
+ * @return Frame& The frame, to be submitted with #submit.
+ */
+FrameEncoder::Frame& FrameEncoder::acquire(void)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_free_frames.empty())
+    {
+        double start_time = Utils::monotonic_time();
+        m_frame_free.wait(lock, [this] { return !m_free_frames.empty(); });
+        m_statistics.wait_time += Utils::monotonic_time() - start_time;
+    }
+
+    Frame* frame = m_free_frames.back();
+    m_free_frames.pop_back();
+    return *frame;
+}
+
+/**
+ * @brief It queues an acquired frame for encoding.
+ * @param frame The frame (see #acquire), with its pixels and file name set.
+ */
+void FrameEncoder::submit(Frame& frame)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queued_frames.push_back(&frame);
+    }
+    m_frame_queued.notify_one();
+}
+
+/**
+ * @brief It waits until the queued frames are encoded and joins the
+ * encoder threads.
+ */
+void FrameEncoder::finish(void)
+{
+    if (m_encoders.empty()) { return; }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_frame_queued.notify_all();
+
+    for (auto& encoder : m_encoders) { encoder.join(); }
+    m_encoders.clear();
+}
+
+/**
+ * @brief Loop of an encoder thread. It takes the queued frames in order,
+ * splits their pixels into the channel matrices of igl::png::writePNG
+ * (the bottom row first, as read from OpenGL) and writes them, until the
+ * queue is empty and the encoders are stopped.
+ */
+void FrameEncoder::run_encoder(void)
+{
+    // Channels of the frame (width x height, per encoder)
+    Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic> R, G, B, A;
+
+    for (;;)
+    {
+        // Take next frame
+        Frame* frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_frame_queued.wait(lock, [this] {
+                return m_stop || !m_queued_frames.empty(); });
+            if (m_queued_frames.empty()) { return; }
+            frame = m_queued_frames.front();
+            m_queued_frames.pop_front();
+        }
+
+        double start_time = Utils::monotonic_time();
+
+        // Split channels (column major, so pixel k is (x, y) = (k % width,
+        // k / width))
+        R.resize(frame->width, frame->height);
+        G.resize(frame->width, frame->height);
+        B.resize(frame->width, frame->height);
+        A.resize(frame->width, frame->height);
+        const unsigned char* pixel = frame->pixels.data();
+        for (Eigen::Index k = 0; k < R.size(); k++, pixel += 4)
+        {
+            R.data()[k] = pixel[0];
+            G.data()[k] = pixel[1];
+            B.data()[k] = pixel[2];
+            A.data()[k] = pixel[3];
+        }
+
+        // Encode and write
+        bool is_written = igl::png::writePNG(R, G, B, A, frame->filename);
+        if (!is_written)
+        {
+            std::cerr << "[FrameEncoder] Cannot write " << frame->filename <<
+                std::endl;
+        }
+
+        // Release frame
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_statistics.frames++;
+            m_statistics.failed += !is_written;
+            m_statistics.encode_time += Utils::monotonic_time() - start_time;
+            m_free_frames.push_back(frame);
+        }
+        m_frame_free.notify_one();
+    }
+}
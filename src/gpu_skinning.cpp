@@ -0,0 +1,164 @@
+#include "../include/gpu_skinning.h"
+
+#include <igl/opengl/create_shader_program.h>
+
+/**
+ * Skinning vertex shader. It is libigl's mesh vertex shader with the link
+ * transform applied to the rest-pose position and normal.
+ */
+const std::string GpuSkinning::m_vertex_shader =
+R"(#version 150
+uniform mat4 view;
+uniform mat4 proj;
+uniform mat4 normal_matrix;
+uniform mat4 link_transform;
+in vec3 position;
+in vec3 normal;
+out vec3 position_eye;
+out vec3 normal_eye;
+in vec4 Ka;
+in vec4 Kd;
+in vec4 Ks;
+in vec2 texcoord;
+out vec2 texcoordi;
+out vec4 Kai;
+out vec4 Kdi;
+out vec4 Ksi;
+
+void main()
+{
+  position_eye = vec3 (view * link_transform * vec4 (position, 1.0));
+  normal_eye = vec3 (normal_matrix * link_transform * vec4 (normal, 0.0));
+  normal_eye = normalize(normal_eye);
+  gl_Position = proj * vec4 (position_eye, 1.0);
+  Kai = Ka;
+  Kdi = Kd;
+  Ksi = Ks;
+  texcoordi = texcoord;
+}
+)";
+
+/**
+ * Mesh fragment shader (same as libigl's MeshGL).
+ */
+const std::string GpuSkinning::m_fragment_shader =
+R"(#version 150
+uniform mat4 view;
+uniform mat4 proj;
+uniform vec4 fixed_color;
+in vec3 position_eye;
+in vec3 normal_eye;
+uniform vec3 light_position_eye;
+vec3 Ls = vec3 (1, 1, 1);
+vec3 Ld = vec3 (1, 1, 1);
+vec3 La = vec3 (1, 1, 1);
+in vec4 Ksi;
+in vec4 Kdi;
+in vec4 Kai;
+in vec2 texcoordi;
+uniform sampler2D tex;
+uniform float specular_exponent;
+uniform float lighting_factor;
+uniform float texture_factor;
+uniform float matcap_factor;
+uniform float double_sided;
+out vec4 outColor;
+
+void main()
+{
+  if(matcap_factor == 1.0f)
+  {
+    vec2 uv = normalize(normal_eye).xy * 0.5 + 0.5;
+    outColor = texture(tex, uv);
+  }
+  else
+  {
+    vec3 Ia = La * vec3(Kai);
+    vec3 vector_to_light_eye = light_position_eye - position_eye;
+    vec3 direction_to_light_eye = normalize (vector_to_light_eye);
+    float dot_prod = dot (direction_to_light_eye, normalize(normal_eye));
+    float clamped_dot_prod = abs(max (dot_prod, -double_sided));
+    vec3 Id = Ld * vec3(Kdi) * clamped_dot_prod;
+    vec3 reflection_eye = reflect (-direction_to_light_eye, normalize(normal_eye));
+    vec3 surface_to_viewer_eye = normalize (-position_eye);
+    float dot_prod_specular = dot (reflection_eye, surface_to_viewer_eye);
+    dot_prod_specular = float(abs(dot_prod)==dot_prod) * abs(max (dot_prod_specular, -double_sided));
+    float specular_factor = pow (dot_prod_specular, specular_exponent);
+    vec3 Is = Ls * vec3(Ksi) * specular_factor;
+    vec4 color = vec4(lighting_factor * (Is + Id) + Ia + (1.0-lighting_factor) * vec3(Kdi),(Kai.a+Ksi.a+Kdi.a)/3);
+    outColor = mix(vec4(1,1,1,1), texture(tex, texcoordi), texture_factor) * color;
+    if (fixed_color != vec4(0.0)) outColor = fixed_color;
+  }
+}
+)";
+
+/**
+ * @brief Initializes the containers of the shader programs. The programs
+ * themselves are generated on the first update, when the OpenGL context
+ * is available.
+ * @param viewer_data_lower_idx The lower idx of the meshes in the viewer
+ * data list.
+ * @param data_list_size The number of meshes.
+ */
+void GpuSkinning::initialize(int viewer_data_lower_idx, int data_list_size)
+{
+    m_viewer_data_lower_idx = viewer_data_lower_idx;
+    m_programs.assign(data_list_size, 0);
+    m_transform_locations.assign(data_list_size, -1);
+}
+
+/**
+ * @brief Sends the link transforms to the shader programs of the meshes. It
+ * must be called with the OpenGL context current (e.g. from the pre-draw
+ * callback of the viewer).
+ * @param viewer Reference to the viewer handle.
+ * @param transforms The link transform of each mesh.
+ */
+void GpuSkinning::update(igl::opengl::glfw::Viewer& viewer,
+    const std::vector<Eigen::Matrix4f>& transforms)
+{
+    for (size_t i = 0; i < m_programs.size(); i++)
+    {
+        // Get viewer data i
+        igl::opengl::ViewerData& data =
+            viewer.data_list.at(m_viewer_data_lower_idx + i);
+
+        // Setup shader if the mesh has not been initialized yet (or libigl
+        // has generated a new program)
+        if (!data.meshgl.is_initialized ||
+            data.meshgl.shader_mesh != m_programs.at(i))
+        {
+            setup_shader(data, i);
+        }
+
+        // Send link transform
+        glUseProgram(m_programs.at(i));
+        glUniformMatrix4fv(m_transform_locations.at(i), 1, GL_FALSE,
+            transforms.at(i).data());
+    }
+
+    glUseProgram(0);
+}
+
+/**
+ * @brief Initializes the OpenGL buffers of a mesh (if needed) and replaces
+ * its shader program with the skinning one. The vertex attributes keep the
+ * names of libigl's shaders, so MeshGL binds them as usual.
+ * @param data The viewer data of the mesh.
+ * @param idx The index of the mesh.
+ */
+void GpuSkinning::setup_shader(igl::opengl::ViewerData& data, size_t idx)
+{
+    // Initialize OpenGL buffers
+    if (!data.meshgl.is_initialized) { data.meshgl.init(); }
+
+    // Replace shader program
+    glDeleteProgram(data.meshgl.shader_mesh);
+    igl::opengl::create_shader_program(m_vertex_shader, m_fragment_shader, {},
+        data.meshgl.shader_mesh);
+
+    // Store program and uniform location
+    m_programs.at(idx) = data.meshgl.shader_mesh;
+    m_transform_locations.at(idx) =
+        glGetUniformLocation(data.meshgl.shader_mesh, "link_transform");
+}
@@ -1,150 +1,257 @@
 #include "../include/hand.h"
 
 /**
- * @brief The function first reads the hand configuration 
- * file (#m_config_rel_path) and sets up all the its fingers.
- * 
+ * @brief It initializes the kinematic model of the hand (see
+ * HandKinematics::initialize) and, unless the meshes are drawn as
+ * instances, adds the hand meshes to the viewer.
+ *
  * @param viewer Pointer to the viewer object.
- * @param exo_handler Point to the exoskeleton object.
- * @param anim_hand Pointer to the hand animation object.
  * @param type Defines whether the hand is the left one (0) or the right one (1).
- * @param origin Defines the origin of the hand \f$ f_{{W}_{0}} \f$ with respct 
+ * @param origin Defines the origin of the hand \f$ f_{{W}_{0}} \f$ with respct
  * to the inertial frame \f$ F \f$.
+ * @param render_mode Defines whether the meshes are skinned on the CPU (see
+ * SkinningKernel::), on the GPU (see GpuSkinning::) or drawn as instances
+ * (see InstancedMesh::).
+ * @param joint_mesh Pointer to the instanced joint mesh (instanced mode).
+ * @param bone_mesh Pointer to the instanced bone mesh (instanced mode).
  */
+void Hand::initialize(igl::opengl::glfw::Viewer* viewer, bool type,
+    const Eigen::Vector3d& origin, RenderMode render_mode,
+    InstancedMesh* joint_mesh, InstancedMesh* bone_mesh)
+{
+    // Set render mode
+    m_render_mode = render_mode;
+    m_joint_mesh = joint_mesh;
+    m_bone_mesh = bone_mesh;
+
+    // Initialize kinematic model (the instanced meshes are not stored in
+    // the viewer data, and only the CPU mode skins the vertices)
+    m_kinematics.initialize(type, origin,
+        m_render_mode != RenderMode::Instanced,
+        m_render_mode == RenderMode::CPU);
+
+    if (m_render_mode == RenderMode::Instanced) { return; }
+
+    // Add meshes to the viewer
+    add_meshes(viewer);
+
+    // Initialize GPU skinning
+    if (m_render_mode == RenderMode::GPU)
+    {
+        initialize_gpu_skinning();
+    }
+}
 
-void Hand::initialize(igl::opengl::glfw::Viewer* viewer,
-    Exoskeleton* exo_handler, AnimatedHand* anim_hand,
-    bool type, const Eigen::Vector3d& origin)
+/**
+ * @brief It updates the kinematic model of the hand based on the euler
+ * angles for its skeleton joints (see HandKinematics::update_kinematics)
+ * and sends the result to the viewer. On the CPU, the vertices of the whole
+ * hand are skinned (see HandKinematics::update_vertices) and uploaded to the
+ * vertex buffers of the meshes (see #upload_vertices), while on the GPU only
+ * the link transforms are sent to the viewer (see GpuSkinning::). In
+ * instanced mode, only the kinematics are updated, and the instances are
+ * added once the level of detail of the hand has been selected (see
+ * #add_instances).
+ * @param euler_id The euler angles of the hand frames (AnimatedHand::HandAngles).
+ * @param viewer Pointer to the viewer object.
+ */
+void Hand::update(const AnimatedHand::HandAngles& euler_id,
+    igl::opengl::glfw::Viewer& viewer)
 {
-    // Define absolute path of hand configuration file
-    m_config_abs_path = std::filesystem::current_path() / m_config_rel_path;
+    // Update forward kinematics
+    m_kinematics.update_kinematics(euler_id);
 
-    // Parse json file
-    std::ifstream file(m_config_abs_path);
-    nlohmann::json json_file = nlohmann::json::parse(file);
+    // The instances are added by the caller (see add_instances)
+    if (m_render_mode == RenderMode::Instanced) { return; }
 
-    // Define hand pose 
-    m_hand_origin = origin;
-    m_hand_rot = Eigen::Matrix3d::Identity();
-    if (type) // Check if it's the right hand and apply mirror transformation
+    // Send link transforms to the shaders
+    if (m_render_mode == RenderMode::GPU)
     {
-        m_hand_rot(1, 1) = -1.0;
+        size_t mesh_idx = 0;
+        for (auto& finger : m_kinematics.get_fingers())
+        {
+            for (const auto& transform : finger.get_global_transforms())
+            {
+                // Joint and link meshes of the link
+                m_mesh_transforms.at(mesh_idx++) = transform.cast<float>();
+                m_mesh_transforms.at(mesh_idx++) = transform.cast<float>();
+            }
+        }
+        m_gpu_skinner.update(viewer, m_mesh_transforms);
+        return;
     }
 
-    // Resize fingers vector
-    m_fingers.resize(m_hand_config.size());
-    
-    // Intitialize vertex data 
-    std::vector<std::vector<Eigen::MatrixXd>> vertex_data;
+    // Skin hand meshes
+    m_kinematics.update_vertices();
 
-    // Get lower viewer data idx 
-    m_viewer_data_lower_idx = (viewer->data_list.size() == 1) ? 0 :
-        viewer->data_list.size();
+    // Send vertex data to viewer
+    const std::vector<HandKinematics::VertexMatrix>& vertex_data =
+        m_kinematics.get_vertex_data();
+    for (size_t i = 0; i < m_data_list_size; i++)
+    {
+        upload_vertices(viewer.data_list.at(m_viewer_data_lower_idx + i),
+            vertex_data.at(i), i);
+    }
+}
 
-    // Mesh idx initialization
-    int mesh_idx = m_viewer_data_lower_idx;
+/**
+ * @brief It sends the skinned vertices of a mesh to its viewer data and
+ * its vertex buffer. ViewerData::V is kept current (camera alignment,
+ * picking and bounds), but the positions are not flagged as dirty, so
+ * libigl does not convert and upload them again. Instead, once libigl has
+ * created the buffers of the mesh, its position buffer is replaced by one
+ * owned by the hand (see #setup_vertex_buffer) and the interleaved
+ * vertices are written to it. In the single precision build
+ * (HAND_FLOAT_VERTICES) they are uploaded as they are skinned, while in
+ * the double precision build they are first converted to single precision.
+ * Until the buffers exist, or whenever libigl is about to upload the
+ * positions itself (e.g. a dirty flag set by the viewer, or per-face
+ * vertices), the vertices go through ViewerData::V only.
+ * @param data The viewer data of the mesh.
+ * @param vertices The skinned vertices of the mesh (Nx3 row-major).
+ * @param idx The index of the mesh.
+ */
+void Hand::upload_vertices(igl::opengl::ViewerData& data,
+    const HandKinematics::VertexMatrix& vertices, size_t idx)
+{
+    igl::opengl::MeshGL& meshgl = data.meshgl;
+    const bool is_position_dirty =
+        (data.dirty | meshgl.dirty) & igl::opengl::MeshGL::DIRTY_POSITION;
+
+    // Keep the viewer data current
+    data.V = vertices.cast<double>();
 
-    // Initialize fingers
-    for (size_t i = 0; i < m_fingers.size(); i++)
+    // Upload through the viewer data
+    if (!meshgl.is_initialized || is_position_dirty ||
+        meshgl.V_vbo.rows() != vertices.rows())
     {
-        m_fingers.at(i).initialize(m_hand_config.at(i), json_file, viewer,
-            mesh_idx);
+        data.dirty |= igl::opengl::MeshGL::DIRTY_POSITION;
+        return;
+    }
 
-        // Update mesh idx
-        mesh_idx = viewer->data_list.size();
+    // Setup vertex buffer if libigl has (re)created the buffers of the mesh
+    if (meshgl.vbo_V != m_vertex_buffers.at(idx))
+    {
+        setup_vertex_buffer(meshgl, idx);
     }
 
-    // Get upper viewer data idx 
-    m_viewer_data_upper_idx = viewer->data_list.size();
+#ifdef HAND_FLOAT_VERTICES
+    const float* positions = vertices.data();
+#else
+    Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, 3, Eigen::RowMajor>>
+        buffer(m_upload_buffer.data(), vertices.rows(), 3);
+    buffer = vertices.cast<float>();
+    const float* positions = buffer.data();
+#endif
 
-    // Data list size    
-    m_data_list_size = m_viewer_data_upper_idx - m_viewer_data_lower_idx;
+    // Upload to the vertex buffer (the storage of the previous frame is
+    // orphaned, so the upload does not wait for its draw)
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertex_buffers.at(idx));
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 3 * vertices.rows(),
+        positions, GL_STREAM_DRAW);
 }
 
 /**
- * @brief It updates the hand vertices based on the euler angles for its 
- * skeleton joints. These are fed throught the AnimatedHand::EulerID 
- * struct. Based on the defined mapping it performs the forward kinematics 
- * for each finger and calcualtes all the hand vertices.
- * @param euler_id The custom EulerID structure as described in AnimatedHand::EulerID.
- * @param viewer Pointer to the viewer object.
+ * @brief It replaces the position buffer of a mesh, created by libigl,
+ * with one owned by the hand. MeshGL binds it to the position attribute
+ * on every draw, and only writes to it when the positions are dirty.
+ * @param meshgl The OpenGL buffers of the mesh.
+ * @param idx The index of the mesh.
  */
-void Hand::update(const std::vector<Eigen::Vector3d>& euler_id, 
-    igl::opengl::glfw::Viewer& viewer)
+void Hand::setup_vertex_buffer(igl::opengl::MeshGL& meshgl, size_t idx)
 {
-    // Intitialize vertex data 
-    std::vector<std::vector<Eigen::MatrixXd>> vertex_data;
+    // Replace vertex buffer
+    glDeleteBuffers(1, &meshgl.vbo_V);
+    glGenBuffers(1, &meshgl.vbo_V);
 
-    // Update fingers
-    for (size_t i = 0; i < m_fingers.size(); i++)
-    {
-        // Get finger frame ids
-        std::vector<int> frame_ids = m_fingers.at(i).get_frame_ids();
-        
-        // Get current state of finger 
-        std::vector<dm::JointState> state_vec = m_fingers.at(i).get_state();
+    // Store vertex buffer
+    m_vertex_buffers.at(idx) = meshgl.vbo_V;
+}
 
-        for (size_t j = 0; j < frame_ids.size(); j++)
+/**
+ * @brief It adds the scaled rest-pose meshes of the fingers to the viewer,
+ * one viewer data per mesh, and keeps their range in the viewer data list
+ * (the initial viewer data is reused if it is empty).
+ * @param viewer Pointer to the viewer object.
+ */
+void Hand::add_meshes(igl::opengl::glfw::Viewer* viewer)
+{
+    for (auto& finger : m_kinematics.get_fingers())
+    {
+        for (size_t i = 0; i < finger.get_meshes_num(); i++)
         {
-            state_vec.at(j).euler = euler_id.at(frame_ids.at(j));
+            if (!(viewer->data().V.rows() == 0 && viewer->data().F.rows() == 0))
+            {
+                viewer->append_mesh();
+            }
+            viewer->data().set_mesh(
+                finger.get_rest_vertices(i).transpose().cast<double>(),
+                finger.get_faces(i));
         }
+    }
 
-        // Update finger            
-        m_fingers.at(i).update(state_vec);
+    // Viewer data range of the hand
+    m_data_list_size = m_kinematics.get_meshes_num();
+    m_viewer_data_upper_idx = viewer->data_list.size();
+    m_viewer_data_lower_idx = m_viewer_data_upper_idx - m_data_list_size;
 
-        // Get vertices for finger i
-        std::vector<Eigen::MatrixXd> finger_i_vertices =
-            m_fingers.at(i).get_vertices();
+    // Vertex buffers (created on the first upload)
+    m_vertex_buffers.assign(m_data_list_size, 0);
 
-        // Transform the data to match the hand position        
-        for (size_t j = 0; j < finger_i_vertices.size(); j++)
+#ifndef HAND_FLOAT_VERTICES
+    // Upload buffer of the largest mesh
+    Eigen::Index max_rows = 0;
+    for (auto& finger : m_kinematics.get_fingers())
+    {
+        for (size_t i = 0; i < finger.get_meshes_num(); i++)
         {
-            // Get the translation matrix
-            Eigen::MatrixXd t_mat = translation_matrix(m_hand_origin,
-                finger_i_vertices.at(j).rows());
-            
-            // Perform transformation
-            finger_i_vertices.at(j) = t_mat + (m_hand_rot *
-                finger_i_vertices.at(j).transpose()).transpose();
+            max_rows = std::max(max_rows, finger.get_rest_vertices(i).cols());
         }
-
-        // Push back vertex data
-        vertex_data.push_back(finger_i_vertices);
     }
+    m_upload_buffer.resize(max_rows, 3);
+#endif
+}
 
-    // Set vertex data
-    m_vertex_data = concatenate_data<Eigen::MatrixXd>(vertex_data);
+/**
+ * @brief It initializes the GPU skinning of the hand. The scaled rest-pose
+ * vertices have been sent to the viewer once (see #add_meshes), and from
+ * then on only the link transforms are sent on every frame.
+ */
+void Hand::initialize_gpu_skinning(void)
+{
+    // Initialize GPU skinning
+    m_gpu_skinner.initialize(m_viewer_data_lower_idx, m_data_list_size);
 
-    // Send vertex data to viewer
-    for (size_t i = 0; i < m_data_list_size; i++)
-    {
-        // Send vertex data to viewer
-        viewer.data_list.at(m_viewer_data_lower_idx +
-            i).set_vertices(m_vertex_data.at(i));
-    }
+    // Initialize mesh transforms
+    m_mesh_transforms.assign(m_data_list_size, Eigen::Matrix4f::Identity());
 }
 
 /**
- * @brief This is not a homogenous transformation matrix. Instead it is 
- * used for shifting a matrix of vertices (as defined by libigl) by a given 
- * offset. 
- * @param offset The offset to shift the matrix of vertices.
- * @param vert_num The number of matrices.
- * @return Eigen::MatrixXd The output translation matrix.
+ * @brief It adds one joint and one bone instance per link to the instanced
+ * meshes. The transform of each instance is the global transform of its
+ * link with the scale of the mesh (see Finger::get_geom_scales) applied.
+ * @param lod The level of detail of the instances (see InstancedMesh::).
  */
-Eigen::MatrixXd Hand::translation_matrix(const Eigen::Vector3d& offset,
-    size_t vert_num)
+void Hand::add_instances(size_t lod)
 {
-    // Initialize matrix 
-    Eigen::MatrixXd t_mat = Eigen::MatrixXd(vert_num, offset.rows());
+    for (auto& finger : m_kinematics.get_fingers())
+    {
+        // Get link transforms and mesh scales of finger
+        const std::vector<Eigen::Matrix4d>& transforms =
+            finger.get_global_transforms();
+        const std::vector<double>& scales = finger.get_geom_scales();
 
-    // Ones vector
-    Eigen::VectorXd ones_vec = Eigen::VectorXd::Ones(vert_num);
+        for (size_t j = 0; j < transforms.size(); j++)
+        {
+            // Joint instance
+            Eigen::Matrix4f joint_transform = transforms.at(j).cast<float>();
+            joint_transform.block<3, 3>(0, 0) *= (float) scales.at(2*j);
+            m_joint_mesh->add_instance(joint_transform, lod);
 
-    for(size_t i = 0; i < offset.rows(); i++)
-    {
-        t_mat.col(i) = offset(i) * ones_vec;
+            // Bone instance
+            Eigen::Matrix4f bone_transform = transforms.at(j).cast<float>();
+            bone_transform.block<3, 3>(0, 0) *= (float) scales.at(2*j+1);
+            m_bone_mesh->add_instance(bone_transform, lod);
+        }
     }
-
-    return t_mat;
-}
\ No newline at end of file
+}
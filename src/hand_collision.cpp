@@ -0,0 +1,353 @@
+#include "../include/hand_collision.h"
+
+/**
+ * @brief It creates one capsule per link of every finger of the hand and the
+ * boxes of the hierarchy, and places them at the current pose of the hand.
+ * @param hand The hand model.
+ * @param parameters The capsule parameters.
+ */
+void HandCollision::initialize(HandKinematics& hand,
+    const Parameters& parameters)
+{
+    // Set parameters
+    m_parameters = parameters;
+
+    // Capsules of the fingers
+    m_capsules.clear();
+    m_finger_offsets.assign(1, 0);
+    std::vector<Finger>& fingers = hand.get_fingers();
+    for (size_t i = 0; i < fingers.size(); i++)
+    {
+        for (size_t j = 0; j < fingers.at(i).get_link_lengths().size(); j++)
+        {
+            Capsule capsule;
+            capsule.finger = i;
+            capsule.link = j;
+            capsule.radius = m_parameters.radius;
+            m_capsules.push_back(capsule);
+        }
+        m_finger_offsets.push_back(m_capsules.size());
+    }
+
+    // Hierarchy
+    m_capsule_boxes.resize(m_capsules.size());
+    m_finger_boxes.resize(fingers.size());
+
+    update(hand);
+}
+
+/**
+ * @brief It places the capsules at the current pose of the hand (see
+ * Finger::get_global_transforms) and refits the boxes of the hierarchy from
+ * the capsules to the hand. The topology does not change, so nothing is
+ * allocated.
+ * @param hand The hand model (updated).
+ */
+void HandCollision::update(HandKinematics& hand)
+{
+    m_hand_box.setEmpty();
+    std::vector<Finger>& fingers = hand.get_fingers();
+    for (size_t i = 0; i < fingers.size(); i++)
+    {
+        const std::vector<Eigen::Matrix4d>& transforms =
+            fingers.at(i).get_global_transforms();
+        const std::vector<double>& link_lengths =
+            fingers.at(i).get_link_lengths();
+
+        Box& finger_box = m_finger_boxes.at(i);
+        finger_box.setEmpty();
+        for (size_t j = 0; j < link_lengths.size(); j++)
+        {
+            // Segment of the link (along the x axis of its frame)
+            size_t capsule_idx = m_finger_offsets.at(i) + j;
+            Capsule& capsule = m_capsules.at(capsule_idx);
+            capsule.start = transforms.at(j).block<3, 1>(0, 3);
+            capsule.end = capsule.start +
+                link_lengths.at(j) * transforms.at(j).block<3, 1>(0, 0);
+
+            // Refit boxes
+            const Eigen::Vector3d extent =
+                Eigen::Vector3d::Constant(capsule.radius);
+            Box& box = m_capsule_boxes.at(capsule_idx);
+            box = Box(capsule.start.cwiseMin(capsule.end) - extent,
+                capsule.start.cwiseMax(capsule.end) + extent);
+            finger_box.extend(box);
+        }
+        m_hand_box.extend(finger_box);
+    }
+}
+
+/**
+ * @brief It finds the closest pair of capsules of two fingers of the hand,
+ * e.g. the thumb and the index to detect a pinch.
+ * @param finger_a The first finger (index in HandKinematics::get_fingers).
+ * @param finger_b The second finger.
+ * @return Contact The closest pair of capsules (infinite distance if the
+ * fingers are the same).
+ */
+HandCollision::Contact HandCollision::get_finger_distance(size_t finger_a,
+    size_t finger_b) const
+{
+    Contact contact;
+    if (finger_a != finger_b)
+    {
+        finger_distance(*this, finger_a, *this, finger_b, contact);
+    }
+    return contact;
+}
+
+/**
+ * @brief It finds every pair of capsules of different fingers of the hand
+ * whose distance is below the contact margin. The pairs of fingers whose
+ * boxes are farther than the margin are skipped.
+ * @param contacts The contacts (cleared).
+ */
+void HandCollision::get_self_contacts(std::vector<Contact>& contacts) const
+{
+    contacts.clear();
+    size_t fingers_num = m_finger_boxes.size();
+    for (size_t i = 0; i < fingers_num; i++)
+    {
+        for (size_t j = i + 1; j < fingers_num; j++)
+        {
+            finger_contacts(*this, i, *this, j, m_parameters.contact_margin,
+                contacts);
+        }
+    }
+}
+
+/**
+ * @brief It finds the closest pair of capsules between this hand and
+ * another one. The pairs of fingers whose boxes are farther than the best
+ * distance found so far are skipped.
+ * @param other The other hand.
+ * @return Contact The closest pair (capsule_a of this hand, capsule_b of
+ * the other one).
+ */
+HandCollision::Contact HandCollision::get_distance(
+    const HandCollision& other) const
+{
+    Contact contact;
+    for (size_t i = 0; i < m_finger_boxes.size(); i++)
+    {
+        for (size_t j = 0; j < other.m_finger_boxes.size(); j++)
+        {
+            finger_distance(*this, i, other, j, contact);
+        }
+    }
+    return contact;
+}
+
+/**
+ * @brief It finds every pair of capsules between this hand and another one
+ * whose distance is below the contact margin (of this hand). The hands
+ * whose boxes are farther than the margin are skipped at once.
+ * @param other The other hand.
+ * @param contacts The contacts (cleared, capsule_a of this hand).
+ */
+void HandCollision::get_contacts(const HandCollision& other,
+    std::vector<Contact>& contacts) const
+{
+    contacts.clear();
+    const double margin = m_parameters.contact_margin;
+    if (m_hand_box.squaredExteriorDistance(other.m_hand_box) >
+        std::max(margin, 0.0) * std::max(margin, 0.0))
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < m_finger_boxes.size(); i++)
+    {
+        for (size_t j = 0; j < other.m_finger_boxes.size(); j++)
+        {
+            finger_contacts(*this, i, other, j, margin, contacts);
+        }
+    }
+}
+
+/**
+ * @brief It updates the closest pair of capsules with the capsules of two
+ * fingers. A finger or capsule pair is skipped if the distance between its
+ * boxes is larger than the best distance (the boxes contain the capsules,
+ * so their distance is a lower bound).
+ * @param hand_a The hand of the first finger.
+ * @param finger_a The first finger.
+ * @param hand_b The hand of the second finger.
+ * @param finger_b The second finger.
+ * @param contact The closest pair found so far (updated).
+ */
+void HandCollision::finger_distance(const HandCollision& hand_a,
+    size_t finger_a, const HandCollision& hand_b, size_t finger_b,
+    Contact& contact)
+{
+    // A penetration can only be improved by intersecting boxes
+    double bound = std::max(contact.distance, 0.0);
+    if (hand_a.m_finger_boxes.at(finger_a).squaredExteriorDistance(
+        hand_b.m_finger_boxes.at(finger_b)) > bound * bound)
+    {
+        return;
+    }
+
+    for (size_t i = hand_a.m_finger_offsets.at(finger_a);
+        i < hand_a.m_finger_offsets.at(finger_a + 1); i++)
+    {
+        for (size_t j = hand_b.m_finger_offsets.at(finger_b);
+            j < hand_b.m_finger_offsets.at(finger_b + 1); j++)
+        {
+            bound = std::max(contact.distance, 0.0);
+            if (hand_a.m_capsule_boxes.at(i).squaredExteriorDistance(
+                hand_b.m_capsule_boxes.at(j)) > bound * bound)
+            {
+                continue;
+            }
+
+            Contact pair;
+            capsule_distance(hand_a.m_capsules.at(i), hand_b.m_capsules.at(j),
+                pair);
+            if (pair.distance < contact.distance)
+            {
+                contact = pair;
+                contact.capsule_a = i;
+                contact.capsule_b = j;
+            }
+        }
+    }
+}
+
+/**
+ * @brief It adds the pairs of capsules of two fingers whose distance is
+ * below the margin, skipping the finger and capsule pairs whose boxes are
+ * farther than it.
+ * @param hand_a The hand of the first finger.
+ * @param finger_a The first finger.
+ * @param hand_b The hand of the second finger.
+ * @param finger_b The second finger.
+ * @param margin The contact margin (m).
+ * @param contacts The contacts (appended).
+ */
+void HandCollision::finger_contacts(const HandCollision& hand_a,
+    size_t finger_a, const HandCollision& hand_b, size_t finger_b,
+    double margin, std::vector<Contact>& contacts)
+{
+    const double bound_sq = std::max(margin, 0.0) * std::max(margin, 0.0);
+    if (hand_a.m_finger_boxes.at(finger_a).squaredExteriorDistance(
+        hand_b.m_finger_boxes.at(finger_b)) > bound_sq)
+    {
+        return;
+    }
+
+    for (size_t i = hand_a.m_finger_offsets.at(finger_a);
+        i < hand_a.m_finger_offsets.at(finger_a + 1); i++)
+    {
+        for (size_t j = hand_b.m_finger_offsets.at(finger_b);
+            j < hand_b.m_finger_offsets.at(finger_b + 1); j++)
+        {
+            if (hand_a.m_capsule_boxes.at(i).squaredExteriorDistance(
+                hand_b.m_capsule_boxes.at(j)) > bound_sq)
+            {
+                continue;
+            }
+
+            Contact contact;
+            capsule_distance(hand_a.m_capsules.at(i), hand_b.m_capsules.at(j),
+                contact);
+            if (contact.distance <= margin)
+            {
+                contact.capsule_a = i;
+                contact.capsule_b = j;
+                contacts.push_back(contact);
+            }
+        }
+    }
+}
+
+/**
+ * @brief It computes the distance between the surfaces of two capsules,
+ * i.e. the distance between their segments minus their radii.
+ * @param capsule_a The first capsule.
+ * @param capsule_b The second capsule.
+ * @param contact The distance and the closest points of the segments (the
+ * capsule indices are not set).
+ */
+void HandCollision::capsule_distance(const Capsule& capsule_a,
+    const Capsule& capsule_b, Contact& contact)
+{
+    double distance_sq = segment_distance_sq(capsule_a.start, capsule_a.end,
+        capsule_b.start, capsule_b.end, contact.point_a, contact.point_b);
+    contact.distance = std::sqrt(distance_sq) - capsule_a.radius -
+        capsule_b.radius;
+}
+
+/**
+ * @brief It computes the closest points of two segments
+ * \f$ a(s) = a_0 + s (a_1 - a_0) \f$ and \f$ b(t) = b_0 + t (b_1 - b_0) \f$,
+ * with \f$ s, t \in [0, 1] \f$. The parameters of the closest points of the
+ * lines are clamped to the segments, one after the other (see Ericson, Real
+ * Time Collision Detection, 5.1.9). Degenerate segments are points.
+ * @param start_a The start of the first segment.
+ * @param end_a The end of the first segment.
+ * @param start_b The start of the second segment.
+ * @param end_b The end of the second segment.
+ * @param point_a The closest point of the first segment.
+ * @param point_b The closest point of the second segment.
+ * @return double The squared distance between the segments.
+ */
+double HandCollision::segment_distance_sq(const Eigen::Vector3d& start_a,
+    const Eigen::Vector3d& end_a, const Eigen::Vector3d& start_b,
+    const Eigen::Vector3d& end_b, Eigen::Vector3d& point_a,
+    Eigen::Vector3d& point_b)
+{
+    const double epsilon = 1e-12;
+    const Eigen::Vector3d direction_a = end_a - start_a;
+    const Eigen::Vector3d direction_b = end_b - start_b;
+    const Eigen::Vector3d offset = start_a - start_b;
+    const double length_a_sq = direction_a.squaredNorm();
+    const double length_b_sq = direction_b.squaredNorm();
+    const double f = direction_b.dot(offset);
+
+    double s = 0.0, t = 0.0;
+    if (length_a_sq <= epsilon && length_b_sq <= epsilon)
+    {
+        // Both segments are points
+    }
+    else if (length_a_sq <= epsilon)
+    {
+        t = std::clamp(f / length_b_sq, 0.0, 1.0);
+    }
+    else
+    {
+        const double c = direction_a.dot(offset);
+        if (length_b_sq <= epsilon)
+        {
+            s = std::clamp(-c / length_a_sq, 0.0, 1.0);
+        }
+        else
+        {
+            // Closest points of the lines (s = 0 if they are parallel)
+            const double b = direction_a.dot(direction_b);
+            const double denominator = length_a_sq * length_b_sq - b * b;
+            if (denominator > epsilon * length_a_sq * length_b_sq)
+            {
+                s = std::clamp((b * f - c * length_b_sq) / denominator,
+                    0.0, 1.0);
+            }
+
+            // Clamp t, then recompute s for the clamped t
+            t = (b * s + f) / length_b_sq;
+            if (t < 0.0)
+            {
+                t = 0.0;
+                s = std::clamp(-c / length_a_sq, 0.0, 1.0);
+            }
+            else if (t > 1.0)
+            {
+                t = 1.0;
+                s = std::clamp((b - c) / length_a_sq, 0.0, 1.0);
+            }
+        }
+    }
+
+    point_a = start_a + s * direction_a;
+    point_b = start_b + t * direction_b;
+    return (point_a - point_b).squaredNorm();
+}
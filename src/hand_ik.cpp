@@ -0,0 +1,296 @@
+#include "../include/hand_ik.h"
+
+/**
+ * @brief It loads the kinematic model of the hand without meshes (see
+ * HandKinematics::initialize), selects the solved axes of every finger from
+ * the axes driven by the glove (see AnimatedHand::get_driven_axes) and
+ * creates one solver per thread, warm-started from the rest pose.
+ * The hand is placed at the origin, so the targets are given with respect
+ * to its base frame \f$ f_{{W}_{0}} \f$.
+ * @param anim_hand The glove mapping.
+ * @param parameters The solver parameters.
+ */
+void HandIK::initialize(AnimatedHand& anim_hand, const Parameters& parameters)
+{
+    // Set parameters
+    m_parameters = parameters;
+    if (m_parameters.threads_num == 0)
+    {
+        m_parameters.threads_num = std::max(1u,
+            std::thread::hardware_concurrency());
+    }
+
+    // Initialize hand model (kinematics only)
+    HandKinematics hand;
+    hand.initialize(m_parameters.type, Eigen::Vector3d::Zero(), false);
+
+    // Solved axes of each finger
+    AnimatedHand::HandAxes driven_axes = anim_hand.get_driven_axes();
+    m_finger_dofs.clear();
+    size_t max_dofs_num = 0;
+    for (auto& finger : hand.get_fingers())
+    {
+        const std::vector<int>& frame_ids = finger.get_frame_ids();
+        std::vector<std::pair<size_t, int>> dofs;
+        for (size_t j = 0; j < frame_ids.size(); j++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                if (driven_axes.at(frame_ids.at(j)).at(k))
+                {
+                    dofs.push_back({j, k});
+                }
+            }
+        }
+        max_dofs_num = std::max(max_dofs_num, dofs.size());
+        m_finger_dofs.push_back(dofs);
+    }
+
+    // Initialize solvers
+    m_solvers.resize(m_parameters.threads_num);
+    for (auto& solver : m_solvers)
+    {
+        solver.hand = hand;
+        solver.jacobian.resize(3, max_dofs_num);
+        solver.step.resize(max_dofs_num);
+    }
+    reset();
+    reset_statistics();
+}
+
+/**
+ * @brief It resets the warm start of the solvers to the rest pose (all the
+ * hand angles zero), e.g. before a new trajectory.
+ */
+void HandIK::reset(void)
+{
+    for (auto& solver : m_solvers)
+    {
+        for (auto& euler : solver.euler_arr) { euler.setZero(); }
+    }
+}
+
+/**
+ * @brief It solves the hand angles of a frame, starting from the solution
+ * of the previous frame.
+ * @param targets The fingertip targets (one per finger, in the order of
+ * HandKinematics::get_fingers, m).
+ * @param euler_arr The solved hand angles (the axes that are not driven by
+ * the glove are zero).
+ * @return true Every fingertip is within the tolerance of its target.
+ * @return false A target has not been reached (e.g. it is out of the
+ * workspace of the finger), the hand angles are the closest pose found.
+ */
+bool HandIK::solve(const std::vector<Eigen::Vector3d>& targets,
+    AnimatedHand::HandAngles& euler_arr)
+{
+    if (targets.size() < get_fingers_num())
+    {
+        throw std::out_of_range("HandIK: not enough targets");
+    }
+
+    Solver& solver = m_solvers.at(0);
+    solver.statistics = Statistics();
+    bool is_converged = solve_frame(solver, targets.data(), euler_arr);
+    add_statistics(solver.statistics);
+
+    return is_converged;
+}
+
+/**
+ * @brief It solves the hand angles of a trajectory. The frames are split in
+ * contiguous ranges that are solved in parallel, each one in order and
+ * warm-started from its previous frame (the first frame of a range starts
+ * from the rest pose).
+ * @param targets The fingertip targets of every frame, in finger order
+ * (\f$ i \cdot F + j \f$ for finger j at frame i, m).
+ * @param euler_arr The solved hand angles of every frame (resized).
+ */
+void HandIK::solve_batch(const std::vector<Eigen::Vector3d>& targets,
+    std::vector<AnimatedHand::HandAngles>& euler_arr)
+{
+    size_t fingers_num = get_fingers_num();
+    size_t frames_num = targets.size() / fingers_num;
+    euler_arr.resize(frames_num);
+
+    // Start every range from the rest pose
+    reset();
+
+    size_t threads_num = std::min(m_solvers.size(),
+        std::max((size_t) 1, frames_num));
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threads_num; t++)
+    {
+        size_t begin = frames_num * t / threads_num;
+        size_t end = frames_num * (t + 1) / threads_num;
+        threads.emplace_back([this, &targets, &euler_arr, fingers_num, t,
+            begin, end]
+        {
+            Solver& solver = m_solvers.at(t);
+            solver.statistics = Statistics();
+            for (size_t i = begin; i < end; i++)
+            {
+                solve_frame(solver, targets.data() + i * fingers_num,
+                    euler_arr.at(i));
+            }
+        });
+    }
+    for (auto& thread : threads) { thread.join(); }
+
+    for (size_t t = 0; t < threads_num; t++)
+    {
+        add_statistics(m_solvers.at(t).statistics);
+    }
+}
+
+/**
+ * @brief It solves the fingers of a frame from the previous solution of
+ * the solver, and keeps the result as the next warm start.
+ * @param solver The solver.
+ * @param targets The fingertip targets (one per finger).
+ * @param euler_arr The solved hand angles.
+ * @return true Every fingertip is within the tolerance of its target.
+ */
+bool HandIK::solve_frame(Solver& solver, const Eigen::Vector3d* targets,
+    AnimatedHand::HandAngles& euler_arr)
+{
+    double start_time = Utils::monotonic_time();
+
+    // Warm start
+    euler_arr = solver.euler_arr;
+
+    bool is_converged = true;
+    for (size_t i = 0; i < m_finger_dofs.size(); i++)
+    {
+        is_converged &= solve_finger(solver, i, targets[i], euler_arr);
+    }
+
+    solver.euler_arr = euler_arr;
+    solver.statistics.solve_time += Utils::monotonic_time() - start_time;
+
+    return is_converged;
+}
+
+/**
+ * @brief It solves the target of a finger with damped least squares. On
+ * every iteration the fingertip error \f$ e \f$ is computed with the
+ * forward kinematics of the finger, and the solved axes are moved by
+ * \f$ \Delta q = J^T (J J^T + \lambda^2 I)^{-1} e \f$, with \f$ J \f$ the
+ * position rows of the Jacobian for the solved axes (see
+ * Finger::get_jacobian) and \f$ \lambda \f$ the damping factor. The step is
+ * limited to Parameters::max_step, which keeps the linearization valid far
+ * from the target. The 3x3 system is solved in place, so an iteration does
+ * not allocate.
+ * @param solver The solver.
+ * @param finger_idx The index of the finger.
+ * @param target The fingertip target (m).
+ * @param euler_arr The hand angles (initial guess, then solution).
+ * @return true The fingertip is within the tolerance of the target.
+ */
+bool HandIK::solve_finger(Solver& solver, size_t finger_idx,
+    const Eigen::Vector3d& target, AnimatedHand::HandAngles& euler_arr)
+{
+    Finger& finger = solver.hand.get_fingers().at(finger_idx);
+    const std::vector<int>& frame_ids = finger.get_frame_ids();
+    const std::vector<std::pair<size_t, int>>& dofs =
+        m_finger_dofs.at(finger_idx);
+    const double damping_sq = m_parameters.damping * m_parameters.damping;
+
+    size_t iterations = 0;
+    double error_norm = 0.0;
+    for (;;)
+    {
+        // Fingertip error
+        update_finger(solver, finger_idx, euler_arr);
+        const Eigen::Vector3d error = target - finger.get_tip_position();
+        error_norm = error.norm();
+        if (error_norm < m_parameters.tolerance ||
+            iterations >= m_parameters.max_iterations || dofs.empty())
+        {
+            break;
+        }
+        iterations++;
+
+        // Position Jacobian of the solved axes
+        const std::vector<Finger::JacobianBlock>& jacobian =
+            finger.get_jacobian();
+        auto solved_jacobian = solver.jacobian.leftCols(dofs.size());
+        for (size_t k = 0; k < dofs.size(); k++)
+        {
+            solved_jacobian.col(k) = jacobian.at(dofs.at(k).first).block<3, 1>(
+                0, dofs.at(k).second);
+        }
+
+        // Damped least squares step
+        Eigen::Matrix3d system = solved_jacobian * solved_jacobian.transpose();
+        system.diagonal().array() += damping_sq;
+        const Eigen::Vector3d weights = system.ldlt().solve(error);
+        auto step = solver.step.head(dofs.size());
+        step.noalias() = solved_jacobian.transpose() * weights;
+
+        double step_norm = step.norm();
+        if (step_norm > m_parameters.max_step)
+        {
+            step *= m_parameters.max_step / step_norm;
+        }
+
+        // Update solved axes
+        for (size_t k = 0; k < dofs.size(); k++)
+        {
+            euler_arr.at(frame_ids.at(dofs.at(k).first))(dofs.at(k).second) +=
+                step(k);
+        }
+    }
+
+    // Statistics
+    bool is_converged = error_norm < m_parameters.tolerance;
+    Statistics& statistics = solver.statistics;
+    statistics.targets++;
+    statistics.converged += is_converged;
+    statistics.iterations += iterations;
+    statistics.max_iterations = std::max(statistics.max_iterations,
+        (uint64_t) iterations);
+    statistics.error_sum += error_norm;
+    statistics.max_error = std::max(statistics.max_error, error_norm);
+
+    return is_converged;
+}
+
+/**
+ * @brief It updates the forward kinematics of a finger from the hand
+ * angles of its frames (as HandKinematics::update_kinematics does for the
+ * whole hand).
+ * @param solver The solver.
+ * @param finger_idx The index of the finger.
+ * @param euler_arr The hand angles.
+ */
+void HandIK::update_finger(Solver& solver, size_t finger_idx,
+    const AnimatedHand::HandAngles& euler_arr)
+{
+    Finger& finger = solver.hand.get_fingers().at(finger_idx);
+    const std::vector<int>& frame_ids = finger.get_frame_ids();
+
+    solver.state = finger.get_state();
+    for (size_t j = 0; j < frame_ids.size(); j++)
+    {
+        solver.state.at(j).euler = euler_arr.at(frame_ids.at(j));
+    }
+    finger.update_kinematics(solver.state);
+}
+
+/**
+ * @brief It adds the statistics of a solver to the convergence statistics.
+ * @param statistics The statistics of the solver.
+ */
+void HandIK::add_statistics(const Statistics& statistics)
+{
+    m_statistics.targets += statistics.targets;
+    m_statistics.converged += statistics.converged;
+    m_statistics.iterations += statistics.iterations;
+    m_statistics.max_iterations = std::max(m_statistics.max_iterations,
+        statistics.max_iterations);
+    m_statistics.error_sum += statistics.error_sum;
+    m_statistics.max_error = std::max(m_statistics.max_error,
+        statistics.max_error);
+    m_statistics.solve_time += statistics.solve_time;
+}
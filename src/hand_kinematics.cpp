@@ -0,0 +1,311 @@
+#include "../include/hand_kinematics.h"
+
+/**
+ * @brief The function first reads the hand configuration
+ * file (#m_config_rel_path) and sets up all the its fingers.
+ *
+ * @param type Defines whether the hand is the left one (0) or the right one (1).
+ * @param origin Defines the origin of the hand \f$ f_{{W}_{0}} \f$ with respct
+ * to the inertial frame \f$ F \f$.
+ * @param load_meshes Whether the finger meshes are loaded (otherwise only the
+ * kinematics are computed, see Finger::initialize).
+ * @param skin_vertices Whether the vertices of the meshes are generated on
+ * the CPU (see #update_vertices).
+ */
+void HandKinematics::initialize(bool type, const Eigen::Vector3d& origin,
+    bool load_meshes, bool skin_vertices)
+{
+    // Define absolute path of hand configuration file
+    m_config_abs_path = std::filesystem::current_path() / m_config_rel_path;
+
+    // Parse json file
+    std::ifstream file(m_config_abs_path);
+    nlohmann::json json_file = nlohmann::json::parse(file);
+
+    // Define hand pose
+    m_hand_origin = origin;
+    m_hand_rot = Eigen::Matrix3d::Identity();
+    if (type) // Check if it's the right hand and apply mirror transformation
+    {
+        m_hand_rot(1, 1) = -1.0;
+    }
+
+    // Define hand root transform (it is pre-multiplied to every finger chain)
+    Eigen::Affine3d root_transform = Eigen::Affine3d::Identity();
+    root_transform.linear() = m_hand_rot;
+    root_transform.translation() = m_hand_origin;
+
+    // Initialize fingers
+    m_fingers.resize(m_hand_config.size());
+    for (size_t i = 0; i < m_fingers.size(); i++)
+    {
+        m_fingers.at(i).initialize(m_hand_config.at(i), json_file,
+            load_meshes, root_transform);
+    }
+
+    // Initialize state containers
+    m_state_data.resize(m_fingers.size());
+
+    // Initialize skinning
+    if (load_meshes && skin_vertices)
+    {
+        initialize_skinning();
+    }
+}
+
+/**
+ * @brief It updates the forward kinematics and the vertices of the hand (see
+ * #update_kinematics and #update_vertices).
+ * @param euler_id The euler angles of the hand frames (AnimatedHand::HandAngles).
+ */
+void HandKinematics::update(const AnimatedHand::HandAngles& euler_id)
+{
+    update_kinematics(euler_id);
+    update_vertices();
+}
+
+/**
+ * @brief It updates the forward kinematics of the hand based on the euler
+ * angles for its skeleton joints. These are fed throught the
+ * AnimatedHand::HandAngles array. Based on the defined mapping it performs
+ * the forward kinematics for each finger (see Finger::update_kinematics).
+ * @param euler_id The euler angles of the hand frames (AnimatedHand::HandAngles).
+ */
+void HandKinematics::update_kinematics(const AnimatedHand::HandAngles& euler_id)
+{
+    // Link idx
+    size_t link_idx = 0;
+
+    // Update fingers
+    for (size_t i = 0; i < m_fingers.size(); i++)
+    {
+        // Get finger frame ids
+        const std::vector<int>& frame_ids = m_fingers.at(i).get_frame_ids();
+
+        // Get current state of finger
+        std::vector<dm::JointState>& state_vec = m_state_data.at(i);
+        state_vec = m_fingers.at(i).get_state();
+
+        for (size_t j = 0; j < frame_ids.size(); j++)
+        {
+            state_vec.at(j).euler = euler_id.at(frame_ids.at(j));
+        }
+
+        // Update finger
+        m_fingers.at(i).update_kinematics(state_vec);
+
+        if (m_link_transforms.empty()) { continue; }
+
+        // Get link transforms of finger i
+        const std::vector<Eigen::Matrix4d>& transforms =
+            m_fingers.at(i).get_global_transforms();
+
+        for (size_t j = 0; j < transforms.size(); j++)
+        {
+            m_link_transforms.at(link_idx++) =
+                SkinningKernel::rigid_transform<VertexScalar>(transforms.at(j));
+        }
+    }
+}
+
+/**
+ * @brief The vertices of the whole hand are calculated in a single pass by
+ * the skinning kernel (see SkinningKernel::) from the link transforms of the
+ * latest forward kinematics. It does nothing if the hand was initialized
+ * without skinning.
+ */
+void HandKinematics::update_vertices(void)
+{
+    // Skin hand meshes
+    SkinningKernel::skin(m_rest_vertices.data(), m_rest_vertices.rows(),
+        m_segments, m_link_transforms);
+}
+
+/**
+ * @brief It gathers the rest-pose vertices of all the finger meshes into a
+ * single contiguous buffer of SoA streams (#m_rest_vertices) and generates
+ * one skinning segment per mesh. Each segment is driven by the link the mesh
+ * is attached to (see Finger::update) and writes its output, interleaved,
+ * to the corresponding vertex data matrix (#m_vertex_data).
+ */
+void HandKinematics::initialize_skinning(void)
+{
+    // Count vertices
+    size_t rest_size = 0;
+    for (auto& finger : m_fingers)
+    {
+        for (size_t j = 0; j < finger.get_meshes_num(); j++)
+        {
+            rest_size += finger.get_rest_vertices(j).cols();
+        }
+    }
+
+    // Initialize containers
+    m_rest_vertices.resize(rest_size, 3);
+    m_vertex_data.resize(get_meshes_num());
+    m_segments.clear();
+
+    // Rest-pose offset, mesh idx and link idx
+    size_t offset = 0, mesh_idx = 0, link_idx = 0;
+
+    for (auto& finger : m_fingers)
+    {
+        for (size_t j = 0; j < finger.get_meshes_num(); j++)
+        {
+            // Rest-pose vertices of mesh j (mapped from the mesh cache)
+            Eigen::Map<const MeshCache::VerticesMatrix> rest_vertices =
+                finger.get_rest_vertices(j);
+            size_t size = rest_vertices.cols();
+
+            // Copy rest-pose vertices
+            m_rest_vertices.middleRows(offset, size) =
+                rest_vertices.transpose();
+
+            // Initialize output matrix
+            VertexMatrix& vertex_data = m_vertex_data.at(mesh_idx++);
+            vertex_data.resize(size, 3);
+
+            // Push back segment
+            m_segments.push_back(SkinningKernel::Segment<VertexScalar>{
+                offset, size, link_idx + j / 2, vertex_data.data()});
+
+            // Update offset
+            offset += size;
+        }
+
+        // Update link idx
+        link_idx += finger.get_global_transforms().size();
+    }
+
+    // Initialize link transforms
+    m_link_transforms.resize(link_idx);
+}
+
+/**
+ * @brief Returns the number of meshes of the hand (a joint and a bone mesh
+ * per link, zero if the meshes are not loaded).
+ * @return size_t The number of meshes.
+ */
+size_t HandKinematics::get_meshes_num(void)
+{
+    size_t meshes_num = 0;
+    for (auto& finger : m_fingers)
+    {
+        meshes_num += finger.get_meshes_num();
+    }
+    return meshes_num;
+}
+
+/**
+ * @brief Returns the number of links of the hand (one joint and one bone
+ * mesh per link).
+ * @return size_t The number of links.
+ */
+size_t HandKinematics::get_links_num(void)
+{
+    size_t links_num = 0;
+    for (auto& finger : m_fingers)
+    {
+        links_num += finger.get_global_transforms().size();
+    }
+    return links_num;
+}
+
+/**
+ * @brief It computes a bounding sphere of the hand. The center is the
+ * centroid of the link origins and the radius covers every link origin
+ * plus the largest mesh scale (the length of a bone or the size of a joint).
+ * @param center The center of the sphere.
+ * @param radius The radius of the sphere.
+ */
+void HandKinematics::get_bounding_sphere(Eigen::Vector3d& center,
+    double& radius)
+{
+    // Centroid of the link origins
+    center.setZero();
+    size_t links_num = 0;
+    double max_scale = 0.0;
+
+    for (auto& finger : m_fingers)
+    {
+        for (const auto& transform : finger.get_global_transforms())
+        {
+            center += transform.block<3, 1>(0, 3);
+            links_num++;
+        }
+
+        for (double scale : finger.get_geom_scales())
+        {
+            max_scale = std::max(max_scale, scale);
+        }
+    }
+    center /= std::max(links_num, (size_t) 1);
+
+    // Radius
+    radius = 0.0;
+    for (auto& finger : m_fingers)
+    {
+        for (const auto& transform : finger.get_global_transforms())
+        {
+            radius = std::max(radius,
+                (transform.block<3, 1>(0, 3) - center).norm());
+        }
+    }
+    radius += max_scale;
+}
+
+/**
+ * @brief It maps the rates of the hand angles (joint velocities) to the
+ * twist of each fingertip with the Jacobians of the fingers (see
+ * Finger::get_jacobian): the twist of a finger is the sum over its links of
+ * the Jacobian block of the link times the rates of its hand frame.
+ * @param euler_rates The rates of the euler angles of the hand frames
+ * (rad/s, indexed as AnimatedHand::HandAngles).
+ * @param twists The fingertip twists (one per finger, m/s and rad/s).
+ */
+void HandKinematics::get_tip_twists(const AnimatedHand::HandAngles& euler_rates,
+    std::vector<Twist>& twists)
+{
+    twists.resize(m_fingers.size());
+    for (size_t i = 0; i < m_fingers.size(); i++)
+    {
+        const std::vector<int>& frame_ids = m_fingers.at(i).get_frame_ids();
+        const std::vector<Finger::JacobianBlock>& jacobian =
+            m_fingers.at(i).get_jacobian();
+
+        twists.at(i).setZero();
+        for (size_t j = 0; j < jacobian.size(); j++)
+        {
+            twists.at(i).noalias() += jacobian.at(j) *
+                euler_rates.at(frame_ids.at(j));
+        }
+    }
+}
+
+/**
+ * @brief It maps a wrench applied at each fingertip to the generalized
+ * forces of the hand angles with the transposed Jacobians of the fingers
+ * (\f$ \tau = J^T w \f$, see Finger::get_jacobian). The generalized force of
+ * an euler angle is the torque about its rotation axis.
+ * @param wrenches The fingertip wrenches (one per finger, N and Nm).
+ * @param torques The generalized forces of the euler angles of the hand
+ * frames (Nm, indexed as AnimatedHand::HandAngles).
+ */
+void HandKinematics::get_joint_torques(const std::vector<Wrench>& wrenches,
+    AnimatedHand::HandAngles& torques)
+{
+    for (auto& torque : torques) { torque.setZero(); }
+
+    for (size_t i = 0; i < m_fingers.size(); i++)
+    {
+        const std::vector<int>& frame_ids = m_fingers.at(i).get_frame_ids();
+        const std::vector<Finger::JacobianBlock>& jacobian =
+            m_fingers.at(i).get_jacobian();
+
+        for (size_t j = 0; j < jacobian.size(); j++)
+        {
+            torques.at(frame_ids.at(j)).noalias() +=
+                jacobian.at(j).transpose() * wrenches.at(i);
+        }
+    }
+}
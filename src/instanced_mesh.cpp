@@ -0,0 +1,251 @@
+#include "../include/instanced_mesh.h"
+
+#include <igl/read_triangle_mesh.h>
+#include <igl/per_vertex_normals.h>
+#include <igl/decimate.h>
+#include <igl/opengl/create_shader_program.h>
+
+/**
+ * Instanced vertex shader. The transform of the instance is passed as a
+ * per-instance attribute (four vec4 columns).
+ */
+const std::string InstancedMesh::m_vertex_shader =
+R"(#version 150
+uniform mat4 view;
+uniform mat4 proj;
+in vec3 position;
+in vec3 normal;
+in mat4 instance_transform;
+out vec3 position_eye;
+out vec3 normal_eye;
+
+void main()
+{
+  position_eye = vec3 (view * instance_transform * vec4 (position, 1.0));
+  normal_eye = vec3 (view * instance_transform * vec4 (normal, 0.0));
+  normal_eye = normalize(normal_eye);
+  gl_Position = proj * vec4 (position_eye, 1.0);
+}
+)";
+
+/**
+ * Fragment shader (the lighting model of libigl's MeshGL with a uniform
+ * color).
+ */
+const std::string InstancedMesh::m_fragment_shader =
+R"(#version 150
+uniform vec4 color;
+uniform vec3 light_position_eye;
+uniform float lighting_factor;
+in vec3 position_eye;
+in vec3 normal_eye;
+out vec4 outColor;
+
+void main()
+{
+  vec3 Ia = 0.1 * vec3(color);
+  vec3 direction_to_light_eye = normalize (light_position_eye - position_eye);
+  float dot_prod = dot (direction_to_light_eye, normalize(normal_eye));
+  vec3 Id = vec3(color) * abs(dot_prod);
+  vec3 reflection_eye = reflect (-direction_to_light_eye, normalize(normal_eye));
+  float dot_prod_specular = max (dot (reflection_eye, normalize (-position_eye)), 0.0);
+  vec3 Is = vec3(0.3) * pow (dot_prod_specular, 35.0);
+  outColor = vec4(lighting_factor * (Is + Id) + Ia +
+    (1.0 - lighting_factor) * vec3(color), color.a);
+}
+)";
+
+/**
+ * @brief Loads the mesh file and generates its levels of detail. Level
+ * \f$ k \f$ is the original mesh decimated to a quarter of the faces of level
+ * \f$ k-1 \f$. If a mesh cannot be decimated further, the previous level is
+ * repeated, so that all the instanced meshes have the same number of levels.
+ * The OpenGL buffers are generated on the first draw, when the OpenGL
+ * context is available.
+ * @param filename The absolute filename of the mesh.
+ * @param lod_num The number of levels of detail.
+ * @param color The color of the mesh (RGBA).
+ */
+void InstancedMesh::initialize(const std::string& filename, size_t lod_num,
+    const Eigen::Vector4f& color)
+{
+    // Load mesh
+    Eigen::MatrixXd vertices;
+    Eigen::MatrixXi faces;
+    igl::read_triangle_mesh(filename, vertices, faces);
+
+    // Initialize levels of detail
+    m_levels.clear();
+    m_levels.resize(std::max(lod_num, (size_t) 1));
+    set_level(m_levels.at(0), vertices, faces);
+
+    for (size_t i = 1; i < m_levels.size(); i++)
+    {
+        // Decimate mesh
+        Eigen::MatrixXd lod_vertices;
+        Eigen::MatrixXi lod_faces;
+        Eigen::VectorXi birth_faces, birth_vertices;
+        bool is_decimated = igl::decimate(vertices, faces,
+            std::max((int) faces.rows() / 4, 4), lod_vertices, lod_faces,
+            birth_faces, birth_vertices);
+
+        // Repeat the previous level if the mesh cannot be decimated
+        if (is_decimated && lod_faces.rows() > 0)
+        {
+            vertices = lod_vertices;
+            faces = lod_faces;
+        }
+
+        set_level(m_levels.at(i), vertices, faces);
+    }
+
+    // Set color
+    m_color = color;
+
+    m_is_initialized = true;
+}
+
+/**
+ * @brief Clears the instances of all the levels of detail (start of a
+ * frame).
+ */
+void InstancedMesh::clear_instances(void)
+{
+    for (auto& level : m_levels) { level.instances.clear(); }
+}
+
+/**
+ * @brief Draws all the instances of the current frame with one instanced
+ * draw call per level of detail. It must be called with the OpenGL context
+ * current, after the viewer core has been drawn (e.g. from the post_draw
+ * of a viewer plugin, see InstancePlugin::), so that its view and
+ * projection matrices are up to date.
+ * @param core Reference to the viewer core.
+ */
+void InstancedMesh::draw(igl::opengl::ViewerCore& core)
+{
+    if (!m_is_initialized) { return; }
+
+    // Generate shader program on the first draw
+    if (m_program == 0) { initialize_program(); }
+
+    // Send uniforms
+    glUseProgram(m_program);
+    glUniformMatrix4fv(glGetUniformLocation(m_program, "view"), 1, GL_FALSE,
+        core.view.data());
+    glUniformMatrix4fv(glGetUniformLocation(m_program, "proj"), 1, GL_FALSE,
+        core.proj.data());
+    glUniform3fv(glGetUniformLocation(m_program, "light_position_eye"), 1,
+        core.light_position.data());
+    glUniform1f(glGetUniformLocation(m_program, "lighting_factor"),
+        core.lighting_factor);
+    glUniform4fv(glGetUniformLocation(m_program, "color"), 1,
+        m_color.data());
+
+    for (auto& level : m_levels)
+    {
+        if (level.instances.empty()) { continue; }
+
+        // Generate buffers on the first draw
+        if (level.vao == 0) { initialize_buffers(level); }
+
+        // Send instance transforms (the buffer grows when needed)
+        glBindBuffer(GL_ARRAY_BUFFER, level.vbo_instances);
+        if (level.instances.size() > level.instances_capacity)
+        {
+            level.instances_capacity = level.instances.size();
+            glBufferData(GL_ARRAY_BUFFER, level.instances_capacity *
+                sizeof(Eigen::Matrix4f), nullptr, GL_DYNAMIC_DRAW);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, 0, level.instances.size() *
+            sizeof(Eigen::Matrix4f), level.instances.data());
+
+        // Draw instances
+        glBindVertexArray(level.vao);
+        glDrawElementsInstanced(GL_TRIANGLES, 3 * level.faces.rows(),
+            GL_UNSIGNED_INT, 0, level.instances.size());
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(0);
+}
+
+/**
+ * @brief Computes the vertex normals of a mesh and stores the mesh in a
+ * level of detail, in the layout of the OpenGL buffers.
+ * @param level The level of detail.
+ * @param vertices The mesh vertices.
+ * @param faces The mesh faces.
+ */
+void InstancedMesh::set_level(Level& level, const Eigen::MatrixXd& vertices,
+    const Eigen::MatrixXi& faces)
+{
+    // Compute vertex normals
+    Eigen::MatrixXd normals;
+    igl::per_vertex_normals(vertices, faces, normals);
+
+    level.vertices = vertices.cast<float>();
+    level.normals = normals.cast<float>();
+    level.faces = faces.cast<unsigned int>();
+}
+
+/**
+ * @brief Generates the shader program. The instance transform attribute 
+ * spans four attribute locations (one per column).
+ */
+void InstancedMesh::initialize_program(void)
+{
+    igl::opengl::create_shader_program(m_vertex_shader, m_fragment_shader,
+        {{"position", m_position_loc}, {"normal", m_normal_loc},
+        {"instance_transform", m_instance_loc}}, m_program);
+}
+
+/**
+ * @brief Generates the OpenGL buffers of a level of detail. The vertices,
+ * normals and faces are uploaded once. The instance transform attribute
+ * advances once per instance.
+ * @param level The level of detail.
+ */
+void InstancedMesh::initialize_buffers(Level& level)
+{
+    // Generate buffers
+    glGenVertexArrays(1, &level.vao);
+    glGenBuffers(1, &level.vbo_vertices);
+    glGenBuffers(1, &level.vbo_normals);
+    glGenBuffers(1, &level.ebo_faces);
+    glGenBuffers(1, &level.vbo_instances);
+    glBindVertexArray(level.vao);
+
+    // Upload vertices
+    glBindBuffer(GL_ARRAY_BUFFER, level.vbo_vertices);
+    glBufferData(GL_ARRAY_BUFFER, level.vertices.size() * sizeof(float),
+        level.vertices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(m_position_loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(m_position_loc);
+
+    // Upload normals
+    glBindBuffer(GL_ARRAY_BUFFER, level.vbo_normals);
+    glBufferData(GL_ARRAY_BUFFER, level.normals.size() * sizeof(float),
+        level.normals.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(m_normal_loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(m_normal_loc);
+
+    // Upload faces
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, level.ebo_faces);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, level.faces.size() *
+        sizeof(unsigned int), level.faces.data(), GL_STATIC_DRAW);
+
+    // Setup instance transforms (column-major, one column per location)
+    glBindBuffer(GL_ARRAY_BUFFER, level.vbo_instances);
+    for (GLuint i = 0; i < 4; i++)
+    {
+        glVertexAttribPointer(m_instance_loc + i, 4, GL_FLOAT, GL_FALSE,
+            sizeof(Eigen::Matrix4f), (void*) (i * 4 * sizeof(float)));
+        glEnableVertexAttribArray(m_instance_loc + i);
+        glVertexAttribDivisor(m_instance_loc + i, 1);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
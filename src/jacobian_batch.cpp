@@ -0,0 +1,205 @@
+#include "../include/jacobian_batch.h"
+
+/**
+ * @brief It loads the kinematic model of the hand without meshes (see
+ * HandKinematics::initialize) and copies it to every thread.
+ * @param parameters The evaluation parameters.
+ */
+void JacobianBatch::initialize(const Parameters& parameters)
+{
+    // Set parameters
+    m_parameters = parameters;
+    if (m_parameters.threads_num == 0)
+    {
+        m_parameters.threads_num = std::max(1u,
+            std::thread::hardware_concurrency());
+    }
+
+    // Initialize hand model (kinematics only)
+    m_hand.initialize(m_parameters.type, Eigen::Vector3d::Zero(), false);
+    m_links_num = m_hand.get_links_num();
+
+    // Hand models of the threads
+    m_hands.assign(m_parameters.threads_num, m_hand);
+}
+
+/**
+ * @brief It runs a function over the poses, split in contiguous ranges of
+ * at least #m_min_poses_per_thread poses, one per thread. Each thread
+ * uses its own hand model, so the function is called with the hand model
+ * of its thread and the index of the pose.
+ * @param poses_num The number of poses.
+ * @param function The function (hand model, pose index).
+ */
+template <typename Function>
+void JacobianBatch::run(size_t poses_num, Function function)
+{
+    size_t threads_num = std::min(m_hands.size(),
+        std::max((size_t) 1, poses_num / m_min_poses_per_thread));
+
+    // Single thread
+    if (threads_num == 1)
+    {
+        for (size_t i = 0; i < poses_num; i++)
+        {
+            function(m_hands.at(0), i);
+        }
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threads_num; t++)
+    {
+        size_t begin = poses_num * t / threads_num;
+        size_t end = poses_num * (t + 1) / threads_num;
+        threads.emplace_back([this, &function, t, begin, end]
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                function(m_hands.at(t), i);
+            }
+        });
+    }
+    for (auto& thread : threads) { thread.join(); }
+}
+
+/**
+ * @brief It evaluates the Jacobian of every finger at every pose of a
+ * trajectory (see Finger::get_jacobian). The blocks of a pose are stored in
+ * link order (fingers in the order of HandKinematics::get_fingers, links
+ * from the base of the finger), so block j of pose i is at
+ * \f$ i \cdot L + j \f$, with \f$ L \f$ the number of links.
+ * @param poses The hand angles of the trajectory.
+ * @param jacobians The Jacobian blocks (resized).
+ */
+void JacobianBatch::evaluate(const std::vector<AnimatedHand::HandAngles>& poses,
+    std::vector<Finger::JacobianBlock>& jacobians)
+{
+    jacobians.resize(poses.size() * m_links_num);
+
+    run(poses.size(), [this, &poses, &jacobians](HandKinematics& hand,
+        size_t i)
+    {
+        hand.update_kinematics(poses.at(i));
+
+        size_t block_idx = i * m_links_num;
+        for (auto& finger : hand.get_fingers())
+        {
+            for (const auto& block : finger.get_jacobian())
+            {
+                jacobians.at(block_idx++) = block;
+            }
+        }
+    });
+}
+
+/**
+ * @brief It maps the joint velocities of a trajectory to the twists of the
+ * fingertips (see HandKinematics::get_tip_twists). The twists of a pose are
+ * stored in finger order, so the twist of finger j at pose i is at
+ * \f$ i \cdot F + j \f$, with \f$ F \f$ the number of fingers.
+ * @param poses The hand angles of the trajectory.
+ * @param euler_rates The rates of the hand angles at every pose (rad/s, see
+ * #get_rates, one per pose).
+ * @param twists The fingertip twists (resized).
+ * @throws std::out_of_range If there are fewer rates than poses (checked
+ * before the threads start, which could not report it).
+ */
+void JacobianBatch::get_tip_twists(
+    const std::vector<AnimatedHand::HandAngles>& poses,
+    const std::vector<AnimatedHand::HandAngles>& euler_rates,
+    std::vector<HandKinematics::Twist>& twists)
+{
+    if (euler_rates.size() < poses.size())
+    {
+        throw std::out_of_range("JacobianBatch: not enough euler rates");
+    }
+
+    size_t fingers_num = get_fingers_num();
+    twists.resize(poses.size() * fingers_num);
+
+    run(poses.size(), [&poses, &euler_rates, &twists, fingers_num](
+        HandKinematics& hand, size_t i)
+    {
+        // Fingertip twists of the pose (no allocation after the first pose)
+        thread_local std::vector<HandKinematics::Twist> pose_twists;
+
+        hand.update_kinematics(poses.at(i));
+        hand.get_tip_twists(euler_rates.at(i), pose_twists);
+        std::copy(pose_twists.begin(), pose_twists.end(),
+            twists.begin() + i * fingers_num);
+    });
+}
+
+/**
+ * @brief It maps the wrenches applied at the fingertips along a trajectory
+ * to the generalized forces of the hand angles (see
+ * HandKinematics::get_joint_torques).
+ * @param poses The hand angles of the trajectory.
+ * @param wrenches The fingertip wrenches at every pose, in finger order
+ * (\f$ i \cdot F + j \f$ for finger j at pose i).
+ * @param torques The generalized forces of the hand angles at every pose
+ * (resized).
+ * @throws std::invalid_argument If there is not one wrench per finger and
+ * pose (checked before the threads start, which could not report it).
+ */
+void JacobianBatch::get_joint_torques(
+    const std::vector<AnimatedHand::HandAngles>& poses,
+    const std::vector<HandKinematics::Wrench>& wrenches,
+    std::vector<AnimatedHand::HandAngles>& torques)
+{
+    size_t fingers_num = get_fingers_num();
+    if (wrenches.size() != poses.size() * fingers_num)
+    {
+        throw std::invalid_argument("JacobianBatch: one wrench per finger "
+            "and pose expected");
+    }
+
+    torques.resize(poses.size());
+
+    run(poses.size(), [&poses, &wrenches, &torques, fingers_num](
+        HandKinematics& hand, size_t i)
+    {
+        // Fingertip wrenches of the pose
+        thread_local std::vector<HandKinematics::Wrench> pose_wrenches;
+        pose_wrenches.assign(wrenches.begin() + i * fingers_num,
+            wrenches.begin() + (i + 1) * fingers_num);
+
+        hand.update_kinematics(poses.at(i));
+        hand.get_joint_torques(pose_wrenches, torques.at(i));
+    });
+}
+
+/**
+ * @brief It estimates the rates of the hand angles of a uniformly sampled
+ * trajectory with central differences (one-sided at both ends).
+ * @param poses The hand angles of the trajectory.
+ * @param sample_time The time between two poses (s).
+ * @param euler_rates The rates of the hand angles (rad/s, resized).
+ */
+void JacobianBatch::get_rates(const std::vector<AnimatedHand::HandAngles>& poses,
+    double sample_time, std::vector<AnimatedHand::HandAngles>& euler_rates)
+{
+    euler_rates.resize(poses.size());
+    if (poses.size() < 2)
+    {
+        for (auto& rates : euler_rates)
+        {
+            for (auto& rate : rates) { rate.setZero(); }
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < poses.size(); i++)
+    {
+        size_t previous = (i == 0) ? 0 : i - 1;
+        size_t next = std::min(i + 1, poses.size() - 1);
+        double time = (next - previous) * sample_time;
+
+        for (size_t k = 0; k < AnimatedHand::frames_num; k++)
+        {
+            euler_rates.at(i).at(k) = (poses.at(next).at(k) -
+                poses.at(previous).at(k)) / time;
+        }
+    }
+}
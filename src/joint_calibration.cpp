@@ -0,0 +1,178 @@
+#include "../include/joint_calibration.h"
+
+/**
+ * @brief Initializes the arrays of the channels. The polynomials are padded
+ * with zero coefficients to the highest degree, and an empty polynomial is
+ * the identity.
+ * @param parameters The parameters of each channel.
+ */
+void JointCalibration::initialize(const std::vector<Parameters>& parameters)
+{
+    // Number of channels and of coefficients
+    size_t channels = parameters.size();
+    size_t coefficients_num = 2;
+    for (const auto& channel : parameters)
+    {
+        coefficients_num = std::max(coefficients_num,
+            channel.polynomial.size());
+    }
+
+    // Initialize parameters
+    m_offset.resize(channels);
+    m_gain.resize(channels);
+    m_min.resize(channels);
+    m_max.resize(channels);
+    m_coefficients = Eigen::ArrayXXd::Zero(coefficients_num, channels);
+
+    for (size_t i = 0; i < channels; i++)
+    {
+        const Parameters& channel = parameters.at(i);
+        m_offset(i) = channel.offset;
+        m_gain(i) = channel.gain;
+        m_min(i) = std::min(channel.min, channel.max);
+        m_max(i) = std::max(channel.min, channel.max);
+
+        if (channel.polynomial.empty()) { m_coefficients(1, i) = 1.0; }
+        for (size_t k = 0; k < channel.polynomial.size(); k++)
+        {
+            m_coefficients(k, i) = channel.polynomial.at(k);
+        }
+    }
+
+    // Preallocate sample
+    m_value = Eigen::ArrayXd::Zero(channels);
+}
+
+/**
+ * @brief Loads the parameters of the channels from the calibration file
+ * (#m_config_rel_path). Channels that are missing from the file are not
+ * calibrated (identity, no limits). The limits of the file are anatomical:
+ * they are given in the direction of the axis of the hand frame that the
+ * channel drives (e.g. positive flexion), so the limits of a channel whose
+ * reading turns its axis the other way are negated and swapped. The file
+ * can be edited while the stream runs and loaded again, so a malformed file
+ * is reported instead of thrown.
+ * @param signs The sign of each channel of the glove, i.e. the direction of
+ * its axis for a positive reading (see AnimatedHand::get_channel_signs).
+ * @param parameters The parameters of each channel (overwritten).
+ * @param config_rel_path Relative path of the calibration file.
+ * @return true The file has been loaded.
+ * @return false The file does not exist or is malformed (every channel is
+ * the identity).
+ */
+bool JointCalibration::load_parameters(const std::vector<double>& signs,
+    std::vector<Parameters>& parameters, const std::string& config_rel_path)
+{
+    size_t channels_num = signs.size();
+    parameters.assign(channels_num, Parameters());
+
+    // Define absolute path of calibration file
+    auto config_abs_path = std::filesystem::current_path() / config_rel_path;
+    if (!std::filesystem::exists(config_abs_path)) { return false; }
+
+    // Parse json file
+    try
+    {
+        std::ifstream file(config_abs_path);
+        nlohmann::json json_file = nlohmann::json::parse(file);
+
+        for (const auto& channel_json : json_file.at("Channels"))
+        {
+            size_t index = channel_json.at("Index");
+            if (index >= channels_num) { continue; }
+
+            Parameters& channel = parameters.at(index);
+            channel.offset = channel_json.value("Offset", 0.0);
+            channel.gain = channel_json.value("Gain", 1.0);
+            channel.polynomial = channel_json.value("Polynomial",
+                std::vector<double>{0.0, 1.0});
+            channel.min = channel_json.value("Min", channel.min);
+            channel.max = channel_json.value("Max", channel.max);
+
+            // Limits in the direction of the reading
+            if (signs.at(index) < 0.0)
+            {
+                std::swap(channel.min, channel.max);
+                channel.min = -channel.min;
+                channel.max = -channel.max;
+            }
+        }
+    }
+    catch (const nlohmann::json::exception& exception)
+    {
+        std::cerr << "[JointCalibration] Cannot load " << config_rel_path <<
+            ": " << exception.what() << std::endl;
+        parameters.assign(channels_num, Parameters());
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Calibrates a sample of all the channels in place: offset and gain,
+ * polynomial correction (Horner's scheme, from the highest degree) and
+ * clamping to the anatomical limits.
+ * @param sample Pointer to the sample (one reading per channel, deg).
+ */
+void JointCalibration::apply(double* sample)
+{
+    Eigen::Map<Eigen::ArrayXd> x(sample, m_offset.size());
+
+    // Offset and gain
+    x = m_gain * (x - m_offset);
+
+    // Nonlinearity correction
+    Eigen::Index degree = m_coefficients.rows() - 1;
+    m_value = m_coefficients.row(degree).transpose();
+    for (Eigen::Index k = degree - 1; k >= 0; k--)
+    {
+        m_value = m_value * x + m_coefficients.row(k).transpose();
+    }
+
+    // Anatomical limits
+    x = m_value.max(m_min).min(m_max);
+}
+
+/**
+ * @brief Converts a sample of joint angles of all the channels to readings
+ * in place (inverse of #apply), e.g. to write the joint angles solved from
+ * fingertip positions as a glove session (see HandIK::). The angles are
+ * clamped to the anatomical limits, the polynomial is inverted with
+ * Newton's method from the angle itself (exact in one step for a linear
+ * correction) and the gain and offset are removed. A channel with a zero
+ * gain reads its offset.
+ * @param sample Pointer to the sample (one joint angle per channel, deg).
+ */
+void JointCalibration::invert(double* sample)
+{
+    Eigen::Index degree = m_coefficients.rows() - 1;
+
+    for (Eigen::Index i = 0; i < m_offset.size(); i++)
+    {
+        // Anatomical limits
+        double angle = std::clamp(sample[i], m_min(i), m_max(i));
+
+        // Nonlinearity correction (Newton's method)
+        double x = angle;
+        for (int iteration = 0; iteration < m_max_iterations; iteration++)
+        {
+            double value = m_coefficients(degree, i);
+            double derivative = 0.0;
+            for (Eigen::Index k = degree - 1; k >= 0; k--)
+            {
+                derivative = derivative * x + value;
+                value = value * x + m_coefficients(k, i);
+            }
+            if (derivative == 0.0) { break; }
+
+            double step = (value - angle) / derivative;
+            x -= step;
+            if (std::abs(step) < m_tolerance) { break; }
+        }
+
+        // Offset and gain
+        sample[i] = m_gain(i) != 0.0 ? x / m_gain(i) + m_offset(i) :
+            m_offset(i);
+    }
+}
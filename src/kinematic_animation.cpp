@@ -20,6 +20,13 @@ void KinematicAnimation::initialize(igl::opengl::glfw::Viewer* viewer,
     // Get menu handler pointer
     m_menu_handler = menu_handler;
 
+    // Initialize hand pose and pose history
+    for (auto& euler : m_euler_id) { euler.setZero(); }
+    m_pose_history.initialize();
+
+    // Load scheduling options of the threads
+    m_thread_scheduler.initialize();
+
     // Set camera center
     m_camera_center << -0.1, -0.1, 0.0, 0.1, -0.1, 0.0, 0.0, 0.1, 0.0;
 }
@@ -35,6 +42,9 @@ void KinematicAnimation::initialize(igl::opengl::glfw::Viewer* viewer,
  */
 bool KinematicAnimation::animation_loop(igl::opengl::glfw::Viewer& viewer)
 {
+    // Release temporary matrices of the previous frame
+    m_frame_arena.reset();
+
     if (viewer.core().is_animating)
     {
         viewer.core().align_camera_center(m_camera_center);
@@ -42,6 +52,9 @@ bool KinematicAnimation::animation_loop(igl::opengl::glfw::Viewer& viewer)
         // Initialize if ports are set
         if (m_menu_handler->are_ports_set() && m_initialize_animation)
         {
+            // Start cold start measurement
+            m_setup_time = std::chrono::steady_clock::now();
+
             // Setup exoskeleton
             setup_exoskeletons(viewer);
 
@@ -51,23 +64,174 @@ bool KinematicAnimation::animation_loop(igl::opengl::glfw::Viewer& viewer)
 
         if(m_menu_handler->are_ports_set())
         {
+            // Reload calibration (installed on the next hand over)
+            if (m_menu_handler->take_calibration_request())
+            {
+                load_calibration();
+            }
+
             // Get euler angles
-            auto euler_id =
-                m_anim_hand->get_hand_angles(m_left_exo->get_joint_angles());
-            
+            update_hand_angles();
+
+            // Report stream timing, health, scheduling and arena usage
+            m_menu_handler->set_timing_statistics(
+                m_left_exo->get_timing_statistics());
+            m_menu_handler->set_stream_health(m_left_exo->get_stream_health());
+            m_menu_handler->set_scheduling_status(
+                m_left_exo->get_scheduling_status(), m_compute_status,
+                m_thread_scheduler.is_memory_locked());
+            m_menu_handler->set_frame_arena(
+                m_frame_arena.get_high_water_mark(),
+                m_frame_arena.get_allocation_num());
+
+            // Clear instances of the previous frame
+            m_joint_mesh.clear_instances();
+            m_bone_mesh.clear_instances();
+
             // Update left hand
-            m_left_hand.update(euler_id, viewer);
-            
+            m_left_hand.update(m_euler_id, viewer);
+
             // Update right hand
-            m_right_hand.update(euler_id, viewer);
+            m_right_hand.update(m_euler_id, viewer);
+
+            // Report finger and hand distances
+            update_contacts();
+
+            // Add instances of the hands
+            if (m_render_mode == Hand::RenderMode::Instanced)
+            {
+                add_hand_instances(viewer);
+            }
+
+            // Report cold start time (first frame)
+            if (!m_cold_start_measured)
+            {
+                m_menu_handler->set_cold_start_time(
+                    std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - m_setup_time).count());
+                m_cold_start_measured = 1;
+            }
         }
     } 
     return false;
 }
 
+/**
+ * @brief This is the draw callback of the instance plugin (see
+ * InstancePlugin::). If the hands are rendered in instanced mode, it draws
+ * all the joint and bone instances (see InstancedMesh::) after the viewer
+ * data and before the menu. The function is passed as a lambda function to
+ * the plugin (see main.cpp).
+ * @param viewer Reference to the viewer handle.
+ * @return false Drawing continues as usual.
+ */
+bool KinematicAnimation::draw_instances(igl::opengl::glfw::Viewer& viewer)
+{
+    if (m_render_mode == Hand::RenderMode::Instanced)
+    {
+        m_joint_mesh.draw(viewer.core());
+        m_bone_mesh.draw(viewer.core());
+    }
+    return false;
+}
+
+/**
+ * @brief It converts the glove samples received since the previous frame to 
+ * hand poses and pushes them to the pose history. It then samples the 
+ * history at the display time (current time plus #m_display_offset), 
+ * so the rendered pose does not depend on the age of the newest sample 
+ * (see PoseHistory::). Until the first sample arrives the previous pose 
+ * is kept.
+ */
+void KinematicAnimation::update_hand_angles(void)
+{
+    // Get new glove samples (one column per sample)
+    Eigen::Map<Eigen::MatrixXd> samples =
+        m_left_exo->get_joint_samples(m_frame_arena);
+
+    // Push hand poses
+    for (Eigen::Index i = 0; i < samples.cols(); i++)
+    {
+        m_anim_hand->get_hand_angles(
+            &samples(Exoskeleton::joint_angles_row, i), m_euler_id);
+        m_pose_history.push(samples(Exoskeleton::time_row, i), m_euler_id);
+    }
+
+    // Sample hand pose at the display time
+    m_pose_history.sample(Utils::monotonic_time() + m_display_offset,
+        m_euler_id);
+}
+
+/**
+ * @brief It selects the level of detail of each hand from its projected size 
+ * on the screen and the triangle budget (see LodSelector::), and adds the 
+ * joint and bone instances of the hands at the selected levels.
+ * @param viewer Reference to the viewer handle.
+ */
+void KinematicAnimation::add_hand_instances(igl::opengl::glfw::Viewer& viewer)
+{
+    // Hands
+    Hand* hands[2] = {&m_left_hand, &m_right_hand};
+
+    // Projected size of the hands
+    m_hand_sizes.resize(2);
+    for (size_t i = 0; i < 2; i++)
+    {
+        Eigen::Vector3d center;
+        double radius;
+        hands[i]->get_bounding_sphere(center, radius);
+        m_hand_sizes.at(i) = LodSelector::projected_size(center, radius,
+            viewer.core());
+    }
+
+    // Select levels of detail
+    const std::vector<size_t>& levels = m_lod_selector.select(m_hand_sizes);
+
+    // Add instances
+    for (size_t i = 0; i < 2; i++) { hands[i]->add_instances(levels.at(i)); }
+}
+
+/**
+ * @brief It refits the capsules of both hands to their new pose (see
+ * HandCollision::) and reports the distance between the thumb and the index
+ * of each hand and the distance between the hands to the menu.
+ */
+void KinematicAnimation::update_contacts(void)
+{
+    m_left_collision.update(m_left_hand.get_kinematics());
+    m_right_collision.update(m_right_hand.get_kinematics());
+
+    m_menu_handler->set_contact_distances(
+        m_left_collision.get_finger_distance(0, 1).distance,
+        m_right_collision.get_finger_distance(0, 1).distance,
+        m_left_collision.get_distance(m_right_collision).distance);
+}
+
+/**
+ * @brief It loads the calibration of the glove channels from the
+ * calibration file (see JointCalibration::load_parameters) and sets it on
+ * the exoskeleton, which applies it on the acquisition thread from the next
+ * hand over of the samples. The file is parsed here, on the compute thread,
+ * so the stream is not paused.
+ */
+void KinematicAnimation::load_calibration(void)
+{
+    std::vector<JointCalibration::Parameters> parameters;
+    bool is_loaded = JointCalibration::load_parameters(
+        m_anim_hand->get_channel_signs(), parameters);
+
+    JointCalibration calibration;
+    calibration.initialize(parameters);
+    m_left_exo->set_calibration(calibration);
+    m_menu_handler->set_calibration_loaded(is_loaded);
+}
+
 /**
  * @brief This function setups the exoskeletons. It initializes the 
- * serial communications, the exoskeleton and the hand objects.
+ * serial communications, the exoskeleton and the hand objects. It also 
+ * applies the scheduling options of the compute thread (the calling one) 
+ * and of the acquisition thread, and locks the memory once the meshes are 
+ * loaded (see ThreadScheduler::).
  * @param viewer A reference to the viewer handle.
  */
 void KinematicAnimation::setup_exoskeletons(igl::opengl::glfw::Viewer& viewer)
@@ -81,14 +245,59 @@ void KinematicAnimation::setup_exoskeletons(igl::opengl::glfw::Viewer& viewer)
     // Define baudrate
     unsigned int baud_rate = 115200;
     
+    // Apply scheduling parameters of the compute thread
+    m_compute_status = ThreadScheduler::apply(
+        m_thread_scheduler.get_compute_parameters());
+
+    // Load calibration of the channels (installed before the first sample)
+    load_calibration();
+
     // Initialize left exoskeleton
-    m_left_exo->initialize(serial_com_left, baud_rate);
+    m_left_exo->initialize(serial_com_left, baud_rate,
+        m_anim_hand->get_channels_num(), m_anim_hand->get_filter_parameters(),
+        m_thread_scheduler.get_acquisition_parameters(),
+        m_anim_hand->get_sequence_bits());
 
     // Initialize right exoskeleton (to be done)
 
+    // Get render mode
+    m_render_mode = (Hand::RenderMode) m_menu_handler->get_render_mode();
+
+    // Load the instanced meshes once (shared by both hands)
+    if (m_render_mode == Hand::RenderMode::Instanced)
+    {
+        m_joint_mesh.initialize((std::filesystem::current_path() /
+            Finger::get_joint_filename()).string(), m_lod_num);
+        m_bone_mesh.initialize((std::filesystem::current_path() /
+            Finger::get_bone_filename()).string(), m_lod_num);
+    }
+
     // Initialize left hand 
-    m_left_hand.initialize(&viewer, m_left_exo, m_anim_hand, 0, m_left_origin);
+    m_left_hand.initialize(&viewer, 0, m_left_origin,
+        m_render_mode, &m_joint_mesh, &m_bone_mesh);
 
     // Initialize right hand
-    m_right_hand.initialize(&viewer, m_left_exo, m_anim_hand, 1, m_right_origin);
+    m_right_hand.initialize(&viewer, 1, m_right_origin,
+        m_render_mode, &m_joint_mesh, &m_bone_mesh);
+
+    // Initialize capsules of the hands
+    m_left_collision.initialize(m_left_hand.get_kinematics(),
+        HandCollision::Parameters());
+    m_right_collision.initialize(m_right_hand.get_kinematics(),
+        HandCollision::Parameters());
+
+    // Initialize level of detail selector (triangles of a hand per level)
+    if (m_render_mode == Hand::RenderMode::Instanced)
+    {
+        std::vector<size_t> lod_triangles(m_joint_mesh.get_lod_num());
+        for (size_t i = 0; i < lod_triangles.size(); i++)
+        {
+            lod_triangles.at(i) = m_left_hand.get_links_num() *
+                (m_joint_mesh.get_faces_num(i) + m_bone_mesh.get_faces_num(i));
+        }
+        m_lod_selector.initialize(lod_triangles, m_triangle_budget);
+    }
+
+    // Lock memory
+    m_thread_scheduler.lock_memory();
 }
\ No newline at end of file
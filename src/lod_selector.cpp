@@ -0,0 +1,138 @@
+#include "../include/lod_selector.h"
+
+/**
+ * @brief Initializes the selector.
+ * @param lod_triangles The number of triangles of an object at each level of
+ * detail (level 0 is the finest).
+ * @param triangle_budget The global triangle budget of all the objects.
+ * @param full_detail_size The projected size (pixels) above which the full
+ * detail is used.
+ * @param hysteresis The relative margin of the level boundaries.
+ */
+void LodSelector::initialize(const std::vector<size_t>& lod_triangles,
+    size_t triangle_budget, double full_detail_size, double hysteresis)
+{
+    m_lod_triangles = lod_triangles;
+    m_triangle_budget = triangle_budget;
+    m_full_detail_size = full_detail_size;
+    m_hysteresis = hysteresis;
+    m_levels.clear();
+}
+
+/**
+ * @brief Selects the level of detail of each object. The levels of the
+ * previous call are kept unless the projected size has crossed a level
+ * boundary by the hysteresis margin. The levels are then coarsened, smallest
+ * object first, until the triangle budget is met.
+ * @param sizes The projected size (pixels) of each object.
+ * @return const std::vector<size_t>& The level of each object.
+ */
+const std::vector<size_t>& LodSelector::select(const std::vector<double>& sizes)
+{
+    // New objects start at their desired level
+    if (m_levels.size() != sizes.size())
+    {
+        m_levels.resize(sizes.size());
+        for (size_t i = 0; i < sizes.size(); i++)
+        {
+            m_levels.at(i) = size_level(sizes.at(i));
+        }
+    }
+
+    // Apply the size levels with hysteresis
+    for (size_t i = 0; i < sizes.size(); i++)
+    {
+        size_t& level = m_levels.at(i);
+
+        // Finer level (the size must exceed the boundary by the margin)
+        size_t finer = size_level(sizes.at(i) / (1.0 + m_hysteresis));
+        if (finer < level) { level = finer; }
+
+        // Coarser level (the size must fall below the boundary by the margin)
+        size_t coarser = size_level(sizes.at(i) / (1.0 - m_hysteresis));
+        if (coarser > level) { level = coarser; }
+    }
+
+    // Apply the triangle budget
+    size_t triangles = get_triangles_num();
+    while (triangles > m_triangle_budget)
+    {
+        // Find the smallest object that can be coarsened
+        size_t idx = sizes.size();
+        for (size_t i = 0; i < sizes.size(); i++)
+        {
+            if (m_levels.at(i) + 1 < m_lod_triangles.size() &&
+                (idx == sizes.size() || sizes.at(i) < sizes.at(idx)))
+            {
+                idx = i;
+            }
+        }
+
+        // Every object is at the coarsest level
+        if (idx == sizes.size()) { break; }
+
+        // Coarsen object
+        triangles -= m_lod_triangles.at(m_levels.at(idx));
+        m_levels.at(idx)++;
+        triangles += m_lod_triangles.at(m_levels.at(idx));
+    }
+
+    return m_levels;
+}
+
+/**
+ * @brief Returns the number of triangles of all the objects at their
+ * selected levels.
+ * @return size_t The number of triangles.
+ */
+size_t LodSelector::get_triangles_num(void)
+{
+    size_t triangles = 0;
+    for (size_t level : m_levels) { triangles += m_lod_triangles.at(level); }
+    return triangles;
+}
+
+/**
+ * @brief Computes the projected size (diameter in pixels) of a bounding
+ * sphere with the camera of the viewer core.
+ * @param center The center of the sphere.
+ * @param radius The radius of the sphere.
+ * @param core Reference to the viewer core.
+ * @return double The projected size (pixels). If the sphere is behind the
+ * camera it is considered infinitely large.
+ */
+double LodSelector::projected_size(const Eigen::Vector3d& center,
+    double radius, const igl::opengl::ViewerCore& core)
+{
+    // Depth of the center in the eye frame
+    Eigen::Vector4f center_eye = core.view *
+        Eigen::Vector4f(center(0), center(1), center(2), 1.0);
+    double depth = -center_eye(2);
+
+    // Perspective projection (the orthographic one has no depth scaling)
+    double scale = (core.proj(3, 3) == 0.0) ? core.proj(1, 1) / depth :
+        core.proj(1, 1);
+    if (scale <= 0.0) { return std::numeric_limits<double>::infinity(); }
+
+    return radius * scale * core.viewport(3);
+}
+
+/**
+ * @brief Returns the level of detail of a projected size, i.e. one level
+ * coarser every time the size halves below #m_full_detail_size.
+ * @param size The projected size (pixels).
+ * @return size_t The level of detail.
+ */
+size_t LodSelector::size_level(double size)
+{
+    size_t level = 0;
+    double boundary = m_full_detail_size;
+
+    while (size < boundary && level + 1 < m_lod_triangles.size())
+    {
+        level++;
+        boundary *= 0.5;
+    }
+
+    return level;
+}
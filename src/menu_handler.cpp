@@ -41,6 +41,9 @@ void MenuHandler::callback(void)
             // Get right exoskeleton port
             ImGui::Combo("Right exoskeleton", &right_exo_idx_choise,
                 available_ports);
+
+            // Get rendering path
+            ImGui::Combo("Rendering", &m_render_mode, m_render_modes);
         
             if (ImGui::Button("OK"))
             {
@@ -50,6 +53,85 @@ void MenuHandler::callback(void)
             }
         }
     }
+
+    // Add statistics group
+    if (m_cold_start_time >= 0.0 &&
+        ImGui::CollapsingHeader("Statistics", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        ImGui::Text("Cold start: %.1f ms", m_cold_start_time);
+
+        // Stream timing
+        const ClockSync::Statistics& timing = m_timing_statistics;
+        ImGui::Text("Interval: %.2f ms (std %.2f, min %.2f, max %.2f)",
+            1e3 * timing.interval_mean, 1e3 * timing.interval_std,
+            1e3 * timing.interval_min, 1e3 * timing.interval_max);
+        if (timing.is_synchronized)
+        {
+            ImGui::Text("Device jitter: %.3f ms, host jitter: %.3f ms",
+                1e3 * timing.device_interval_std, 1e3 * timing.residual_std);
+            ImGui::Text("Clock drift: %.1f ppm", timing.drift_ppm);
+        }
+
+        // Stream health
+        const StreamHealth::Statistics& health = m_stream_health;
+        ImGui::Text("Sample rate: %.1f Hz", health.sample_rate);
+        ImGui::Text("Lines: %lu (malformed %lu, short %lu, overlong %lu)",
+            (unsigned long) health.lines, (unsigned long) health.malformed,
+            (unsigned long) health.short_lines, (unsigned long) health.overlong);
+        if (health.has_sequence)
+        {
+            ImGui::Text("Lost lines: %lu (%lu gaps)", (unsigned long) health.lost,
+                (unsigned long) health.sequence_gaps);
+            ImGui::Text("Duplicate lines: %lu",
+                (unsigned long) health.duplicates);
+        }
+        ImGui::Text("Dropped samples: %lu", (unsigned long) health.dropped);
+        if (health.has_overrun_counters)
+        {
+            ImGui::Text("UART overruns: %lu (buffer %lu)",
+                (unsigned long) health.overruns,
+                (unsigned long) health.buffer_overruns);
+        }
+
+        // Thread scheduling
+        const char* names[2] = {"Acquisition", "Compute"};
+        const ThreadScheduler::Status* status[2] = {&m_acquisition_status,
+            &m_compute_status};
+        for (size_t i = 0; i < 2; i++)
+        {
+            if (status[i]->is_realtime)
+            {
+                ImGui::Text("%s thread: SCHED_FIFO %d%s", names[i],
+                    status[i]->priority, status[i]->is_pinned ? ", pinned" : "");
+            }
+            else
+            {
+                ImGui::Text("%s thread: default%s", names[i],
+                    status[i]->is_pinned ? ", pinned" : "");
+            }
+        }
+        ImGui::Text("Memory: %s", m_memory_locked ? "locked" : "not locked");
+
+        // Frame arena (stops growing after the largest batch of samples)
+        ImGui::Text("Frame arena: %lu bytes (allocations %lu)",
+            (unsigned long) m_arena_high_water_mark,
+            (unsigned long) m_arena_allocations_num);
+
+        // Calibration (reloaded without stopping the stream)
+        ImGui::Text("Calibration: %s", m_calibration_loaded ? "loaded" :
+            "none (identity)");
+        if (ImGui::Button("Reload calibration"))
+        {
+            m_calibration_requested = 1;
+        }
+
+        // Contacts (negative distances are interpenetrations)
+        ImGui::Text("Thumb-index: %.1f mm (left), %.1f mm (right)%s",
+            1e3 * m_pinch_distances[0], 1e3 * m_pinch_distances[1],
+            std::min(m_pinch_distances[0], m_pinch_distances[1]) <= 0.0 ?
+            ", contact" : "");
+        ImGui::Text("Hands: %.1f mm", 1e3 * m_hands_distance);
+    }
 }
 
 /**
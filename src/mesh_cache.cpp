@@ -0,0 +1,228 @@
+#include "../include/mesh_cache.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Maps a cache file and validates its header, its key and the bounds
+ * of its arrays. On failure the file is unmapped and the cache is empty.
+ * @param filename The cache filename.
+ * @param key The expected key (see #hash).
+ * @return true The cache is valid.
+ * @return false The cache is missing, stale or corrupt.
+ */
+bool MeshCache::open(const std::filesystem::path& filename, uint64_t key)
+{
+    close();
+
+    // Map file
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) { return false; }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size < (off_t) sizeof(Header))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) { return false; }
+
+    m_data = (const uint8_t*) data;
+    m_size = file_stat.st_size;
+
+    // Validate header
+    const Header* header = (const Header*) m_data;
+    size_t table_end = sizeof(Header) + header->meshes_num * sizeof(Entry);
+    if (std::memcmp(header->magic, m_magic, sizeof(m_magic)) != 0 ||
+        header->version != m_version ||
+        header->scalar_size != sizeof(VertexScalar) || header->key != key ||
+        table_end > m_size)
+    {
+        close();
+        return false;
+    }
+
+    m_entries = (const Entry*) (m_data + sizeof(Header));
+    m_entries_num = header->meshes_num;
+
+    // Validate arrays
+    for (size_t i = 0; i < m_entries_num; i++)
+    {
+        const Entry& entry = m_entries[i];
+        if (entry.vertices_offset + 3 * entry.vertices_num *
+            sizeof(VertexScalar) >
+            m_size || entry.faces_offset + 3 * entry.faces_num * sizeof(int) >
+            m_size)
+        {
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Unmaps the cache file.
+ */
+void MeshCache::close(void)
+{
+    if (m_data != nullptr) { munmap((void*) m_data, m_size); }
+
+    m_data = nullptr;
+    m_size = 0;
+    m_entries = nullptr;
+    m_entries_num = 0;
+}
+
+/**
+ * @brief Returns the vertices of a mesh. They point directly to the mapped
+ * file, so they are valid until the cache is closed.
+ * @param idx The index of the mesh.
+ * @return Eigen::Map<const MeshCache::VerticesMatrix> The vertices (3xN).
+ */
+Eigen::Map<const MeshCache::VerticesMatrix> MeshCache::get_vertices(
+    size_t idx)
+{
+    const Entry& entry = m_entries[idx];
+    return Eigen::Map<const VerticesMatrix>(
+        (const VertexScalar*) (m_data + entry.vertices_offset), 3,
+        entry.vertices_num);
+}
+
+/**
+ * @brief Returns the faces of a mesh. They point directly to the mapped
+ * file, so they are valid until the cache is closed.
+ * @param idx The index of the mesh.
+ * @return Eigen::Map<const MeshCache::FacesMatrix> The faces (Fx3).
+ */
+Eigen::Map<const MeshCache::FacesMatrix> MeshCache::get_faces(size_t idx)
+{
+    const Entry& entry = m_entries[idx];
+    return Eigen::Map<const FacesMatrix>(
+        (const int*) (m_data + entry.faces_offset), entry.faces_num, 3);
+}
+
+/**
+ * @brief Writes a cache file. The file is first written to a temporary file
+ * and then renamed, so a cache that is being read is never half written.
+ * @param filename The cache filename.
+ * @param key The key of the cached data (see #hash).
+ * @param vertices The vertices of the meshes (3xN).
+ * @param faces The faces of the meshes (Fx3).
+ * @return true The cache has been written.
+ * @return false The cache could not be written (e.g. read-only directory).
+ */
+bool MeshCache::write(const std::filesystem::path& filename, uint64_t key,
+    const std::vector<VerticesMatrix>& vertices,
+    const std::vector<FacesMatrix>& faces)
+{
+    // Aligned offset
+    auto align = [](size_t offset) {
+        return (offset + m_alignment - 1) / m_alignment * m_alignment; };
+
+    // Generate header
+    Header header = {};
+    std::memcpy(header.magic, m_magic, sizeof(m_magic));
+    header.version = m_version;
+    header.scalar_size = sizeof(VertexScalar);
+    header.meshes_num = vertices.size();
+    header.key = key;
+
+    // Generate table
+    std::vector<Entry> entries(vertices.size());
+    size_t offset = align(sizeof(Header) + entries.size() * sizeof(Entry));
+
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        entries.at(i).vertices_num = vertices.at(i).cols();
+        entries.at(i).faces_num = faces.at(i).rows();
+        entries.at(i).vertices_offset = offset;
+        offset = align(offset + vertices.at(i).size() * sizeof(VertexScalar));
+        entries.at(i).faces_offset = offset;
+        offset = align(offset + faces.at(i).size() * sizeof(int));
+    }
+
+    // Fill buffer
+    std::vector<uint8_t> buffer(offset, 0);
+    std::memcpy(buffer.data(), &header, sizeof(Header));
+    std::memcpy(buffer.data() + sizeof(Header), entries.data(),
+        entries.size() * sizeof(Entry));
+
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        std::memcpy(buffer.data() + entries.at(i).vertices_offset,
+            vertices.at(i).data(), vertices.at(i).size() *
+            sizeof(VertexScalar));
+        std::memcpy(buffer.data() + entries.at(i).faces_offset,
+            faces.at(i).data(), faces.at(i).size() * sizeof(int));
+    }
+
+    // Write temporary file
+    std::error_code error;
+    std::filesystem::create_directories(filename.parent_path(), error);
+    std::filesystem::path tmp_filename = filename;
+    tmp_filename += ".tmp";
+
+    std::ofstream file(tmp_filename, std::ios::binary | std::ios::trunc);
+    if (!file) { return false; }
+    file.write((const char*) buffer.data(), buffer.size());
+    file.close();
+    if (!file) { return false; }
+
+    // Replace cache file
+    std::filesystem::rename(tmp_filename, filename, error);
+
+    return !error;
+}
+
+/**
+ * @brief Hashes a block of memory with the 64-bit FNV-1a hash. Hashes can be
+ * chained by passing the previous hash as the seed.
+ * @param data Pointer to the data.
+ * @param size The size of the data (bytes).
+ * @param seed The seed (the previous hash).
+ * @return uint64_t The hash.
+ */
+uint64_t MeshCache::hash(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* bytes = (const uint8_t*) data;
+    uint64_t hash = seed;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Hashes the contents of a file (see #hash). A missing file hashes
+ * as an empty one.
+ * @param filename The filename.
+ * @param seed The seed (the previous hash).
+ * @return uint64_t The hash.
+ */
+uint64_t MeshCache::hash_file(const std::filesystem::path& filename,
+    uint64_t seed)
+{
+    // Get file size
+    std::error_code error;
+    size_t size = std::filesystem::file_size(filename, error);
+    if (error) { return hash(nullptr, 0, seed); }
+
+    // Read file
+    std::vector<char> contents(size);
+    std::ifstream file(filename, std::ios::binary);
+    file.read(contents.data(), size);
+
+    return hash(contents.data(), file.gcount(), seed);
+}
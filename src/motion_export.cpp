@@ -0,0 +1,398 @@
+#include "../include/motion_export.h"
+
+/**
+ * @brief It builds the skeleton from the fingers of the hand model: the
+ * offset of the first joint of a finger is the origin of the finger, the
+ * offset of the next joints is the length of the previous link, and the
+ * fingertip ends the chain (see Finger::get_tip_position). The rest pose
+ * has no rotation.
+ * @param hand The hand model (see HandKinematics::initialize).
+ * @param type Defines whether the hand is the left one (0) or the right one (1).
+ * @param frame_time The time between two frames (s).
+ */
+void MotionExport::initialize(HandKinematics& hand, bool type,
+    double frame_time)
+{
+    m_type = type;
+    m_frame_time = frame_time;
+
+    // Root joint (base frame of the hand)
+    m_joints.clear();
+    m_joints.push_back(Joint{"Hand", -1, Eigen::Vector3d::Zero(), -1});
+
+    const std::vector<std::string>& finger_names = hand.get_finger_names();
+    std::vector<Finger>& fingers = hand.get_fingers();
+
+    for (size_t i = 0; i < fingers.size(); i++)
+    {
+        const std::vector<dm::JointState>& state = fingers.at(i).get_state();
+        const std::vector<int>& frame_ids = fingers.at(i).get_frame_ids();
+
+        // Finger joints
+        int parent = 0;
+        for (size_t j = 0; j < state.size(); j++)
+        {
+            Eigen::Vector3d offset = state.at(j).position;
+            if (m_type) { offset(1) = -offset(1); }
+
+            m_joints.push_back(Joint{finger_names.at(i) + std::to_string(j),
+                parent, offset, frame_ids.at(j)});
+            parent = m_joints.size() - 1;
+        }
+
+        // Fingertip
+        m_joints.push_back(Joint{finger_names.at(i) + "Tip", parent,
+            Eigen::Vector3d(fingers.at(i).get_link_lengths().back(), 0.0, 0.0),
+            -1});
+    }
+
+    // Number of animated joints
+    m_animated_num = 0;
+    for (const auto& joint : m_joints)
+    {
+        if (joint.frame_id >= 0) { m_animated_num++; }
+    }
+}
+
+/**
+ * @brief Returns the BVH header: the hierarchy of the skeleton, followed by
+ * the number of frames and the frame time. The root has position and
+ * rotation channels (always zero), the finger joints have the rotation
+ * channels Z, Y and X, the order of the euler angles of the hand (see
+ * EulerRotations::rotation), and the fingertips are end sites. The offsets
+ * are in meters.
+ * @param frames_num The number of frames.
+ * @return std::string The header.
+ */
+std::string MotionExport::get_bvh_header(size_t frames_num)
+{
+    std::string output = "HIERARCHY\n";
+    append_bvh_joint(0, 0, output);
+
+    output += "MOTION\nFrames: " + std::to_string(frames_num) +
+        "\nFrame Time: ";
+    append_number(m_frame_time, output);
+    output += "\n";
+
+    return output;
+}
+
+/**
+ * @brief It appends the hierarchy of a joint and of its children to the
+ * BVH header.
+ * @param joint_idx The joint idx.
+ * @param depth The depth of the joint (indentation).
+ * @param output The header.
+ */
+void MotionExport::append_bvh_joint(size_t joint_idx, size_t depth,
+    std::string& output)
+{
+    const Joint& joint = m_joints.at(joint_idx);
+    std::string indent(depth, '\t');
+
+    // Joint name (fingertips are end sites)
+    if (joint.parent < 0) { output += indent + "ROOT " + joint.name + "\n"; }
+    else if (joint.frame_id < 0) { output += indent + "End Site\n"; }
+    else { output += indent + "JOINT " + joint.name + "\n"; }
+    output += indent + "{\n";
+
+    // Offset
+    output += indent + "\tOFFSET";
+    for (size_t k = 0; k < 3; k++)
+    {
+        output += " ";
+        append_number(joint.offset(k), output);
+    }
+    output += "\n";
+
+    // Channels
+    if (joint.parent < 0)
+    {
+        output += indent + "\tCHANNELS 6 Xposition Yposition Zposition "
+            "Zrotation Yrotation Xrotation\n";
+    }
+    else if (joint.frame_id >= 0)
+    {
+        output += indent + "\tCHANNELS 3 Zrotation Yrotation Xrotation\n";
+    }
+
+    // Children
+    for (size_t i = joint_idx + 1; i < m_joints.size(); i++)
+    {
+        if (m_joints.at(i).parent == (int) joint_idx)
+        {
+            append_bvh_joint(i, depth + 1, output);
+        }
+    }
+
+    output += indent + "}\n";
+}
+
+/**
+ * @brief It appends a frame to the BVH motion: the root channels and the
+ * rotation of every finger joint (deg), in the order of the hierarchy.
+ * @param euler_arr The euler angles of the hand frames (AnimatedHand::HandAngles).
+ * @param output The output.
+ */
+void MotionExport::append_bvh_frame(const AnimatedHand::HandAngles& euler_arr,
+    std::string& output)
+{
+    output += "0 0 0 0 0 0";
+    for (const auto& joint : m_joints)
+    {
+        if (joint.frame_id < 0) { continue; }
+
+        Eigen::Vector3d euler = get_euler(euler_arr, joint);
+        for (int k = 2; k >= 0; k--)
+        {
+            output += " ";
+            append_number(Utils::rad2deg(euler(k)), output);
+        }
+    }
+    output += "\n";
+}
+
+/**
+ * @brief Returns the beginning of the GLB file: the file header, the json
+ * chunk, the header of the binary chunk and the inverse bind matrices of
+ * the skin, which are followed by the streams of the animation (see
+ * #get_glb_stream_offset). The values are stored as little-endian. The
+ * sizes of the GLB headers are 32-bit, so the file and its buffer must
+ * stay below 4 GiB.
+ * @param frames_num The number of frames.
+ * @return std::string The beginning of the file (empty if the frames do not
+ * fit in a GLB file).
+ */
+std::string MotionExport::get_glb_header(size_t frames_num)
+{
+    // Json chunk (padded with spaces)
+    nlohmann::json json_file = get_glb_json(frames_num);
+    size_t buffer_size = json_file["buffers"][0]["byteLength"];
+    std::string json_chunk = json_file.dump();
+    json_chunk.resize((json_chunk.size() + 3) / 4 * 4, ' ');
+
+    // Binary chunk size
+    size_t binary_size = get_glb_stream_offset(get_glb_streams_num(),
+        frames_num) - get_glb_stream_offset(0, frames_num) +
+        m_joints.size() * 16 * sizeof(float);
+
+    // Header sizes (32-bit)
+    m_glb_header_size = 12 + 8 + json_chunk.size() + 8;
+    if (m_glb_header_size + binary_size > UINT32_MAX ||
+        buffer_size > UINT32_MAX)
+    {
+        return std::string();
+    }
+    uint32_t header[3] = {0x46546C67, 2,
+        (uint32_t) (m_glb_header_size + binary_size)};
+    uint32_t json_header[2] = {(uint32_t) json_chunk.size(), 0x4E4F534A};
+    uint32_t binary_header[2] = {(uint32_t) binary_size, 0x004E4942};
+
+    std::string output;
+    output.append((const char*) header, sizeof(header));
+    output.append((const char*) json_header, sizeof(json_header));
+    output += json_chunk;
+    output.append((const char*) binary_header, sizeof(binary_header));
+
+    // Inverse bind matrices (column-major, the rest pose has no rotation)
+    std::vector<Eigen::Vector3d> positions(m_joints.size());
+    for (size_t i = 0; i < m_joints.size(); i++)
+    {
+        const Joint& joint = m_joints.at(i);
+        positions.at(i) = joint.offset;
+        if (joint.parent >= 0) { positions.at(i) += positions.at(joint.parent); }
+
+        Eigen::Matrix4f inverse_bind = Eigen::Matrix4f::Identity();
+        inverse_bind.block<3, 1>(0, 3) = -positions.at(i).cast<float>();
+        output.append((const char*) inverse_bind.data(), 16 * sizeof(float));
+    }
+
+    return output;
+}
+
+/**
+ * @brief Returns the json chunk of the GLB file: a node per joint, a skin
+ * with every joint and, if there are frames, an animation with a linear
+ * sampler per animated joint. The samplers share the time stream, and each
+ * of them has its own rotation stream (quaternions).
+ * @param frames_num The number of frames.
+ * @return nlohmann::json The json chunk.
+ */
+nlohmann::json MotionExport::get_glb_json(size_t frames_num)
+{
+    nlohmann::json json_file;
+    json_file["asset"] = {{"version", "2.0"},
+        {"generator", "trajectory_batch"}};
+    json_file["scene"] = 0;
+    json_file["scenes"] = {{{"nodes", {0}}}};
+
+    // Nodes
+    nlohmann::json nodes = nlohmann::json::array();
+    std::vector<int> joint_ids;
+    for (size_t i = 0; i < m_joints.size(); i++)
+    {
+        const Joint& joint = m_joints.at(i);
+        nlohmann::json node = {{"name", joint.name}, {"translation",
+            {joint.offset(0), joint.offset(1), joint.offset(2)}}};
+
+        std::vector<int> children;
+        for (size_t j = i + 1; j < m_joints.size(); j++)
+        {
+            if (m_joints.at(j).parent == (int) i) { children.push_back(j); }
+        }
+        if (!children.empty()) { node["children"] = children; }
+
+        nodes.push_back(node);
+        joint_ids.push_back(i);
+    }
+    json_file["nodes"] = nodes;
+    json_file["skins"] = {{{"name", "Hand"}, {"joints", joint_ids},
+        {"inverseBindMatrices", 0}, {"skeleton", 0}}};
+
+    // Buffer, buffer views and accessors
+    size_t binary_begin = get_glb_stream_offset(0, frames_num) -
+        m_joints.size() * 16 * sizeof(float);
+    json_file["buffers"] = {{{"byteLength", get_glb_stream_offset(
+        get_glb_streams_num(), frames_num) - binary_begin}}};
+
+    nlohmann::json buffer_views = {{{"buffer", 0}, {"byteOffset", 0},
+        {"byteLength", m_joints.size() * 16 * sizeof(float)}}};
+    nlohmann::json accessors = {{{"bufferView", 0}, {"componentType", 5126},
+        {"count", m_joints.size()}, {"type", "MAT4"}}};
+
+    if (frames_num > 0)
+    {
+        for (size_t i = 0; i < get_glb_streams_num(); i++)
+        {
+            buffer_views.push_back({{"buffer", 0}, {"byteOffset",
+                get_glb_stream_offset(i, frames_num) - binary_begin},
+                {"byteLength", frames_num * get_glb_element_size(i)}});
+
+            nlohmann::json accessor = {{"bufferView", i + 1},
+                {"componentType", 5126}, {"count", frames_num},
+                {"type", i == 0 ? "SCALAR" : "VEC4"}};
+
+            // Bounds of the time stream (required by the samplers)
+            if (i == 0)
+            {
+                accessor["min"] = {0.0};
+                accessor["max"] = {(double) (float) ((frames_num - 1) *
+                    m_frame_time)};
+            }
+            accessors.push_back(accessor);
+        }
+    }
+    json_file["bufferViews"] = buffer_views;
+    json_file["accessors"] = accessors;
+
+    // Animation
+    if (frames_num > 0)
+    {
+        nlohmann::json samplers = nlohmann::json::array();
+        nlohmann::json channels = nlohmann::json::array();
+        for (size_t i = 0; i < m_joints.size(); i++)
+        {
+            if (m_joints.at(i).frame_id < 0) { continue; }
+
+            channels.push_back({{"sampler", samplers.size()},
+                {"target", {{"node", i}, {"path", "rotation"}}}});
+            samplers.push_back({{"input", 1}, {"output", samplers.size() + 2},
+                {"interpolation", "LINEAR"}});
+        }
+        json_file["animations"] = {{{"name", "Session"},
+            {"samplers", samplers}, {"channels", channels}}};
+    }
+
+    return json_file;
+}
+
+/**
+ * @brief Returns the offset of a GLB stream in the file. The binary chunk
+ * holds the inverse bind matrices, the time stream and one rotation stream
+ * per animated joint. The header must have been generated (see
+ * #get_glb_header).
+ * @param stream_idx The stream idx (0: time, i: rotation of the i-th
+ * animated joint, #get_glb_streams_num: end of the file).
+ * @param frames_num The number of frames.
+ * @return size_t The offset (bytes).
+ */
+size_t MotionExport::get_glb_stream_offset(size_t stream_idx,
+    size_t frames_num)
+{
+    size_t offset = m_glb_header_size + m_joints.size() * 16 * sizeof(float);
+    for (size_t i = 0; i < stream_idx; i++)
+    {
+        offset += frames_num * get_glb_element_size(i);
+    }
+    return offset;
+}
+
+/**
+ * @brief It sets a frame of a block of the GLB streams. The block holds the
+ * part of each stream that belongs to its frames, one stream after the
+ * other.
+ * @param euler_arr The euler angles of the hand frames (AnimatedHand::HandAngles).
+ * @param frame_idx The idx of the frame in the file.
+ * @param block_frame_idx The idx of the frame in the block.
+ * @param block_frames_num The number of frames of the block.
+ * @param block_data The block.
+ */
+void MotionExport::set_glb_frame(const AnimatedHand::HandAngles& euler_arr,
+    size_t frame_idx, size_t block_frame_idx, size_t block_frames_num,
+    char* block_data)
+{
+    // Time
+    float time = (float) (frame_idx * m_frame_time);
+    std::memcpy(block_data + block_frame_idx * sizeof(float), &time,
+        sizeof(float));
+
+    // Rotations (x, y, z, w)
+    char* stream_data = block_data + block_frames_num * sizeof(float);
+    for (const auto& joint : m_joints)
+    {
+        if (joint.frame_id < 0) { continue; }
+
+        Eigen::Vector3d euler = get_euler(euler_arr, joint);
+        EulerRotations::Quaternions q = EulerRotations::euler_to_quaternions(
+            euler(0), euler(1), euler(2));
+        float rotation[4] = {(float) q.x, (float) q.y, (float) q.z,
+            (float) q.w};
+
+        std::memcpy(stream_data + block_frame_idx * sizeof(rotation),
+            rotation, sizeof(rotation));
+        stream_data += block_frames_num * sizeof(rotation);
+    }
+}
+
+/**
+ * @brief Returns the euler angles of a joint. The right hand is mirrored
+ * about the xz plane, which negates the roll and the yaw.
+ * @param euler_arr The euler angles of the hand frames (AnimatedHand::HandAngles).
+ * @param joint The joint.
+ * @return Eigen::Vector3d The euler angles (rad).
+ */
+Eigen::Vector3d MotionExport::get_euler(
+    const AnimatedHand::HandAngles& euler_arr, const Joint& joint)
+{
+    Eigen::Vector3d euler = euler_arr.at(joint.frame_id);
+    if (m_type)
+    {
+        euler(0) = -euler(0);
+        euler(2) = -euler(2);
+    }
+    return euler;
+}
+
+/**
+ * @brief It appends a number to a text output (shortest representation
+ * that reads back to the same value, no locale).
+ * @param value The number.
+ * @param output The output.
+ */
+void MotionExport::append_number(double value, std::string& output)
+{
+    char buffer[32];
+    char* buffer_end = std::to_chars(buffer, buffer + sizeof(buffer),
+        value).ptr;
+    output.append(buffer, buffer_end);
+}
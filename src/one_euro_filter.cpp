@@ -0,0 +1,69 @@
+#include "../include/one_euro_filter.h"
+
+/**
+ * @brief Initializes the parameters and the state of the channels.
+ * @param parameters The parameters of each channel.
+ */
+void OneEuroFilter::initialize(const std::vector<Parameters>& parameters)
+{
+    // Number of channels
+    size_t channels = parameters.size();
+
+    // Initialize parameters
+    m_min_cutoff.resize(channels);
+    m_beta.resize(channels);
+    m_d_cutoff.resize(channels);
+    m_enabled.resize(channels);
+
+    for (size_t i = 0; i < channels; i++)
+    {
+        // Disabled channels keep a valid cutoff (their output is discarded)
+        bool enabled = parameters.at(i).min_cutoff > 0.0;
+        m_min_cutoff(i) = enabled ? parameters.at(i).min_cutoff : 1.0;
+        m_beta(i) = parameters.at(i).beta;
+        m_d_cutoff(i) = parameters.at(i).d_cutoff > 0.0 ?
+            parameters.at(i).d_cutoff : 1.0;
+        m_enabled(i) = enabled ? 1.0 : 0.0;
+    }
+
+    // Initialize state
+    m_x_hat = Eigen::ArrayXd::Zero(channels);
+    m_dx_hat = Eigen::ArrayXd::Zero(channels);
+    m_alpha = Eigen::ArrayXd::Zero(channels);
+    m_is_initialized = false;
+}
+
+/**
+ * @brief Filters a sample of all the channels in place. The first sample
+ * (and any sample with a non-positive time step) initializes the state and
+ * is passed through.
+ * @param sample Pointer to the sample (one value per channel).
+ * @param dt The time since the previous sample (s).
+ */
+void OneEuroFilter::filter(double* sample, double dt)
+{
+    Eigen::Map<Eigen::ArrayXd> x(sample, m_min_cutoff.size());
+
+    // Initialize state
+    if (!m_is_initialized || dt <= 0.0)
+    {
+        if (!m_is_initialized) { m_dx_hat.setZero(); }
+        m_x_hat = x;
+        m_is_initialized = true;
+        return;
+    }
+
+    // Filtered derivative. The smoothing factor of a low-pass filter of
+    // cutoff fc is 1 / (1 + 1 / (2 pi fc dt))
+    m_alpha = 1.0 / (1.0 + 1.0 / ((2.0 * M_PI * dt) * m_d_cutoff));
+    m_dx_hat += m_alpha * ((x - m_x_hat) / dt - m_dx_hat);
+
+    // Adaptive cutoff and filtered value
+    m_alpha = 1.0 / (1.0 + 1.0 / ((2.0 * M_PI * dt) *
+        (m_min_cutoff + m_beta * m_dx_hat.abs())));
+    m_x_hat += m_alpha * (x - m_x_hat);
+
+    // Pass disabled channels through
+    x = m_enabled * m_x_hat + (1.0 - m_enabled) * x;
+    m_x_hat = x;
+}
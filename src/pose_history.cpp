@@ -0,0 +1,116 @@
+#include "../include/pose_history.h"
+
+/**
+ * @brief Initializes the history.
+ * @param capacity The maximum number of poses.
+ * @param max_extrapolation The maximum extrapolation time beyond the newest
+ * pose (s).
+ */
+void PoseHistory::initialize(size_t capacity, double max_extrapolation)
+{
+    m_poses.assign(std::max(capacity, (size_t) 2), Pose{});
+    m_head = 0;
+    m_size = 0;
+    m_max_extrapolation = max_extrapolation;
+}
+
+/**
+ * @brief Pushes a pose to the history. When the history is full the oldest
+ * pose is overwritten. Poses that are not newer than the newest pose are
+ * dropped.
+ * @param time The time of the pose (s).
+ * @param angles The euler angles of the hand frames.
+ */
+void PoseHistory::push(double time, const AnimatedHand::HandAngles& angles)
+{
+    // Drop out of order poses
+    if (m_size > 0 && time <= at(m_size - 1).time) { return; }
+
+    m_poses.at(m_head) = Pose{time, angles};
+    m_head = (m_head + 1) % m_poses.size();
+    m_size = std::min(m_size + 1, m_poses.size());
+}
+
+/**
+ * @brief Samples the history at a time. Times between two poses are
+ * interpolated, times before the oldest pose are clamped to it and times
+ * after the newest pose are extrapolated from the two newest poses (at most
+ * #m_max_extrapolation and one sample interval ahead).
+ * @param time The time to sample (s).
+ * @param angles The sampled euler angles of the hand frames.
+ * @return true The history has been sampled.
+ * @return false The history is empty.
+ */
+bool PoseHistory::sample(double time, AnimatedHand::HandAngles& angles)
+{
+    if (m_size == 0) { return false; }
+
+    // Single pose or time before the oldest pose
+    if (m_size == 1 || time <= at(0).time)
+    {
+        angles = at(0).angles;
+        return true;
+    }
+
+    // Find the first pose after the time (the newest pair by default)
+    size_t idx = m_size - 1;
+    for (size_t i = 1; i < m_size; i++)
+    {
+        if (at(i).time >= time) { idx = i; break; }
+    }
+
+    const Pose& pose_a = at(idx - 1);
+    const Pose& pose_b = at(idx);
+    double interval = pose_b.time - pose_a.time;
+
+    // Bound extrapolation beyond the newest pose
+    time = std::min(time, pose_b.time + std::min(m_max_extrapolation,
+        interval));
+
+    slerp(pose_a.angles, pose_b.angles, (time - pose_a.time) / interval,
+        angles);
+
+    return true;
+}
+
+/**
+ * @brief Interpolates (u in [0, 1]) or extrapolates (u > 1) the rotations of
+ * the hand frames of two poses with slerp. The euler angles (z-y'-x'', see
+ * EulerRotations::) are converted to quaternions and back, so the
+ * resulting angles describe the same rotations, although not necessarily with
+ * the same angles, as the input ones.
+ * @param angles_a The euler angles of the first pose.
+ * @param angles_b The euler angles of the second pose.
+ * @param u The interpolation parameter.
+ * @param angles The resulting euler angles.
+ */
+void PoseHistory::slerp(const AnimatedHand::HandAngles& angles_a,
+    const AnimatedHand::HandAngles& angles_b, double u,
+    AnimatedHand::HandAngles& angles)
+{
+    for (size_t i = 0; i < angles.size(); i++)
+    {
+        // Identical rotations (e.g. unused frames)
+        if (angles_a.at(i) == angles_b.at(i))
+        {
+            angles.at(i) = angles_a.at(i);
+            continue;
+        }
+
+        // Convert to quaternions
+        EulerRotations::Quaternions q_a = EulerRotations::euler_to_quaternions(
+            angles_a.at(i)(0), angles_a.at(i)(1), angles_a.at(i)(2));
+        EulerRotations::Quaternions q_b = EulerRotations::euler_to_quaternions(
+            angles_b.at(i)(0), angles_b.at(i)(1), angles_b.at(i)(2));
+
+        // Slerp
+        Eigen::Quaterniond q = Eigen::Quaterniond(q_a.w, q_a.x, q_a.y,
+            q_a.z).slerp(u, Eigen::Quaterniond(q_b.w, q_b.x, q_b.y, q_b.z));
+        q.normalize();
+
+        // Convert to euler angles
+        EulerRotations::Euler euler = EulerRotations::quaternions_to_euler(
+            q.w(), q.x(), q.y(), q.z());
+        angles.at(i) = Eigen::Vector3d(euler.phi, euler.theta, euler.psi);
+    }
+}
@@ -1,4 +1,5 @@
 #include "../include/serial_com.h"
+#include "../include/utils.h"
 
 /**
  * Write a string to the serial device.
@@ -17,11 +18,46 @@ void SerialCOM::writeString(std::string s)
     * \throws boost::system::system_error on failure.
     */
 std::string SerialCOM::readLine()
+{
+    double timestamp;
+    return readLine(timestamp);
+}
+
+/**
+ * Blocks until a line is received from the serial device.
+    * Eventual '\n' or '\r\n' characters at the end of the string are removed.
+    * \param timestamp arrival time of the line (s, see 
+    * Utils::monotonic_time), taken when its terminating '\n' is read.
+    * \return a string containing the received line.
+    * \throws boost::system::system_error on failure.
+    */
+std::string SerialCOM::readLine(double& timestamp)
+{
+    std::string result;
+    readLine(result, timestamp);
+    return result;
+}
+
+/**
+ * Blocks until a line is received from the serial device.
+    * Eventual '\n' or '\r\n' characters at the end of the string are removed.
+    * Characters beyond m_max_line_length (e.g. a stream without line 
+    * terminators) are dropped until the next '\n', so a garbled stream 
+    * cannot grow the buffer.
+    * \param line buffer of the received line (overwritten, its capacity is 
+    * reused).
+    * \param timestamp arrival time of the line (s, see 
+    * Utils::monotonic_time), taken when its terminating '\n' is read.
+    * \return false if the line was longer than m_max_line_length.
+    * \throws boost::system::system_error on failure.
+    */
+bool SerialCOM::readLine(std::string& line, double& timestamp)
 {
     //Reading data char by char, code is optimized for simplicity, not speed
     using namespace boost;
     char c;
-    std::string result;
+    bool is_complete = true;
+    line.clear();
     for(;;)
     {
         asio::read(serial,asio::buffer(&c,1));
@@ -30,13 +66,54 @@ std::string SerialCOM::readLine()
             case '\r':
                 break;
             case '\n':
-                return result;
+                timestamp = Utils::monotonic_time();
+                return is_complete;
             default:
-                result+=c;
+                if (line.size() < m_max_line_length) { line+=c; }
+                else { is_complete = false; }
         }
     }
 }
 
+/**
+ * @brief Waits until data can be read from the serial device (poll), so a 
+ * reading thread can check a termination flag while the device is silent 
+ * instead of blocking in #readLine.
+ * @param timeout_ms The timeout (ms).
+ * @return true Data can be read (or the device reports an error, which the 
+ * next read throws).
+ * @return false The timeout expired (or the wait was interrupted).
+ */
+bool SerialCOM::wait_readable(int timeout_ms)
+{
+    struct pollfd fd = {serial.native_handle(), POLLIN, 0};
+    return poll(&fd, 1, timeout_ms) > 0;
+}
+
+/**
+ * @brief Gets the overrun counters of the UART driver (TIOCGICOUNT), i.e. 
+ * the characters lost in the hardware FIFO and in the tty flip buffer since 
+ * the port was opened. USB CDC-ACM devices and pseudo terminals do not 
+ * support it.
+ * @param overrun The hardware overrun counter.
+ * @param buf_overrun The buffer overrun counter.
+ * @return true The counters are supported.
+ * @return false The driver does not provide the counters.
+ */
+bool SerialCOM::get_overrun_counters(int& overrun, int& buf_overrun)
+{
+    struct serial_icounter_struct icount;
+    if (ioctl(serial.native_handle(), TIOCGICOUNT, &icount) != 0)
+    {
+        return false;
+    }
+
+    overrun = icount.overrun;
+    buf_overrun = icount.buf_overrun;
+
+    return true;
+}
+
 /**
  * @brief Setup up stream by reading the values a couple times first.
  * 
@@ -0,0 +1,424 @@
+#include "../include/session_render.h"
+
+#include <cstdio>
+#include <cmath>
+#include <fstream>
+#include <filesystem>
+#include <GLFW/glfw3.h>
+
+/**
+ * @brief It sets the rendering parameters and loads the glove mapping (see
+ * AnimatedHand::initialize) and, unless the session holds joint angles, the
+ * calibration of the glove channels (see JointCalibration::load_parameters).
+ * @param parameters The rendering parameters.
+ */
+void SessionRender::initialize(const Parameters& parameters)
+{
+    // Set parameters
+    m_parameters = parameters;
+    if (m_parameters.encoders_num == 0)
+    {
+        m_parameters.encoders_num = std::max(1u,
+            std::thread::hardware_concurrency() - 1);
+    }
+    m_parameters.width = std::max(m_parameters.width, 1);
+    m_parameters.height = std::max(m_parameters.height, 1);
+    m_parameters.stride = std::max(m_parameters.stride, (size_t) 1);
+    m_parameters.compare = m_parameters.compare &&
+        m_parameters.reference_mode != m_parameters.render_mode;
+
+    // Initialize glove mapping
+    m_anim_hand.initialize();
+
+    // Initialize calibration (identity for joint angles)
+    std::vector<JointCalibration::Parameters> calibration_parameters(
+        m_anim_hand.get_channels_num());
+    if (m_parameters.calibrate)
+    {
+        JointCalibration::load_parameters(m_anim_hand.get_channel_signs(),
+            calibration_parameters);
+    }
+    m_calibration.initialize(calibration_parameters);
+
+    // Set camera center
+    m_camera_center << -0.1, -0.1, 0.0, 0.1, -0.1, 0.0, 0.0, 0.1, 0.0;
+}
+
+/**
+ * @brief It renders a session file, one PNG file per rendered sample
+ * (frame_000000.png, ...). The lines are read in order, the invalid ones
+ * are counted and skipped (see StreamHealth::parse_line), and every stride
+ * valid samples the hands are updated with the pose of the calibrated
+ * sample (without filtering, see JointCalibration::apply) and rendered. The
+ * frames are encoded while the next ones are rendered (see FrameEncoder::).
+ * @param input_filename The session file.
+ * @param output_folder The folder of the frames (created if needed).
+ * @return true The session has been rendered.
+ * @return false The input file, the output folder or the OpenGL context
+ * could not be opened, or a frame could not be written.
+ */
+bool SessionRender::process(const std::string& input_filename,
+    const std::string& output_folder)
+{
+    double start_time = Utils::monotonic_time();
+    m_statistics = Statistics();
+    m_statistics.encoders_num = m_parameters.encoders_num;
+
+    // Open input file
+    std::ifstream input(input_filename);
+    if (!input.is_open())
+    {
+        std::cerr << "[SessionRender] Cannot open " << input_filename <<
+            std::endl;
+        return false;
+    }
+
+    // Create output folder
+    std::error_code error;
+    std::filesystem::create_directories(output_folder, error);
+    if (error)
+    {
+        std::cerr << "[SessionRender] Cannot create " << output_folder <<
+            std::endl;
+        return false;
+    }
+
+    // Create window, hands and framebuffer
+    if (!setup_scene()) { return false; }
+
+    // Start encoders (one frame per encoder, plus the one being rendered
+    // and one queued per encoder)
+    m_encoder.initialize(m_parameters.encoders_num,
+        2 * m_parameters.encoders_num + 1, m_parameters.width,
+        m_parameters.height);
+
+    std::string line;
+    std::vector<double> values;
+    char filename[32];
+    while (std::getline(input, line))
+    {
+        // Strip carriage return
+        if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+        if (line.empty()) { continue; }
+
+        // Parse and classify line
+        bool is_complete = line.size() <= m_max_line_length;
+        if (!is_complete) { line.clear(); }
+
+        double tick, sequence;
+        StreamHealth::LineStatus status = StreamHealth::parse_line(line,
+            is_complete, m_anim_hand.get_channels_num(), values, tick,
+            sequence);
+
+        m_statistics.lines++;
+        switch (status)
+        {
+            case StreamHealth::LineStatus::Valid: m_statistics.samples++; break;
+            case StreamHealth::LineStatus::Malformed: m_statistics.malformed++; continue;
+            case StreamHealth::LineStatus::Short: m_statistics.short_lines++; continue;
+            case StreamHealth::LineStatus::Overlong: m_statistics.overlong++; continue;
+        }
+        if ((m_statistics.samples - 1) % m_parameters.stride != 0) { continue; }
+
+        // Calibrate and convert to rad
+        m_calibration.apply(values);
+        for (auto& value : values)
+        {
+            value = Utils::deg2rad(value);
+        }
+
+        // Map joint angles to the hand frames
+        m_anim_hand.get_hand_angles(values, m_euler_id);
+
+        // Render frame (the frame is acquired first, so the time spent
+        // waiting for the encoders is not counted as rendering)
+        FrameEncoder::Frame& frame = m_encoder.acquire();
+        double render_start_time = Utils::monotonic_time();
+        render_frame(frame);
+        m_statistics.render_time += Utils::monotonic_time() -
+            render_start_time;
+
+        // Encode frame
+        std::snprintf(filename, sizeof(filename), "frame_%06llu.png",
+            (unsigned long long) m_statistics.frames++);
+        frame.filename = (std::filesystem::path(output_folder) /
+            filename).string();
+        m_encoder.submit(frame);
+    }
+
+    // Wait for the encoders
+    m_encoder.finish();
+    m_statistics.encoder = m_encoder.get_statistics();
+
+    shutdown_scene();
+    m_statistics.time = Utils::monotonic_time() - start_time;
+
+    return m_statistics.encoder.failed == 0;
+}
+
+/**
+ * @brief It creates the OpenGL context with a hidden viewer window (an EGL
+ * context on the null platform of GLFW if it is headless), adds the hands
+ * to the viewer as KinematicAnimation:: does, and creates the framebuffer
+ * object that the frames are rendered into, since the default framebuffer
+ * of a hidden window may not be rendered at all.
+ * @return true The scene is ready.
+ * @return false The context or the framebuffer could not be created.
+ */
+bool SessionRender::setup_scene(void)
+{
+    // Create hidden window (the hints are kept, since the viewer does not
+    // initialize GLFW again)
+#ifdef GLFW_PLATFORM_NULL
+    if (m_parameters.headless)
+    {
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    }
+#else
+    if (m_parameters.headless)
+    {
+        std::cerr << "[SessionRender] Headless rendering needs GLFW 3.4" <<
+            std::endl;
+        return false;
+    }
+#endif
+    if (!glfwInit())
+    {
+        std::cerr << "[SessionRender] Cannot initialize GLFW" << std::endl;
+        return false;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    if (m_parameters.headless)
+    {
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+    }
+    if (m_viewer.launch_init() != EXIT_SUCCESS)
+    {
+        std::cerr << "[SessionRender] Cannot create the OpenGL context" <<
+            std::endl;
+        return false;
+    }
+    m_statistics.renderer = std::string((const char*) glGetString(
+        GL_RENDERER)) + ", OpenGL " + (const char*) glGetString(GL_VERSION);
+
+    // Set viewer data as main.cpp
+    m_viewer.data().show_overlay_depth = false;
+    m_viewer.data().line_width = 1;
+    m_viewer.data().show_lines = false;
+
+    // Load the instanced meshes (shared by both hands)
+    bool is_compared = m_parameters.compare;
+    if (m_parameters.render_mode == Hand::RenderMode::Instanced ||
+        (is_compared &&
+        m_parameters.reference_mode == Hand::RenderMode::Instanced))
+    {
+        m_joint_mesh.initialize((std::filesystem::current_path() /
+            Finger::get_joint_filename()).string());
+        m_bone_mesh.initialize((std::filesystem::current_path() /
+            Finger::get_bone_filename()).string());
+    }
+
+    // Initialize hands
+    m_left_hand.initialize(&m_viewer, 0, m_left_origin,
+        m_parameters.render_mode, &m_joint_mesh, &m_bone_mesh);
+    m_right_hand.initialize(&m_viewer, 1, m_right_origin,
+        m_parameters.render_mode, &m_joint_mesh, &m_bone_mesh);
+
+    // Initialize reference hands (their viewer data follow the ones of the
+    // hands, and the initial one is kept if the hands are instanced, since
+    // drawing it updates the view and projection of the instances)
+    m_reference_data_idx = m_viewer.data_list.size();
+    if (is_compared)
+    {
+        if (m_parameters.render_mode == Hand::RenderMode::Instanced)
+        {
+            m_viewer.append_mesh();
+        }
+        m_reference_left_hand.initialize(&m_viewer, 0, m_left_origin,
+            m_parameters.reference_mode, &m_joint_mesh, &m_bone_mesh);
+        m_reference_right_hand.initialize(&m_viewer, 1, m_right_origin,
+            m_parameters.reference_mode, &m_joint_mesh, &m_bone_mesh);
+
+        size_t pixels_num = (size_t) m_parameters.width * m_parameters.height;
+        m_reference_pixels.resize(4 * pixels_num);
+        m_depth.resize(pixels_num);
+        m_reference_depth.resize(pixels_num);
+    }
+
+    // Set camera
+    igl::opengl::ViewerCore& core = m_viewer.core();
+    core.viewport << 0, 0, m_parameters.width, m_parameters.height;
+    core.align_camera_center(m_camera_center);
+
+    // Create framebuffer
+    glGenFramebuffers(1, &m_framebuffer);
+    glGenRenderbuffers(2, m_renderbuffers);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_parameters.width,
+        m_parameters.height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+        GL_RENDERBUFFER, m_renderbuffers[0]);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24,
+        m_parameters.width, m_parameters.height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+        GL_RENDERBUFFER, m_renderbuffers[1]);
+
+    bool is_complete =
+        glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (!is_complete)
+    {
+        std::cerr << "[SessionRender] Cannot create the framebuffer" <<
+            std::endl;
+        shutdown_scene();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief It deletes the framebuffer object and closes the viewer window.
+ */
+void SessionRender::shutdown_scene(void)
+{
+    glDeleteRenderbuffers(2, m_renderbuffers);
+    glDeleteFramebuffers(1, &m_framebuffer);
+    m_framebuffer = 0;
+    m_renderbuffers[0] = m_renderbuffers[1] = 0;
+
+    m_viewer.launch_shut();
+}
+
+/**
+ * @brief It updates the hands with the current hand angles and draws them
+ * into a frame. With Parameters::compare, the reference hands are drawn into
+ * the reference frame as well and the frames are compared (see
+ * #compare_frame).
+ * @param frame The frame (RGBA, bottom row first).
+ */
+void SessionRender::render_frame(FrameEncoder::Frame& frame)
+{
+    // Update hands
+    m_joint_mesh.clear_instances();
+    m_bone_mesh.clear_instances();
+    update_hands(m_left_hand, m_right_hand, m_parameters.render_mode);
+    if (m_parameters.compare)
+    {
+        update_hands(m_reference_left_hand, m_reference_right_hand,
+            m_parameters.reference_mode);
+    }
+
+    // Draw hands
+    draw_hands(false, frame.pixels.data(), m_depth.data());
+    if (!m_parameters.compare) { return; }
+
+    // Draw reference hands and compare
+    draw_hands(true, m_reference_pixels.data(), m_reference_depth.data());
+    compare_frame(frame);
+}
+
+/**
+ * @brief It updates a pair of hands with the current hand angles (see
+ * Hand::update) and, in instanced mode, adds their instances at the finest
+ * level of detail.
+ * @param left_hand The left hand.
+ * @param right_hand The right hand.
+ * @param render_mode The render mode of the hands.
+ */
+void SessionRender::update_hands(Hand& left_hand, Hand& right_hand,
+    Hand::RenderMode render_mode)
+{
+    left_hand.update(m_euler_id, m_viewer);
+    right_hand.update(m_euler_id, m_viewer);
+    if (render_mode == Hand::RenderMode::Instanced)
+    {
+        left_hand.add_instances();
+        right_hand.add_instances();
+    }
+}
+
+/**
+ * @brief It draws the viewer data of the hands or of the reference hands
+ * and, in instanced mode, the instances into the framebuffer, and reads the
+ * pixels back (and the depth, to compare the frames).
+ * @param is_reference Whether the reference hands are drawn.
+ * @param pixels The pixels (RGBA, bottom row first).
+ * @param depth The depth of the pixels (read if the frames are compared).
+ */
+void SessionRender::draw_hands(bool is_reference, unsigned char* pixels,
+    float* depth)
+{
+    Hand::RenderMode render_mode = is_reference ?
+        m_parameters.reference_mode : m_parameters.render_mode;
+
+    // Draw scene
+    igl::opengl::ViewerCore& core = m_viewer.core();
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    core.clear_framebuffers();
+    for (size_t i = 0; i < m_viewer.data_list.size(); i++)
+    {
+        igl::opengl::ViewerData& data = m_viewer.data_list.at(i);
+        if ((data.is_visible & core.id) &&
+            (i >= m_reference_data_idx) == is_reference)
+        {
+            core.draw(data);
+        }
+    }
+    if (render_mode == Hand::RenderMode::Instanced)
+    {
+        m_joint_mesh.draw(core);
+        m_bone_mesh.draw(core);
+    }
+
+    // Read pixels
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, m_parameters.width, m_parameters.height, GL_RGBA,
+        GL_UNSIGNED_BYTE, pixels);
+    if (m_parameters.compare)
+    {
+        glReadPixels(0, 0, m_parameters.width, m_parameters.height,
+            GL_DEPTH_COMPONENT, GL_FLOAT, depth);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/**
+ * @brief It compares a frame with the reference one: a pixel is different
+ * if it is covered by the hands in one frame only (cleared depth) or if its
+ * depth differs by more than #m_depth_tolerance. The largest color
+ * difference is kept as well (see Statistics::).
+ * @param frame The frame.
+ */
+void SessionRender::compare_frame(const FrameEncoder::Frame& frame)
+{
+    uint64_t different_pixels = 0;
+    for (size_t k = 0; k < m_depth.size(); k++)
+    {
+        bool is_covered = m_depth.at(k) < 1.0f;
+        bool is_reference_covered = m_reference_depth.at(k) < 1.0f;
+        if (is_covered != is_reference_covered ||
+            std::abs(m_depth.at(k) - m_reference_depth.at(k)) >
+            m_depth_tolerance)
+        {
+            different_pixels++;
+        }
+
+        for (size_t c = 4 * k; c < 4 * k + 4; c++)
+        {
+            m_statistics.max_color_difference = std::max(
+                m_statistics.max_color_difference,
+                std::abs((int) frame.pixels.at(c) -
+                (int) m_reference_pixels.at(c)));
+        }
+    }
+
+    m_statistics.compared_frames++;
+    m_statistics.max_different_pixels = std::max(
+        m_statistics.max_different_pixels, different_pixels);
+}
@@ -0,0 +1,459 @@
+#include "../include/skinning_kernel.h"
+
+#ifdef SKINNING_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    /// Segment kernel signature.
+    template <typename T>
+    using SegmentKernel = void (*)(const T* x, const T* y, const T* z,
+        size_t n, const SkinningKernel::RigidTransform<T>& tf, T* out);
+
+    /**
+     * @brief Transforms a segment of vertices (portable implementation).
+     * It is also used for the remainder of the vectorized kernels.
+     */
+    template <typename T>
+    void skin_segment_scalar(const T* x, const T* y, const T* z, size_t n,
+        const SkinningKernel::RigidTransform<T>& tf, T* out)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            out[3 * i] = tf.rot[0] * x[i] + tf.rot[1] * y[i] +
+                tf.rot[2] * z[i] + tf.pos[0];
+            out[3 * i + 1] = tf.rot[3] * x[i] + tf.rot[4] * y[i] +
+                tf.rot[5] * z[i] + tf.pos[1];
+            out[3 * i + 2] = tf.rot[6] * x[i] + tf.rot[7] * y[i] +
+                tf.rot[8] * z[i] + tf.pos[2];
+        }
+    }
+
+#ifdef SKINNING_KERNEL_X86
+
+    /**
+     * @brief Permutation indices of the in-register interleaving. W
+     * vertices (one per lane of the x, y and z vectors) are interleaved
+     * into 3 vectors of W lanes, and lane p of output vector k holds
+     * component (W k + p) % 3 of vertex (W k + p) / 3.
+     */
+    template <typename I, int W>
+    struct InterleaveIndices
+    {
+        constexpr InterleaveIndices(void) : idx()
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                for (int p = 0; p < W; p++) { idx[k][p] = (W * k + p) / 3; }
+            }
+        }
+
+        // Vertex of each lane of the output vectors
+        alignas(64) I idx[3][W];
+    };
+
+    /**
+     * @brief Blend mask of component c in output vector k of the
+     * interleaving of W vertices (bit p set if lane p holds component c).
+     */
+    constexpr int interleave_mask(int w, int k, int c)
+    {
+        int mask = 0;
+        for (int p = 0; p < w; p++)
+        {
+            if ((w * k + p) % 3 == c) { mask |= 1 << p; }
+        }
+        return mask;
+    }
+
+    /**
+     * @brief Immediate of the lane permutation of output vector k of the
+     * interleaving of 4 vertices (2 bits per lane).
+     */
+    constexpr int interleave_permutation(int k)
+    {
+        int imm = 0;
+        for (int p = 0; p < 4; p++) { imm |= ((4 * k + p) / 3) << (2 * p); }
+        return imm;
+    }
+
+    constexpr InterleaveIndices<int32_t, 8> g_indices_8x32;
+    constexpr InterleaveIndices<int32_t, 16> g_indices_16x32;
+    constexpr InterleaveIndices<int64_t, 8> g_indices_8x64;
+
+    /**
+     * @brief Output vector k of the interleaving of 4 vertices (AVX2).
+     */
+    template <int K>
+    __attribute__((target("avx2,fma")))
+    inline __m256d interleave_avx2(__m256d x, __m256d y, __m256d z)
+    {
+        constexpr int perm = interleave_permutation(K);
+        constexpr int y_mask = interleave_mask(4, K, 1);
+        constexpr int z_mask = interleave_mask(4, K, 2);
+
+        const __m256d xy = _mm256_blend_pd(_mm256_permute4x64_pd(x, perm),
+            _mm256_permute4x64_pd(y, perm), y_mask);
+        return _mm256_blend_pd(xy, _mm256_permute4x64_pd(z, perm), z_mask);
+    }
+
+    /**
+     * @brief Output vector k of the interleaving of 8 vertices (AVX2).
+     */
+    template <int K>
+    __attribute__((target("avx2,fma")))
+    inline __m256 interleave_avx2(__m256 x, __m256 y, __m256 z)
+    {
+        constexpr int y_mask = interleave_mask(8, K, 1);
+        constexpr int z_mask = interleave_mask(8, K, 2);
+        const __m256i idx = _mm256_load_si256(
+            (const __m256i*) g_indices_8x32.idx[K]);
+
+        const __m256 xy = _mm256_blend_ps(_mm256_permutevar8x32_ps(x, idx),
+            _mm256_permutevar8x32_ps(y, idx), y_mask);
+        return _mm256_blend_ps(xy, _mm256_permutevar8x32_ps(z, idx), z_mask);
+    }
+
+    /**
+     * @brief Output vector k of the interleaving of 8 vertices (AVX-512).
+     */
+    template <int K>
+    __attribute__((target("avx512f")))
+    inline __m512d interleave_avx512(__m512d x, __m512d y, __m512d z)
+    {
+        constexpr int x_mask = interleave_mask(8, K, 0);
+        constexpr int y_mask = interleave_mask(8, K, 1);
+        constexpr int z_mask = interleave_mask(8, K, 2);
+        const __m512i idx = _mm512_load_si512(g_indices_8x64.idx[K]);
+
+        __m512d out = _mm512_maskz_permutexvar_pd(x_mask, idx, x);
+        out = _mm512_mask_permutexvar_pd(out, y_mask, idx, y);
+        return _mm512_mask_permutexvar_pd(out, z_mask, idx, z);
+    }
+
+    /**
+     * @brief Output vector k of the interleaving of 16 vertices (AVX-512).
+     */
+    template <int K>
+    __attribute__((target("avx512f")))
+    inline __m512 interleave_avx512(__m512 x, __m512 y, __m512 z)
+    {
+        constexpr int x_mask = interleave_mask(16, K, 0);
+        constexpr int y_mask = interleave_mask(16, K, 1);
+        constexpr int z_mask = interleave_mask(16, K, 2);
+        const __m512i idx = _mm512_load_si512(g_indices_16x32.idx[K]);
+
+        __m512 out = _mm512_maskz_permutexvar_ps(x_mask, idx, x);
+        out = _mm512_mask_permutexvar_ps(out, y_mask, idx, y);
+        return _mm512_mask_permutexvar_ps(out, z_mask, idx, z);
+    }
+
+    /**
+     * @brief Transforms a segment of vertices (AVX2, 4 doubles per lane).
+     */
+    __attribute__((target("avx2,fma")))
+    void skin_segment_avx2(const double* x, const double* y, const double* z,
+        size_t n, const SkinningKernel::RigidTransform<double>& tf,
+        double* out)
+    {
+        const __m256d r0 = _mm256_set1_pd(tf.rot[0]);
+        const __m256d r1 = _mm256_set1_pd(tf.rot[1]);
+        const __m256d r2 = _mm256_set1_pd(tf.rot[2]);
+        const __m256d r3 = _mm256_set1_pd(tf.rot[3]);
+        const __m256d r4 = _mm256_set1_pd(tf.rot[4]);
+        const __m256d r5 = _mm256_set1_pd(tf.rot[5]);
+        const __m256d r6 = _mm256_set1_pd(tf.rot[6]);
+        const __m256d r7 = _mm256_set1_pd(tf.rot[7]);
+        const __m256d r8 = _mm256_set1_pd(tf.rot[8]);
+        const __m256d p0 = _mm256_set1_pd(tf.pos[0]);
+        const __m256d p1 = _mm256_set1_pd(tf.pos[1]);
+        const __m256d p2 = _mm256_set1_pd(tf.pos[2]);
+
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            const __m256d vx = _mm256_loadu_pd(x + i);
+            const __m256d vy = _mm256_loadu_pd(y + i);
+            const __m256d vz = _mm256_loadu_pd(z + i);
+
+            const __m256d ox = _mm256_fmadd_pd(r0, vx,
+                _mm256_fmadd_pd(r1, vy, _mm256_fmadd_pd(r2, vz, p0)));
+            const __m256d oy = _mm256_fmadd_pd(r3, vx,
+                _mm256_fmadd_pd(r4, vy, _mm256_fmadd_pd(r5, vz, p1)));
+            const __m256d oz = _mm256_fmadd_pd(r6, vx,
+                _mm256_fmadd_pd(r7, vy, _mm256_fmadd_pd(r8, vz, p2)));
+
+            // Interleave and store the 4 vertices
+            _mm256_storeu_pd(out + 3 * i,
+                interleave_avx2<0>(ox, oy, oz));
+            _mm256_storeu_pd(out + 3 * i + 4,
+                interleave_avx2<1>(ox, oy, oz));
+            _mm256_storeu_pd(out + 3 * i + 8,
+                interleave_avx2<2>(ox, oy, oz));
+        }
+
+        skin_segment_scalar(x + i, y + i, z + i, n - i, tf, out + 3 * i);
+    }
+
+    /**
+     * @brief Transforms a segment of vertices (AVX2, 8 floats per lane).
+     */
+    __attribute__((target("avx2,fma")))
+    void skin_segment_avx2(const float* x, const float* y, const float* z,
+        size_t n, const SkinningKernel::RigidTransform<float>& tf,
+        float* out)
+    {
+        const __m256 r0 = _mm256_set1_ps(tf.rot[0]);
+        const __m256 r1 = _mm256_set1_ps(tf.rot[1]);
+        const __m256 r2 = _mm256_set1_ps(tf.rot[2]);
+        const __m256 r3 = _mm256_set1_ps(tf.rot[3]);
+        const __m256 r4 = _mm256_set1_ps(tf.rot[4]);
+        const __m256 r5 = _mm256_set1_ps(tf.rot[5]);
+        const __m256 r6 = _mm256_set1_ps(tf.rot[6]);
+        const __m256 r7 = _mm256_set1_ps(tf.rot[7]);
+        const __m256 r8 = _mm256_set1_ps(tf.rot[8]);
+        const __m256 p0 = _mm256_set1_ps(tf.pos[0]);
+        const __m256 p1 = _mm256_set1_ps(tf.pos[1]);
+        const __m256 p2 = _mm256_set1_ps(tf.pos[2]);
+
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            const __m256 vx = _mm256_loadu_ps(x + i);
+            const __m256 vy = _mm256_loadu_ps(y + i);
+            const __m256 vz = _mm256_loadu_ps(z + i);
+
+            const __m256 ox = _mm256_fmadd_ps(r0, vx,
+                _mm256_fmadd_ps(r1, vy, _mm256_fmadd_ps(r2, vz, p0)));
+            const __m256 oy = _mm256_fmadd_ps(r3, vx,
+                _mm256_fmadd_ps(r4, vy, _mm256_fmadd_ps(r5, vz, p1)));
+            const __m256 oz = _mm256_fmadd_ps(r6, vx,
+                _mm256_fmadd_ps(r7, vy, _mm256_fmadd_ps(r8, vz, p2)));
+
+            // Interleave and store the 8 vertices
+            _mm256_storeu_ps(out + 3 * i,
+                interleave_avx2<0>(ox, oy, oz));
+            _mm256_storeu_ps(out + 3 * i + 8,
+                interleave_avx2<1>(ox, oy, oz));
+            _mm256_storeu_ps(out + 3 * i + 16,
+                interleave_avx2<2>(ox, oy, oz));
+        }
+
+        skin_segment_scalar(x + i, y + i, z + i, n - i, tf, out + 3 * i);
+    }
+
+    /**
+     * @brief Transforms a segment of vertices (AVX-512, 8 doubles per lane).
+     */
+    __attribute__((target("avx512f")))
+    void skin_segment_avx512(const double* x, const double* y,
+        const double* z, size_t n,
+        const SkinningKernel::RigidTransform<double>& tf,
+        double* out)
+    {
+        const __m512d r0 = _mm512_set1_pd(tf.rot[0]);
+        const __m512d r1 = _mm512_set1_pd(tf.rot[1]);
+        const __m512d r2 = _mm512_set1_pd(tf.rot[2]);
+        const __m512d r3 = _mm512_set1_pd(tf.rot[3]);
+        const __m512d r4 = _mm512_set1_pd(tf.rot[4]);
+        const __m512d r5 = _mm512_set1_pd(tf.rot[5]);
+        const __m512d r6 = _mm512_set1_pd(tf.rot[6]);
+        const __m512d r7 = _mm512_set1_pd(tf.rot[7]);
+        const __m512d r8 = _mm512_set1_pd(tf.rot[8]);
+        const __m512d p0 = _mm512_set1_pd(tf.pos[0]);
+        const __m512d p1 = _mm512_set1_pd(tf.pos[1]);
+        const __m512d p2 = _mm512_set1_pd(tf.pos[2]);
+
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            const __m512d vx = _mm512_loadu_pd(x + i);
+            const __m512d vy = _mm512_loadu_pd(y + i);
+            const __m512d vz = _mm512_loadu_pd(z + i);
+
+            const __m512d ox = _mm512_fmadd_pd(r0, vx,
+                _mm512_fmadd_pd(r1, vy, _mm512_fmadd_pd(r2, vz, p0)));
+            const __m512d oy = _mm512_fmadd_pd(r3, vx,
+                _mm512_fmadd_pd(r4, vy, _mm512_fmadd_pd(r5, vz, p1)));
+            const __m512d oz = _mm512_fmadd_pd(r6, vx,
+                _mm512_fmadd_pd(r7, vy, _mm512_fmadd_pd(r8, vz, p2)));
+
+            // Interleave and store the 8 vertices
+            _mm512_storeu_pd(out + 3 * i,
+                interleave_avx512<0>(ox, oy, oz));
+            _mm512_storeu_pd(out + 3 * i + 8,
+                interleave_avx512<1>(ox, oy, oz));
+            _mm512_storeu_pd(out + 3 * i + 16,
+                interleave_avx512<2>(ox, oy, oz));
+        }
+
+        skin_segment_scalar(x + i, y + i, z + i, n - i, tf, out + 3 * i);
+    }
+
+    /**
+     * @brief Transforms a segment of vertices (AVX-512, 16 floats per lane).
+     */
+    __attribute__((target("avx512f")))
+    void skin_segment_avx512(const float* x, const float* y, const float* z,
+        size_t n, const SkinningKernel::RigidTransform<float>& tf,
+        float* out)
+    {
+        const __m512 r0 = _mm512_set1_ps(tf.rot[0]);
+        const __m512 r1 = _mm512_set1_ps(tf.rot[1]);
+        const __m512 r2 = _mm512_set1_ps(tf.rot[2]);
+        const __m512 r3 = _mm512_set1_ps(tf.rot[3]);
+        const __m512 r4 = _mm512_set1_ps(tf.rot[4]);
+        const __m512 r5 = _mm512_set1_ps(tf.rot[5]);
+        const __m512 r6 = _mm512_set1_ps(tf.rot[6]);
+        const __m512 r7 = _mm512_set1_ps(tf.rot[7]);
+        const __m512 r8 = _mm512_set1_ps(tf.rot[8]);
+        const __m512 p0 = _mm512_set1_ps(tf.pos[0]);
+        const __m512 p1 = _mm512_set1_ps(tf.pos[1]);
+        const __m512 p2 = _mm512_set1_ps(tf.pos[2]);
+
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            const __m512 vx = _mm512_loadu_ps(x + i);
+            const __m512 vy = _mm512_loadu_ps(y + i);
+            const __m512 vz = _mm512_loadu_ps(z + i);
+
+            const __m512 ox = _mm512_fmadd_ps(r0, vx,
+                _mm512_fmadd_ps(r1, vy, _mm512_fmadd_ps(r2, vz, p0)));
+            const __m512 oy = _mm512_fmadd_ps(r3, vx,
+                _mm512_fmadd_ps(r4, vy, _mm512_fmadd_ps(r5, vz, p1)));
+            const __m512 oz = _mm512_fmadd_ps(r6, vx,
+                _mm512_fmadd_ps(r7, vy, _mm512_fmadd_ps(r8, vz, p2)));
+
+            // Interleave and store the 16 vertices
+            _mm512_storeu_ps(out + 3 * i,
+                interleave_avx512<0>(ox, oy, oz));
+            _mm512_storeu_ps(out + 3 * i + 16,
+                interleave_avx512<1>(ox, oy, oz));
+            _mm512_storeu_ps(out + 3 * i + 32,
+                interleave_avx512<2>(ox, oy, oz));
+        }
+
+        skin_segment_scalar(x + i, y + i, z + i, n - i, tf, out + 3 * i);
+    }
+
+#endif
+
+    /**
+     * @brief Select the segment kernel of the given instruction set.
+     */
+    template <typename T>
+    SegmentKernel<T> select_kernel(SkinningKernel::ISA isa)
+    {
+#ifdef SKINNING_KERNEL_X86
+        switch (isa)
+        {
+            case SkinningKernel::ISA::AVX512:
+                return static_cast<SegmentKernel<T>>(skin_segment_avx512);
+            case SkinningKernel::ISA::AVX2:
+                return static_cast<SegmentKernel<T>>(skin_segment_avx2);
+            default:
+                break;
+        }
+#endif
+        return skin_segment_scalar<T>;
+    }
+
+    /**
+     * @brief Loops through the segments of the rest-pose streams and
+     * transforms each one with the transform of its link.
+     */
+    template <typename T>
+    void skin_segments(const T* rest, size_t rest_size,
+        const std::vector<SkinningKernel::Segment<T>>& segments,
+        const std::vector<SkinningKernel::RigidTransform<T>>& transforms,
+        SegmentKernel<T> kernel)
+    {
+        // Rest-pose streams
+        const T* x = rest;
+        const T* y = rest + rest_size;
+        const T* z = rest + 2 * rest_size;
+
+        for (const auto& segment : segments)
+        {
+            kernel(x + segment.offset, y + segment.offset, z + segment.offset,
+                segment.size, transforms[segment.link], segment.out);
+        }
+    }
+}
+
+/// Instruction set that is used (detected once at startup).
+SkinningKernel::ISA SkinningKernel::m_isa = SkinningKernel::detect_isa();
+
+/**
+ * @brief Detects the best instruction set supported by the CPU.
+ * @return SkinningKernel::ISA The instruction set.
+ */
+SkinningKernel::ISA SkinningKernel::detect_isa(void)
+{
+#ifdef SKINNING_KERNEL_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f")) { return ISA::AVX512; }
+
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        return ISA::AVX2;
+    }
+#endif
+    return ISA::Scalar;
+}
+
+/**
+ * @brief Sets the instruction set of the kernel. If the CPU does not
+ * support it, the best supported one is used instead.
+ * @param isa The instruction set.
+ */
+void SkinningKernel::set_isa(ISA isa)
+{
+    m_isa = std::min(isa, detect_isa());
+}
+
+/**
+ * @brief Returns the name of an instruction set.
+ * @param isa The instruction set.
+ * @return std::string The name.
+ */
+std::string SkinningKernel::get_isa_name(ISA isa)
+{
+    switch (isa)
+    {
+        case ISA::AVX512: return "AVX-512";
+        case ISA::AVX2: return "AVX2";
+        default: return "Scalar";
+    }
+}
+
+/**
+ * @brief Skins the rest-pose streams of the hand in a single pass.
+ * @param rest The rest-pose streams (Nx3 column-major: x, y, z).
+ * @param rest_size The number of vertices N of the rest-pose streams.
+ * @param segments The segments of the streams (one per mesh).
+ * @param transforms The link transforms.
+ */
+void SkinningKernel::skin(const double* rest, size_t rest_size,
+    const std::vector<Segment<double>>& segments,
+    const std::vector<RigidTransform<double>>& transforms)
+{
+    skin_segments(rest, rest_size, segments, transforms,
+        select_kernel<double>(m_isa));
+}
+
+/**
+ * \overload void SkinningKernel::skin(const float* rest, size_t rest_size,
+ *  const std::vector<Segment<float>>& segments,
+ *  const std::vector<RigidTransform<float>>& transforms)
+ */
+void SkinningKernel::skin(const float* rest, size_t rest_size,
+    const std::vector<Segment<float>>& segments,
+    const std::vector<RigidTransform<float>>& transforms)
+{
+    skin_segments(rest, rest_size, segments, transforms,
+        select_kernel<float>(m_isa));
+}
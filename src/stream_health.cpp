@@ -0,0 +1,196 @@
+#include "../include/stream_health.h"
+
+/**
+ * @brief It parses a received line into its values without throwing and
+ * classifies it. A valid line carries the channels of the glove, optionally
+ * followed by the device tick and the sequence counter, which are removed
+ * from the values. It is shared by the acquisition thread (see
+ * Exoskeleton::) and the offline tools (see TrajectoryBatch::).
+ * @param line The received line (without its line ending).
+ * @param is_complete Whether the line fitted in the line buffer (see
+ * SerialCOM::readLine).
+ * @param channels_num The number of glove channels.
+ * @param values The values of the channels.
+ * @param tick The device tick (NaN if the line carries none).
+ * @param sequence The sequence counter (NaN if the line carries none).
+ * @return LineStatus The status of the line.
+ */
+StreamHealth::LineStatus StreamHealth::parse_line(const std::string& line,
+    bool is_complete, size_t channels_num, std::vector<double>& values,
+    double& tick, double& sequence)
+{
+    tick = NAN;
+    sequence = NAN;
+
+    // Lines that did not fit in the buffer
+    if (!is_complete) { return LineStatus::Overlong; }
+
+    // Non-numeric or empty values
+    if (!Utils::parse_double_vec(line, values))
+    {
+        return LineStatus::Malformed;
+    }
+
+    // Number of values
+    size_t values_num = values.size();
+    if (values_num < channels_num)
+    {
+        return LineStatus::Short;
+    }
+    if (values_num > channels_num + 2)
+    {
+        return LineStatus::Overlong;
+    }
+
+    // Device tick and sequence counter
+    if (values_num == channels_num + 2)
+    {
+        // Sequence counters are non-negative integers
+        if (values.back() < 0.0)
+        {
+            return LineStatus::Malformed;
+        }
+        sequence = values.back();
+        values.pop_back();
+    }
+    if (values_num > channels_num)
+    {
+        tick = values.back();
+        values.pop_back();
+    }
+
+    return LineStatus::Valid;
+}
+
+/**
+ * @brief Resets the counters. It must not run concurrently with the
+ * acquisition thread.
+ * @param time The current time (s, see Utils::monotonic_time).
+ * @param rate_window The window of the effective sample rate (s).
+ * @param sequence_bits The width of the sequence counter of the firmware
+ * (bits, see AnimatedHand::get_sequence_bits).
+ */
+void StreamHealth::initialize(double time, double rate_window,
+    unsigned int sequence_bits)
+{
+    for (auto counter : {&m_lines, &m_samples, &m_malformed, &m_short_lines,
+        &m_overlong, &m_sequence_gaps, &m_lost, &m_duplicates, &m_dropped,
+        &m_overruns, &m_buffer_overruns})
+    {
+        counter->store(0, std::memory_order_relaxed);
+    }
+    m_has_sequence.store(false, std::memory_order_relaxed);
+    m_has_overrun_counters.store(false, std::memory_order_relaxed);
+
+    m_prev_sequence = 0;
+    m_sequence_mask = (sequence_bits == 0 || sequence_bits >= 64) ?
+        UINT64_MAX : (((uint64_t) 1 << sequence_bits) - 1);
+    m_rate_window = rate_window;
+    m_rate_time = time;
+    m_rate_samples = 0;
+    m_sample_rate = 0.0;
+}
+
+/**
+ * @brief Counts a received line.
+ * @param status The status of the line.
+ */
+void StreamHealth::add_line(LineStatus status)
+{
+    increment(m_lines);
+
+    switch (status)
+    {
+        case LineStatus::Valid: increment(m_samples); break;
+        case LineStatus::Malformed: increment(m_malformed); break;
+        case LineStatus::Short: increment(m_short_lines); break;
+        case LineStatus::Overlong: increment(m_overlong); break;
+    }
+}
+
+/**
+ * @brief Checks the sequence counter of a valid line against the previous
+ * one. The counter wraps around at the width given at initialization, so
+ * the lines between them are the difference modulo that width. A line with
+ * the same counter as the previous one is a duplicate.
+ * @param sequence The sequence counter of the line.
+ */
+void StreamHealth::add_sequence(uint64_t sequence)
+{
+    sequence &= m_sequence_mask;
+
+    // First sequence counter
+    if (!m_has_sequence.load(std::memory_order_relaxed))
+    {
+        m_prev_sequence = sequence;
+        m_has_sequence.store(true, std::memory_order_relaxed);
+        return;
+    }
+
+    // Lines between the previous and the current one
+    uint64_t step = (sequence - m_prev_sequence) & m_sequence_mask;
+    if (step == 0)
+    {
+        increment(m_duplicates);
+        return;
+    }
+    m_prev_sequence = sequence;
+
+    // Gap
+    if (step > 1)
+    {
+        increment(m_sequence_gaps);
+        increment(m_lost, step - 1);
+    }
+}
+
+/**
+ * @brief Sets the UART overrun counters.
+ * @param overruns The hardware overruns since initialization.
+ * @param buffer_overruns The buffer overruns since initialization.
+ */
+void StreamHealth::set_overrun_counters(uint64_t overruns,
+    uint64_t buffer_overruns)
+{
+    m_overruns.store(overruns, std::memory_order_relaxed);
+    m_buffer_overruns.store(buffer_overruns, std::memory_order_relaxed);
+    m_has_overrun_counters.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Gets a snapshot of the counters. The effective sample rate is the
+ * number of valid samples of the last complete window divided by its
+ * duration, and it is updated by this call, so it must be called from a
+ * single (UI) thread.
+ * @param time The current time (s, see Utils::monotonic_time).
+ * @return Statistics The snapshot of the counters.
+ */
+StreamHealth::Statistics StreamHealth::get_statistics(double time)
+{
+    Statistics stats;
+    stats.lines = m_lines.load(std::memory_order_relaxed);
+    stats.samples = m_samples.load(std::memory_order_relaxed);
+    stats.malformed = m_malformed.load(std::memory_order_relaxed);
+    stats.short_lines = m_short_lines.load(std::memory_order_relaxed);
+    stats.overlong = m_overlong.load(std::memory_order_relaxed);
+    stats.has_sequence = m_has_sequence.load(std::memory_order_relaxed);
+    stats.sequence_gaps = m_sequence_gaps.load(std::memory_order_relaxed);
+    stats.lost = m_lost.load(std::memory_order_relaxed);
+    stats.duplicates = m_duplicates.load(std::memory_order_relaxed);
+    stats.dropped = m_dropped.load(std::memory_order_relaxed);
+    stats.has_overrun_counters =
+        m_has_overrun_counters.load(std::memory_order_relaxed);
+    stats.overruns = m_overruns.load(std::memory_order_relaxed);
+    stats.buffer_overruns = m_buffer_overruns.load(std::memory_order_relaxed);
+
+    // Sample rate of the last complete window
+    if (time - m_rate_time >= m_rate_window)
+    {
+        m_sample_rate = (stats.samples - m_rate_samples) / (time - m_rate_time);
+        m_rate_time = time;
+        m_rate_samples = stats.samples;
+    }
+    stats.sample_rate = m_sample_rate;
+
+    return stats;
+}
@@ -0,0 +1,156 @@
+#include "../include/thread_scheduler.h"
+
+/**
+ * @brief Loads the scheduling options from the thread configuration file
+ * (#m_config_rel_path). If the file does not exist, every thread keeps the
+ * default scheduling and the memory is not locked. Threads without CPUs are
+ * given every CPU of the process at initialization, so they do not inherit
+ * the affinity of a pinned parent thread.
+ * @param config_rel_path Relative path of the thread configuration file.
+ */
+void ThreadScheduler::initialize(const std::string& config_rel_path)
+{
+    // Define absolute path of thread configuration file
+    auto config_abs_path = std::filesystem::current_path() / config_rel_path;
+
+    // Parse json file
+    if (std::filesystem::exists(config_abs_path))
+    {
+        std::ifstream file(config_abs_path);
+        nlohmann::json json_file = nlohmann::json::parse(file);
+
+        m_lock_memory = json_file.value("LockMemory", false);
+        if (json_file.contains("Acquisition"))
+        {
+            m_acquisition_parameters =
+                parse_parameters(json_file.at("Acquisition"));
+        }
+        if (json_file.contains("Compute"))
+        {
+            m_compute_parameters = parse_parameters(json_file.at("Compute"));
+        }
+    }
+
+    // CPUs of the process
+    std::vector<int> process_cpus;
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if (CPU_ISSET(cpu, &cpu_set)) { process_cpus.push_back(cpu); }
+        }
+    }
+
+    // Threads without CPUs run on every CPU of the process
+    for (auto parameters : {&m_acquisition_parameters, &m_compute_parameters})
+    {
+        if (parameters->cpus.empty()) { parameters->cpus = process_cpus; }
+    }
+}
+
+/**
+ * @brief Locks the current (and, if the locked memory is not limited, the
+ * future) pages of the process in memory, so page faults do not stall the
+ * real-time threads. Future pages are not locked under a finite
+ * RLIMIT_MEMLOCK, because allocations beyond the limit would then fail.
+ * @return true The memory is locked.
+ * @return false Locking is disabled or not permitted.
+ */
+bool ThreadScheduler::lock_memory(void)
+{
+    if (!m_lock_memory) { return false; }
+
+    // Lock future pages only without limit (or with privileges)
+    int flags = MCL_CURRENT;
+    struct rlimit limit;
+    if (geteuid() == 0 || (getrlimit(RLIMIT_MEMLOCK, &limit) == 0 &&
+        limit.rlim_cur == RLIM_INFINITY))
+    {
+        flags |= MCL_FUTURE;
+    }
+
+    m_memory_locked = (mlockall(flags) == 0);
+
+    return m_memory_locked;
+}
+
+/**
+ * @brief Applies scheduling parameters to the calling thread. If SCHED_FIFO
+ * is not permitted at the requested priority, it is retried at the highest
+ * priority allowed by RLIMIT_RTPRIO, and otherwise the thread falls back to
+ * the default scheduling (it may have inherited SCHED_FIFO from its parent).
+ * CPUs that do not exist are ignored, and if none is left the affinity is
+ * kept.
+ * @param parameters The scheduling parameters.
+ * @return Status The resulting scheduling status.
+ */
+ThreadScheduler::Status ThreadScheduler::apply(const Parameters& parameters)
+{
+    Status status;
+
+    // Real-time priority
+    if (parameters.priority > 0)
+    {
+        struct sched_param param;
+        param.sched_priority = std::clamp(parameters.priority,
+            sched_get_priority_min(SCHED_FIFO),
+            sched_get_priority_max(SCHED_FIFO));
+        int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+        // Retry at the highest unprivileged priority
+        struct rlimit limit;
+        if (result == EPERM && getrlimit(RLIMIT_RTPRIO, &limit) == 0 &&
+            limit.rlim_cur > 0 && (int) limit.rlim_cur < param.sched_priority)
+        {
+            param.sched_priority = limit.rlim_cur;
+            result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        }
+
+        if (result == 0)
+        {
+            status.is_realtime = true;
+            status.priority = param.sched_priority;
+        }
+    }
+
+    // Default scheduling
+    if (!status.is_realtime)
+    {
+        struct sched_param param;
+        param.sched_priority = 0;
+        pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+    }
+
+    // CPU affinity
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int cpu : parameters.cpus)
+    {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) { CPU_SET(cpu, &cpu_set); }
+    }
+    if (CPU_COUNT(&cpu_set) > 0)
+    {
+        status.is_pinned = (pthread_setaffinity_np(pthread_self(),
+            sizeof(cpu_set), &cpu_set) == 0);
+    }
+
+    return status;
+}
+
+/**
+ * @brief Parses the scheduling parameters of a thread ("Priority" and
+ * "CPUs" entries, both optional).
+ * @param json_thread The json object of the thread.
+ * @return Parameters The scheduling parameters.
+ */
+ThreadScheduler::Parameters ThreadScheduler::parse_parameters(const
+    nlohmann::json& json_thread)
+{
+    Parameters parameters;
+    parameters.priority = json_thread.value("Priority", 0);
+    parameters.cpus = json_thread.value("CPUs", std::vector<int>());
+
+    return parameters;
+}
@@ -0,0 +1,599 @@
+#include "../include/trajectory_batch.h"
+
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/**
+ * @brief It loads the glove mapping (see AnimatedHand::initialize), the
+ * calibration of the glove channels unless the session holds joint angles
+ * (see JointCalibration::load_parameters) and the kinematic model of the
+ * hand without meshes (see HandKinematics::initialize), and builds the
+ * skeleton of the animation formats (see MotionExport::initialize).
+ * The hand is placed at the origin, so the trajectories are given with
+ * respect to its base frame \f$ f_{{W}_{0}} \f$.
+ * @param parameters The processing parameters.
+ */
+void TrajectoryBatch::initialize(const Parameters& parameters)
+{
+    // Set parameters
+    m_parameters = parameters;
+    if (m_parameters.threads_num == 0)
+    {
+        m_parameters.threads_num = std::max(1u,
+            std::thread::hardware_concurrency());
+    }
+    m_parameters.block_size = std::max(m_parameters.block_size, (size_t) 1);
+
+    // Initialize glove mapping
+    m_anim_hand.initialize();
+
+    // Initialize calibration (identity for joint angles)
+    std::vector<JointCalibration::Parameters> calibration_parameters(
+        m_anim_hand.get_channels_num());
+    if (m_parameters.calibrate)
+    {
+        JointCalibration::load_parameters(m_anim_hand.get_channel_signs(),
+            calibration_parameters);
+    }
+    m_calibration.initialize(calibration_parameters);
+
+    // Initialize hand model (kinematics only)
+    m_hand.initialize(m_parameters.type, Eigen::Vector3d::Zero(), false);
+
+    // Initialize skeleton
+    m_motion_export.initialize(m_hand, m_parameters.type,
+        m_parameters.frame_time);
+
+    // Number of columns
+    m_columns_num = get_column_names().size();
+}
+
+/**
+ * @brief Returns the names of the output columns: the device tick and the
+ * sequence counter of the sample (NaN if the line carries none), followed by
+ * the position of every joint (origin of every link frame) and of the
+ * fingertip of each finger, e.g. Thumb_joint0_x, ..., Thumb_tip_z.
+ * @return std::vector<std::string> The names of the columns.
+ */
+std::vector<std::string> TrajectoryBatch::get_column_names(void)
+{
+    std::vector<std::string> column_names = {"tick", "sequence"};
+
+    const std::vector<std::string>& finger_names = m_hand.get_finger_names();
+    std::vector<Finger>& fingers = m_hand.get_fingers();
+
+    for (size_t i = 0; i < fingers.size(); i++)
+    {
+        // Points of the finger
+        std::vector<std::string> point_names;
+        for (size_t j = 0; j < fingers.at(i).get_state().size(); j++)
+        {
+            point_names.push_back("joint" + std::to_string(j));
+        }
+        point_names.push_back("tip");
+
+        for (const auto& point_name : point_names)
+        {
+            for (const char* axis : {"x", "y", "z"})
+            {
+                column_names.push_back(finger_names.at(i) + "_" + point_name +
+                    "_" + axis);
+            }
+        }
+    }
+    return column_names;
+}
+
+/**
+ * @brief It processes a session file and writes the result to the output
+ * file. The workers take the blocks of the input file in order, and each of
+ * them waits for a free output slot, so at most twice as many blocks as
+ * workers are held in memory. The calling thread writes the blocks in file
+ * order as they are completed. Invalid lines are counted and skipped (see
+ * StreamHealth::parse_line).
+ * @param input_filename The session file.
+ * @param output_filename The output file.
+ * @return true The session has been processed.
+ * @return false The input or output file could not be opened or written, or
+ * the animation does not fit in the format (see MotionExport::get_glb_header).
+ */
+bool TrajectoryBatch::process(const std::string& input_filename,
+    const std::string& output_filename)
+{
+    double start_time = Utils::monotonic_time();
+    m_statistics = Statistics();
+    m_statistics.threads_num = m_parameters.threads_num;
+
+    // Open input file
+    m_input_fd = ::open(input_filename.c_str(), O_RDONLY);
+    struct stat file_stat;
+    if (m_input_fd < 0 || fstat(m_input_fd, &file_stat) != 0)
+    {
+        std::cerr << "[TrajectoryBatch] Cannot open " << input_filename <<
+            std::endl;
+        if (m_input_fd >= 0) { ::close(m_input_fd); }
+        return false;
+    }
+    m_input_size = file_stat.st_size;
+    posix_fadvise(m_input_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // Initialize blocks and workers
+    m_blocks_num = (m_input_size + m_parameters.block_size - 1) /
+        m_parameters.block_size;
+
+    std::vector<Worker> workers(m_parameters.threads_num);
+    for (auto& worker : workers)
+    {
+        worker.hand = m_hand;
+        worker.anim_hand = m_anim_hand;
+        worker.calibration = m_calibration;
+        worker.row.resize(m_columns_num);
+    }
+
+    // Count samples (animation formats)
+    bool is_animation = m_parameters.format == Format::BVH ||
+        m_parameters.format == Format::GLB;
+    if (is_animation) { count_samples(workers); }
+
+    // Header
+    std::string header;
+    if (m_parameters.format == Format::CSV)
+    {
+        for (const auto& column_name : get_column_names())
+        {
+            header += (header.empty() ? "" : ",") + column_name;
+        }
+        header += "\n";
+    }
+    else if (m_parameters.format == Format::BVH)
+    {
+        header = m_motion_export.get_bvh_header(m_block_offsets.back());
+    }
+    else if (m_parameters.format == Format::GLB)
+    {
+        header = m_motion_export.get_glb_header(m_block_offsets.back());
+        if (header.empty())
+        {
+            std::cerr << "[TrajectoryBatch] " << m_block_offsets.back() <<
+                " frames exceed the 4 GiB of a GLB file, split the session "
+                "or export it as BVH" << std::endl;
+            ::close(m_input_fd);
+            return false;
+        }
+    }
+
+    // Open output file
+    m_output_fd = ::open(output_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+        0644);
+    if (m_output_fd < 0)
+    {
+        std::cerr << "[TrajectoryBatch] Cannot open " << output_filename <<
+            std::endl;
+        ::close(m_input_fd);
+        return false;
+    }
+
+    // Write header
+    bool is_written = write_output(header.data(), header.size(), 0);
+    m_output_size = header.size();
+
+    // Initialize output slots
+    m_slots.assign(2 * m_parameters.threads_num, Slot());
+    m_next_block = 0;
+    m_next_write = 0;
+
+    // Start workers
+    std::vector<std::thread> threads;
+    for (auto& worker : workers)
+    {
+        threads.emplace_back(&TrajectoryBatch::run_worker, this,
+            std::ref(worker));
+    }
+
+    // Write blocks in file order
+    for (size_t i = 0; i < m_blocks_num; i++)
+    {
+        Slot& slot = m_slots.at(i % m_slots.size());
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_block_done.wait(lock, [&slot] { return slot.ready; });
+        }
+
+        // The slot is not reused before it is released
+        if (!write_block(i, slot.output)) { is_written = false; }
+
+        // Release slot
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            slot.ready = false;
+            m_next_write++;
+        }
+        m_slot_free.notify_all();
+    }
+
+    // Join workers
+    for (auto& thread : threads) { thread.join(); }
+
+    // Close files
+    ::close(m_input_fd);
+    m_input_fd = -1;
+    if (::close(m_output_fd) != 0) { is_written = false; }
+    m_output_fd = -1;
+    if (!is_written)
+    {
+        std::cerr << "[TrajectoryBatch] Cannot write " << output_filename <<
+            std::endl;
+    }
+
+    // Gather statistics
+    for (const auto& worker : workers)
+    {
+        m_statistics.lines += worker.statistics.lines;
+        m_statistics.samples += worker.statistics.samples;
+        m_statistics.malformed += worker.statistics.malformed;
+        m_statistics.short_lines += worker.statistics.short_lines;
+        m_statistics.overlong += worker.statistics.overlong;
+    }
+    m_statistics.time = Utils::monotonic_time() - start_time;
+
+    return is_written;
+}
+
+/**
+ * @brief It counts the samples of every block in parallel (the samples are
+ * parsed but not processed) and sets the index of the first sample of
+ * every block (#m_block_offsets).
+ * @param workers The workers.
+ */
+void TrajectoryBatch::count_samples(std::vector<Worker>& workers)
+{
+    m_block_offsets.assign(m_blocks_num + 1, 0);
+    m_next_block = 0;
+
+    std::vector<std::thread> threads;
+    for (auto& worker : workers)
+    {
+        threads.emplace_back([this, &worker] {
+            worker.is_counting = true;
+            std::string output;
+            for (;;)
+            {
+                // Take next block
+                size_t block_idx;
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    if (m_next_block >= m_blocks_num) { break; }
+                    block_idx = m_next_block++;
+                }
+
+                process_block(worker, block_idx, output);
+                m_block_offsets.at(block_idx + 1) = worker.block_samples;
+            }
+            worker.is_counting = false;
+            worker.statistics = Statistics();
+        });
+    }
+    for (auto& thread : threads) { thread.join(); }
+
+    // Index of the first sample of every block
+    for (size_t i = 0; i < m_blocks_num; i++)
+    {
+        m_block_offsets.at(i + 1) += m_block_offsets.at(i);
+    }
+}
+
+/**
+ * @brief It writes a block to the output file. The blocks of the sequential
+ * formats are appended, while the block of the GLB format holds the part of
+ * every stream that belongs to its samples, which is written to its place
+ * in the stream (see MotionExport::get_glb_stream_offset).
+ * @param block_idx The index of the block.
+ * @param output The output of the block.
+ * @return true The block has been written.
+ * @return false The output file could not be written.
+ */
+bool TrajectoryBatch::write_block(size_t block_idx, const std::string& output)
+{
+    // Sequential formats
+    if (m_parameters.format != Format::GLB)
+    {
+        bool is_written = write_output(output.data(), output.size(),
+            m_output_size);
+        m_output_size += output.size();
+        return is_written;
+    }
+
+    // Streams of the GLB format
+    size_t frames_num = m_block_offsets.back();
+    size_t block_begin = m_block_offsets.at(block_idx);
+    size_t block_frames_num = m_block_offsets.at(block_idx + 1) - block_begin;
+
+    size_t data_offset = 0;
+    for (size_t i = 0; i < m_motion_export.get_glb_streams_num(); i++)
+    {
+        size_t element_size = MotionExport::get_glb_element_size(i);
+        if (!write_output(output.data() + data_offset,
+            block_frames_num * element_size,
+            m_motion_export.get_glb_stream_offset(i, frames_num) +
+            block_begin * element_size))
+        {
+            return false;
+        }
+        data_offset += block_frames_num * element_size;
+    }
+    return true;
+}
+
+/**
+ * @brief It writes data to the output file at an offset (the partial writes
+ * are resumed).
+ * @param data The data.
+ * @param size The size of the data (bytes).
+ * @param offset The offset in the output file (bytes).
+ * @return true The data has been written.
+ * @return false The output file could not be written.
+ */
+bool TrajectoryBatch::write_output(const char* data, size_t size,
+    size_t offset)
+{
+    while (size > 0)
+    {
+        ssize_t result = pwrite(m_output_fd, data, size, offset);
+        if (result <= 0) { return false; }
+        data += result;
+        size -= result;
+        offset += result;
+    }
+    return true;
+}
+
+/**
+ * @brief It takes the next block of the input file, waits until its output
+ * slot is free (i.e. the block that used it has been written), processes it
+ * and hands it to the writer, until every block has been taken.
+ * @param worker The state of the worker.
+ */
+void TrajectoryBatch::run_worker(Worker& worker)
+{
+    for (;;)
+    {
+        // Take next block and wait for its slot
+        size_t block_idx;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_next_block >= m_blocks_num) { return; }
+            block_idx = m_next_block++;
+
+            m_slot_free.wait(lock, [this, block_idx] {
+                return block_idx < m_next_write + m_slots.size(); });
+        }
+        Slot& slot = m_slots.at(block_idx % m_slots.size());
+
+        // Process block (the capacity of the output is reused)
+        process_block(worker, block_idx, slot.output);
+
+        // Hand block over to the writer
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            slot.ready = true;
+        }
+        m_block_done.notify_one();
+    }
+}
+
+/**
+ * @brief It processes the lines that start in a block of the input file. It
+ * also reads the byte before the block, to find the start of its first line,
+ * and the tail of its last line, up to the maximum length of a line. Longer
+ * lines are counted as overlong. When counting, the samples of the block
+ * are only counted (Worker::block_samples).
+ * @param worker The state of the worker.
+ * @param block_idx The index of the block.
+ * @param output The output of the block.
+ */
+void TrajectoryBatch::process_block(Worker& worker, size_t block_idx,
+    std::string& output)
+{
+    worker.block_idx = block_idx;
+    worker.block_samples = 0;
+
+    // Initialize output (the GLB streams of the block are set in place)
+    output.clear();
+    if (m_parameters.format == Format::GLB && !worker.is_counting)
+    {
+        size_t block_frames_num = m_block_offsets.at(block_idx + 1) -
+            m_block_offsets.at(block_idx);
+        size_t frame_size = 0;
+        for (size_t i = 0; i < m_motion_export.get_glb_streams_num(); i++)
+        {
+            frame_size += MotionExport::get_glb_element_size(i);
+        }
+        output.resize(block_frames_num * frame_size);
+    }
+
+    // Block range and read range
+    size_t block_begin = block_idx * m_parameters.block_size;
+    size_t block_end = std::min(block_begin + m_parameters.block_size,
+        m_input_size);
+    size_t read_begin = block_begin - (block_idx > 0 ? 1 : 0);
+    size_t read_end = std::min(block_end + m_max_line_length + 1,
+        m_input_size);
+
+    // Read block
+    worker.input.resize(read_end - read_begin);
+    size_t read_size = 0;
+    while (read_size < worker.input.size())
+    {
+        ssize_t result = pread(m_input_fd, worker.input.data() + read_size,
+            worker.input.size() - read_size, read_begin + read_size);
+        if (result <= 0) { break; }
+        read_size += result;
+    }
+
+    const char* data = worker.input.data();
+    const char* data_end = data + read_size;
+    const char* owned_end = data + std::min(block_end - read_begin, read_size);
+    bool is_file_end = read_begin + read_size == m_input_size;
+
+    // The first line starts after the first line ending (the line that
+    // contains the start of the block belongs to the previous block)
+    const char* line_begin = data;
+    if (block_idx > 0)
+    {
+        line_begin = (const char*) memchr(data, '\n', read_size);
+        if (line_begin == nullptr) { return; }
+        line_begin++;
+    }
+
+    // Process the lines that start in the block
+    while (line_begin < owned_end)
+    {
+        const char* line_end = (const char*) memchr(line_begin, '\n',
+            data_end - line_begin);
+        if (line_end == nullptr)
+        {
+            // Last line of the file without line ending
+            if (is_file_end)
+            {
+                process_line(worker, line_begin, data_end, output);
+                return;
+            }
+
+            // Line longer than the read range
+            worker.statistics.lines++;
+            worker.statistics.overlong++;
+            return;
+        }
+
+        process_line(worker, line_begin, line_end, output);
+        line_begin = line_end + 1;
+    }
+}
+
+/**
+ * @brief It processes a line of the input file. A valid sample is
+ * calibrated (see JointCalibration::apply), converted to radians and mapped
+ * to the hand frames (see AnimatedHand::get_hand_angles). The animation
+ * formats encode the hand angles as a frame of the skeleton (see
+ * MotionExport::), otherwise the forward kinematics of the hand are
+ * computed (see HandKinematics::update_kinematics) and the joint and
+ * fingertip positions are appended to the output. Empty lines are ignored.
+ * @param worker The state of the worker.
+ * @param begin The beginning of the line.
+ * @param end The end of the line (its line ending).
+ * @param output The output of the block.
+ */
+void TrajectoryBatch::process_line(Worker& worker, const char* begin,
+    const char* end, std::string& output)
+{
+    // Strip carriage return
+    if (end > begin && *(end - 1) == '\r') { end--; }
+    if (end == begin) { return; }
+
+    // Parse and classify line
+    size_t length = end - begin;
+    bool is_complete = length <= m_max_line_length;
+    worker.line.assign(begin, is_complete ? length : 0);
+
+    double tick, sequence;
+    StreamHealth::LineStatus status = StreamHealth::parse_line(worker.line,
+        is_complete, worker.anim_hand.get_channels_num(), worker.values, tick,
+        sequence);
+
+    if (worker.is_counting)
+    {
+        if (status == StreamHealth::LineStatus::Valid) { worker.block_samples++; }
+        return;
+    }
+
+    worker.statistics.lines++;
+    switch (status)
+    {
+        case StreamHealth::LineStatus::Valid: worker.statistics.samples++; break;
+        case StreamHealth::LineStatus::Malformed: worker.statistics.malformed++; return;
+        case StreamHealth::LineStatus::Short: worker.statistics.short_lines++; return;
+        case StreamHealth::LineStatus::Overlong: worker.statistics.overlong++; return;
+    }
+
+    // Calibrate and convert to rad
+    worker.calibration.apply(worker.values);
+    for (auto& value : worker.values)
+    {
+        value = Utils::deg2rad(value);
+    }
+
+    // Map joint angles to the hand frames
+    worker.anim_hand.get_hand_angles(worker.values, worker.euler_arr);
+
+    // Animation frame
+    if (m_parameters.format == Format::BVH)
+    {
+        m_motion_export.append_bvh_frame(worker.euler_arr, output);
+        return;
+    }
+    if (m_parameters.format == Format::GLB)
+    {
+        size_t block_begin = m_block_offsets.at(worker.block_idx);
+        size_t block_frames_num = m_block_offsets.at(worker.block_idx + 1) -
+            block_begin;
+        if (worker.block_samples < block_frames_num)
+        {
+            m_motion_export.set_glb_frame(worker.euler_arr, block_begin +
+                worker.block_samples, worker.block_samples, block_frames_num,
+                output.data());
+        }
+        worker.block_samples++;
+        return;
+    }
+
+    // Update forward kinematics
+    worker.hand.update_kinematics(worker.euler_arr);
+
+    // Generate row
+    std::vector<double>& row = worker.row;
+    size_t column = 0;
+    row.at(column++) = tick;
+    row.at(column++) = sequence;
+
+    for (auto& finger : worker.hand.get_fingers())
+    {
+        for (const auto& transform : finger.get_global_transforms())
+        {
+            for (size_t k = 0; k < 3; k++) { row.at(column++) = transform(k, 3); }
+        }
+
+        Eigen::Vector3d tip_position = finger.get_tip_position();
+        for (size_t k = 0; k < 3; k++) { row.at(column++) = tip_position(k); }
+    }
+
+    append_row(row, output);
+}
+
+/**
+ * @brief It appends a row to the output, either as raw float64 values or as
+ * a CSV line. The values are formatted with std::to_chars (shortest
+ * representation that reads back to the same value, no locale).
+ * @param row The row.
+ * @param output The output of the block.
+ */
+void TrajectoryBatch::append_row(const std::vector<double>& row,
+    std::string& output)
+{
+    if (m_parameters.format == Format::Binary)
+    {
+        output.append((const char*) row.data(), row.size() * sizeof(double));
+        return;
+    }
+
+    char buffer[32];
+    for (size_t i = 0; i < row.size(); i++)
+    {
+        char* buffer_end = std::to_chars(buffer, buffer + sizeof(buffer),
+            row.at(i)).ptr;
+        output.append(buffer, buffer_end);
+        output.push_back(i + 1 < row.size() ? ',' : '\n');
+    }
+}
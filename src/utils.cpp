@@ -48,4 +48,48 @@ std::vector<double> Utils::analog_str_buf_to_double_vec(const std::string& str)
     }
 
     return data_vec;
-}
\ No newline at end of file
+}
+/**
+ * @brief Parses a comma-delimited string of doubles into a vector without 
+ * throwing and, once the vector has grown, without allocating. It is used 
+ * on the acquisition thread, where a garbled line must be counted and 
+ * dropped rather than raise an exception (see Exoskeleton::), and by the 
+ * offline tools (see TrajectoryBatch::). The values are parsed with 
+ * std::from_chars, which does not depend on the locale and is several 
+ * times faster than strtod. White space around a value and a leading '+' 
+ * are accepted.
+ * @param str The comma-delimited string.
+ * @param data_vec The output vector of doubles (overwritten).
+ * @return true Every value has been parsed.
+ * @return false A value is empty, not a number or not finite (data_vec is 
+ * incomplete).
+ */
+bool Utils::parse_double_vec(const std::string& str,
+    std::vector<double>& data_vec)
+{
+    data_vec.clear();
+
+    const char* begin = str.data();
+    const char* end = begin + str.size();
+    for (;;)
+    {
+        // Skip leading white space and sign
+        while (begin != end && (*begin == ' ' || *begin == '\t')) { begin++; }
+        if (begin != end && *begin == '+') { begin++; }
+
+        // Parse value
+        double value;
+        std::from_chars_result result = std::from_chars(begin, end, value);
+        if (result.ec != std::errc() || !std::isfinite(value)) { return false; }
+
+        // Skip trailing white space
+        const char* next = result.ptr;
+        while (next != end && (*next == ' ' || *next == '\t')) { next++; }
+        data_vec.push_back(value);
+
+        // Next value or end of line
+        if (next == end) { return true; }
+        if (*next != ',') { return false; }
+        begin = next + 1;
+    }
+}
@@ -0,0 +1,743 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <functional>
+#include <type_traits>
+#include <stdexcept>
+#include <limits>
+#include <algorithm>
+
+#include "../include/euler_rotations.h"
+#include "../include/animated_hand.h"
+#include "../include/finger.h"
+#include "../include/hand_kinematics.h"
+#include "../include/skinning_kernel.h"
+#include "../include/jacobian_batch.h"
+#include "../include/hand_collision.h"
+#include "../include/joint_calibration.h"
+#include "../include/trajectory_batch.h"
+
+/**
+ * Tests of the kinematics core against reference implementations, e.g.
+ * every instruction set of the skinning kernel against the scalar one, or
+ * the skinned hand against the reference skinning of each finger, the
+ * fingertip Jacobians against central differences or the contact queries
+ * against brute force, and of the calibration and the offline processing of
+ * a session. Each test returns its first failure (empty if none), and the
+ * executable exits with a nonzero code if any test fails, so it runs under
+ * ctest. The benchmarks (kinematics_bench) only
+ * time these paths.
+ * The tests load the configuration and mesh files from the share folder,
+ * so they must be run from the root of the repository (the working
+ * directory of the ctest test).
+ */
+
+/// Number of precomputed frames of joint angles.
+static constexpr size_t g_frames_num = 64;
+
+/// Joint angles of the precomputed frames (rad).
+static std::vector<std::vector<double>> get_joint_angles(size_t channels_num)
+{
+    std::vector<std::vector<double>> joint_angles(g_frames_num,
+        std::vector<double>(channels_num));
+    for (size_t frame = 0; frame < g_frames_num; frame++)
+    {
+        for (size_t i = 0; i < channels_num; i++)
+        {
+            joint_angles.at(frame).at(i) = 0.5 * sin(0.1 * frame + i);
+        }
+    }
+    return joint_angles;
+}
+
+/// Hand angles of the precomputed frames.
+static std::vector<AnimatedHand::HandAngles> get_poses(
+    AnimatedHand& anim_hand)
+{
+    std::vector<std::vector<double>> joint_angles =
+        get_joint_angles(anim_hand.get_channels_num());
+    std::vector<AnimatedHand::HandAngles> poses(g_frames_num);
+    for (size_t i = 0; i < g_frames_num; i++)
+    {
+        anim_hand.get_hand_angles(joint_angles.at(i), poses.at(i));
+    }
+    return poses;
+}
+
+/**************************** Skinning kernel ***************************/
+/// Check every instruction set of the skinning kernel (limited to the ones
+/// supported by the CPU) against the scalar kernel, on the rest-pose
+/// streams of 30 links with a joint and a bone mesh each (their sizes are
+/// not multiples of the vector widths, so the remainders are skinned too)
+/// and random link transforms. The kernels only differ by the rounding of
+/// the fused multiply-adds.
+template <typename T>
+static std::string check_skinning_kernel(void)
+{
+    using Streams = Eigen::Matrix<T, Eigen::Dynamic, 3>;
+    using Vertices = Eigen::Matrix<T, Eigen::Dynamic, 3, Eigen::RowMajor>;
+
+    // Mesh sizes
+    const size_t links_num = 30;
+    std::vector<size_t> sizes;
+    size_t rest_size = 0;
+    for (size_t i = 0; i < 2 * links_num; i++)
+    {
+        sizes.push_back(i % 2 ? 133 + 7 * i : 97 + 5 * i);
+        rest_size += sizes.back();
+    }
+
+    // Rest-pose streams, outputs, segments and link transforms
+    Streams rest = Streams::Random(rest_size, 3);
+    Vertices out = Vertices::Zero(rest_size, 3);
+    std::vector<SkinningKernel::Segment<T>> segments;
+    std::vector<SkinningKernel::RigidTransform<T>> transforms;
+    size_t offset = 0;
+    for (size_t i = 0; i < sizes.size(); i++)
+    {
+        segments.push_back(SkinningKernel::Segment<T>{offset, sizes.at(i),
+            i / 2, out.data() + 3 * offset});
+        offset += sizes.at(i);
+    }
+    for (size_t i = 0; i < links_num; i++)
+    {
+        Eigen::Matrix4d t_mat = Eigen::Matrix4d::Identity();
+        t_mat.block<3, 3>(0, 0) = EulerRotations::rotation(0.3 * i,
+            0.2 * i + 0.1, 0.7 - 0.1 * i);
+        t_mat.block<3, 1>(0, 3) = Eigen::Vector3d::Random();
+        transforms.push_back(SkinningKernel::rigid_transform<T>(t_mat));
+    }
+
+    // Scalar reference
+    const SkinningKernel::ISA default_isa = SkinningKernel::get_isa();
+    SkinningKernel::set_isa(SkinningKernel::ISA::Scalar);
+    SkinningKernel::skin(rest.data(), rest.rows(), segments, transforms);
+    const Vertices reference = out;
+
+    const T tolerance = std::is_same<T, float>::value ? 1e-5 : 1e-12;
+    std::string message;
+    for (SkinningKernel::ISA isa : {SkinningKernel::ISA::AVX2,
+        SkinningKernel::ISA::AVX512})
+    {
+        SkinningKernel::set_isa(isa);
+        out.setZero();
+        SkinningKernel::skin(rest.data(), rest.rows(), segments, transforms);
+        T error = (out - reference).cwiseAbs().maxCoeff();
+        if (!(error <= tolerance))
+        {
+            std::ostringstream stream;
+            stream << SkinningKernel::get_isa_name(SkinningKernel::get_isa())
+                << " differs from the scalar kernel by " << error;
+            message = stream.str();
+            break;
+        }
+    }
+
+    SkinningKernel::set_isa(default_isa);
+    return message;
+}
+
+/// Check the skinned vertices of both hands (see
+/// HandKinematics::update_vertices) against the reference skinning of each
+/// finger (see Finger::update), over the precomputed frames. In the single
+/// precision build the vertices can differ by the rounding of the rest-pose
+/// vertices and the link transforms (below 0.1 um for the default hand).
+static std::string check_update_vertices(void)
+{
+    AnimatedHand anim_hand;
+    anim_hand.initialize();
+    std::vector<AnimatedHand::HandAngles> poses = get_poses(anim_hand);
+
+    const double tolerance = std::is_same<HandKinematics::VertexScalar,
+        float>::value ? 1e-7 : 1e-12;
+    for (bool type : {false, true})
+    {
+        HandKinematics hand;
+        hand.initialize(type, Eigen::Vector3d(0.0, type ? -0.2 : 0.2, 0.0));
+        for (size_t frame = 0; frame < g_frames_num; frame++)
+        {
+            hand.update(poses.at(frame));
+
+            double error = 0.0;
+            size_t mesh_idx = 0;
+            for (auto& finger : hand.get_fingers())
+            {
+                std::vector<dm::JointState> state = finger.get_state();
+                finger.update(state);
+                for (const auto& vertices : finger.get_vertices())
+                {
+                    error = std::max(error, (vertices - hand.get_vertex_data()
+                        .at(mesh_idx++).cast<double>()).cwiseAbs()
+                        .maxCoeff());
+                }
+            }
+
+            if (!(error <= tolerance))
+            {
+                std::ostringstream message;
+                message << (type ? "right" : "left") << " hand vertices of "
+                    "frame " << frame << " differ from the finger skinning "
+                    "by " << error;
+                return message.str();
+            }
+        }
+    }
+    return "";
+}
+
+/************************** Fingertip Jacobians ************************/
+/// Largest difference between the fingertip twists of the Jacobians (see
+/// HandKinematics::get_tip_twists) and the central differences of the
+/// fingertip positions and rotations, over every hand angle of a pose (m
+/// and rad per rad).
+static double get_jacobian_error(HandKinematics& hand,
+    const AnimatedHand::HandAngles& pose)
+{
+    const double step = 1e-6;
+    std::vector<Finger>& fingers = hand.get_fingers();
+    std::vector<HandKinematics::Twist> twists;
+    std::vector<Eigen::Vector3d> positions(fingers.size());
+    std::vector<Eigen::Matrix3d> rotations(fingers.size());
+    double error = 0.0;
+    for (size_t k = 0; k < pose.size(); k++)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            // Twists of a unit rate of the angle
+            AnimatedHand::HandAngles rates;
+            for (auto& rate : rates) { rate.setZero(); }
+            rates.at(k)(axis) = 1.0;
+            hand.update_kinematics(pose);
+            hand.get_tip_twists(rates, twists);
+
+            // Fingertip poses after a step forward and a step backward
+            AnimatedHand::HandAngles perturbed = pose;
+            perturbed.at(k)(axis) += step;
+            hand.update_kinematics(perturbed);
+            for (size_t i = 0; i < fingers.size(); i++)
+            {
+                positions.at(i) = fingers.at(i).get_tip_position();
+                rotations.at(i) = fingers.at(i).get_global_transforms().back()
+                    .block<3, 3>(0, 0);
+            }
+
+            perturbed.at(k)(axis) -= 2.0 * step;
+            hand.update_kinematics(perturbed);
+            for (size_t i = 0; i < fingers.size(); i++)
+            {
+                Eigen::Vector3d linear = (positions.at(i) -
+                    fingers.at(i).get_tip_position()) / (2.0 * step);
+                Eigen::AngleAxisd rotation(rotations.at(i) *
+                    fingers.at(i).get_global_transforms().back()
+                    .block<3, 3>(0, 0).transpose());
+                Eigen::Vector3d angular = rotation.angle() *
+                    rotation.axis() / (2.0 * step);
+
+                error = std::max({error,
+                    (twists.at(i).head<3>() - linear).cwiseAbs().maxCoeff(),
+                    (twists.at(i).tail<3>() - angular).cwiseAbs().maxCoeff()});
+            }
+        }
+    }
+    return error;
+}
+
+/// Check the fingertip Jacobians of both hands against central differences
+/// of the fingertip poses, on some of the precomputed frames.
+static std::string check_jacobians(void)
+{
+    AnimatedHand anim_hand;
+    anim_hand.initialize();
+    std::vector<AnimatedHand::HandAngles> poses = get_poses(anim_hand);
+
+    const double tolerance = 1e-6;
+    for (bool type : {false, true})
+    {
+        HandKinematics hand;
+        hand.initialize(type, Eigen::Vector3d::Zero(), false);
+        for (size_t frame = 0; frame < g_frames_num; frame += 8)
+        {
+            double error = get_jacobian_error(hand, poses.at(frame));
+            if (!(error <= tolerance))
+            {
+                std::ostringstream message;
+                message << (type ? "right" : "left") << " hand Jacobian of "
+                    "frame " << frame << " differs from central differences "
+                    "by " << error;
+                return message.str();
+            }
+        }
+    }
+    return "";
+}
+
+/// Check the fingertip twists and joint torques of a trajectory evaluated
+/// on 4 threads (see JacobianBatch::) against a single hand model, and
+/// that inputs of the wrong size are rejected before the threads start.
+static std::string check_jacobian_batch(void)
+{
+    AnimatedHand anim_hand;
+    anim_hand.initialize();
+    std::vector<AnimatedHand::HandAngles> poses = get_poses(anim_hand);
+    std::vector<AnimatedHand::HandAngles> euler_rates;
+    JacobianBatch::get_rates(poses, 0.01, euler_rates);
+
+    JacobianBatch::Parameters parameters;
+    parameters.threads_num = 4;
+    JacobianBatch jacobian_batch;
+    jacobian_batch.initialize(parameters);
+    size_t fingers_num = jacobian_batch.get_fingers_num();
+
+    // Fingertip wrenches
+    std::vector<HandKinematics::Wrench> wrenches(poses.size() * fingers_num);
+    for (size_t i = 0; i < wrenches.size(); i++)
+    {
+        wrenches.at(i) << 0.1 * i, -0.2, 0.3, 0.01, 0.02 * i, -0.03;
+    }
+
+    std::vector<HandKinematics::Twist> twists, pose_twists;
+    std::vector<AnimatedHand::HandAngles> torques;
+    AnimatedHand::HandAngles pose_torques;
+    jacobian_batch.get_tip_twists(poses, euler_rates, twists);
+    jacobian_batch.get_joint_torques(poses, wrenches, torques);
+
+    // Single hand model
+    HandKinematics hand;
+    hand.initialize(0, Eigen::Vector3d::Zero(), false);
+    double error = 0.0;
+    for (size_t i = 0; i < poses.size(); i++)
+    {
+        hand.update_kinematics(poses.at(i));
+        hand.get_tip_twists(euler_rates.at(i), pose_twists);
+        for (size_t j = 0; j < fingers_num; j++)
+        {
+            error = std::max(error, (twists.at(i * fingers_num + j) -
+                pose_twists.at(j)).cwiseAbs().maxCoeff());
+        }
+
+        std::vector<HandKinematics::Wrench> pose_wrenches(
+            wrenches.begin() + i * fingers_num,
+            wrenches.begin() + (i + 1) * fingers_num);
+        hand.get_joint_torques(pose_wrenches, pose_torques);
+        for (size_t k = 0; k < pose_torques.size(); k++)
+        {
+            error = std::max(error, (torques.at(i).at(k) -
+                pose_torques.at(k)).cwiseAbs().maxCoeff());
+        }
+    }
+    if (!(error <= 1e-12))
+    {
+        std::ostringstream message;
+        message << "threads differ from a single hand model by " << error;
+        return message.str();
+    }
+
+    // Inputs of the wrong size
+    euler_rates.pop_back();
+    try
+    {
+        jacobian_batch.get_tip_twists(poses, euler_rates, twists);
+        return "missing euler rates were not rejected";
+    }
+    catch (const std::out_of_range&) {}
+
+    wrenches.pop_back();
+    try
+    {
+        jacobian_batch.get_joint_torques(poses, wrenches, torques);
+        return "missing wrenches were not rejected";
+    }
+    catch (const std::invalid_argument&) {}
+
+    return "";
+}
+
+/************************** Contact queries ****************************/
+/// Check the distance of random segment pairs (some of them degenerate or
+/// parallel, see HandCollision::segment_distance_sq) against the minimum
+/// over a grid of points of the segments. The distance can be below the
+/// sampled minimum by half a grid step of each segment at most, and never
+/// above it. It returns the first failure (empty if none).
+static std::string check_segment_distance(void)
+{
+    const size_t pairs_num = 1000, samples_num = 100;
+    for (size_t k = 0; k < pairs_num; k++)
+    {
+        Eigen::Vector3d start_a = Eigen::Vector3d::Random();
+        Eigen::Vector3d end_a = Eigen::Vector3d::Random();
+        Eigen::Vector3d start_b = Eigen::Vector3d::Random();
+        Eigen::Vector3d end_b = Eigen::Vector3d::Random();
+        if (k % 4 == 1) { end_a = start_a; }
+        else if (k % 4 == 2) { end_b = start_b + 0.7 * (end_a - start_a); }
+        else if (k % 4 == 3) { end_b = start_b; }
+
+        Eigen::Vector3d point_a, point_b;
+        double distance = std::sqrt(HandCollision::segment_distance_sq(
+            start_a, end_a, start_b, end_b, point_a, point_b));
+
+        double sampled = std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i <= samples_num; i++)
+        {
+            Eigen::Vector3d sample_a = start_a + (end_a - start_a) *
+                ((double) i / samples_num);
+            for (size_t j = 0; j <= samples_num; j++)
+            {
+                sampled = std::min(sampled, (sample_a - start_b -
+                    (end_b - start_b) * ((double) j / samples_num)).norm());
+            }
+        }
+
+        double bound = 0.5 * ((end_a - start_a).norm() +
+            (end_b - start_b).norm()) / samples_num;
+        if (!(distance <= sampled + 1e-12 && sampled - distance <=
+            bound + 1e-12 && std::abs((point_a - point_b).norm() -
+            distance) <= 1e-12))
+        {
+            std::ostringstream message;
+            message << "segment pair " << k << ": distance " << distance <<
+                ", sampled " << sampled;
+            return message.str();
+        }
+    }
+    return "";
+}
+
+/// Distances between every capsule of a hand and every capsule of another
+/// one (brute force, rows of the first hand).
+static Eigen::MatrixXd get_capsule_distances(const HandCollision& hand_a,
+    const HandCollision& hand_b)
+{
+    const std::vector<HandCollision::Capsule>& capsules_a =
+        hand_a.get_capsules();
+    const std::vector<HandCollision::Capsule>& capsules_b =
+        hand_b.get_capsules();
+    Eigen::MatrixXd distances(capsules_a.size(), capsules_b.size());
+    Eigen::Vector3d point_a, point_b;
+    for (size_t i = 0; i < capsules_a.size(); i++)
+    {
+        const HandCollision::Capsule& a = capsules_a.at(i);
+        for (size_t j = 0; j < capsules_b.size(); j++)
+        {
+            const HandCollision::Capsule& b = capsules_b.at(j);
+            distances(i, j) = std::sqrt(HandCollision::segment_distance_sq(
+                a.start, a.end, b.start, b.end, point_a, point_b)) -
+                a.radius - b.radius;
+        }
+    }
+    return distances;
+}
+
+/// Check the queries of the hierarchy against brute force over every pair
+/// of capsules, for random poses of two hands close enough to touch:
+/// thumb-index distance, self contacts of the left hand, and distance and
+/// contacts between the hands. It returns the first failure (empty if
+/// none) and counts the contacts found.
+static std::string check_hand_collision(AnimatedHand& anim_hand,
+    size_t& contacts_num)
+{
+    const size_t poses_num = 3000;
+    const double tolerance = 1e-12;
+    HandKinematics left_hand, right_hand;
+    left_hand.initialize(0, Eigen::Vector3d(0.0, 0.03, 0.0), false);
+    right_hand.initialize(1, Eigen::Vector3d(0.0, -0.03, 0.0), false);
+    HandCollision::Parameters parameters;
+    parameters.contact_margin = 0.005;
+    HandCollision left_collision, right_collision;
+    left_collision.initialize(left_hand, parameters);
+    right_collision.initialize(right_hand, parameters);
+    const std::vector<HandCollision::Capsule>& capsules =
+        left_collision.get_capsules();
+
+    std::vector<HandCollision::Contact> contacts;
+    std::vector<std::pair<size_t, size_t>> pairs, brute_force_pairs;
+    AnimatedHand::HandAngles euler_arr;
+    contacts_num = 0;
+    for (size_t k = 0; k < poses_num; k++)
+    {
+        // Random poses
+        std::vector<double> joint_angles(anim_hand.get_channels_num());
+        Eigen::Map<Eigen::VectorXd>(joint_angles.data(),
+            joint_angles.size()).setRandom();
+        anim_hand.get_hand_angles(joint_angles, euler_arr);
+        left_hand.update_kinematics(euler_arr);
+        Eigen::Map<Eigen::VectorXd>(joint_angles.data(),
+            joint_angles.size()).setRandom();
+        anim_hand.get_hand_angles(joint_angles, euler_arr);
+        right_hand.update_kinematics(euler_arr);
+        left_collision.update(left_hand);
+        right_collision.update(right_hand);
+
+        Eigen::MatrixXd self_distances =
+            get_capsule_distances(left_collision, left_collision);
+        Eigen::MatrixXd distances =
+            get_capsule_distances(left_collision, right_collision);
+
+        // Thumb-index distance
+        double thumb_index = std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < capsules.size(); i++)
+        {
+            for (size_t j = 0; j < capsules.size(); j++)
+            {
+                if (capsules.at(i).finger == 0 && capsules.at(j).finger == 1)
+                {
+                    thumb_index = std::min(thumb_index, self_distances(i, j));
+                }
+            }
+        }
+        double error = std::abs(left_collision.get_finger_distance(0, 1)
+            .distance - thumb_index);
+
+        // Distance between the hands
+        error = std::max(error, std::abs(left_collision.get_distance(
+            right_collision).distance - distances.minCoeff()));
+
+        // Self contacts and contacts between the hands
+        bool is_same = true;
+        for (bool is_self : {true, false})
+        {
+            const Eigen::MatrixXd& pair_distances = is_self ?
+                self_distances : distances;
+            if (is_self) { left_collision.get_self_contacts(contacts); }
+            else { left_collision.get_contacts(right_collision, contacts); }
+
+            pairs.clear();
+            for (const auto& contact : contacts)
+            {
+                pairs.emplace_back(contact.capsule_a, contact.capsule_b);
+                error = std::max(error, std::abs(contact.distance -
+                    pair_distances(contact.capsule_a, contact.capsule_b)));
+            }
+            brute_force_pairs.clear();
+            for (Eigen::Index i = 0; i < pair_distances.rows(); i++)
+            {
+                for (Eigen::Index j = 0; j < pair_distances.cols(); j++)
+                {
+                    if ((!is_self || capsules.at(i).finger <
+                        capsules.at(j).finger) &&
+                        pair_distances(i, j) <= parameters.contact_margin)
+                    {
+                        brute_force_pairs.emplace_back(i, j);
+                    }
+                }
+            }
+            std::sort(pairs.begin(), pairs.end());
+            is_same = is_same && (pairs == brute_force_pairs);
+            contacts_num += pairs.size();
+        }
+
+        if (!(error <= tolerance) || !is_same)
+        {
+            std::ostringstream message;
+            message << "pose " << k << ": queries differ from brute force "
+                "by " << error << (is_same ? "" : ", different contacts");
+            return message.str();
+        }
+    }
+    return "";
+}
+
+/// Check the contact queries of HandCollision:: against sampling and brute
+/// force. The random poses must bring the hands into contact, so that the
+/// contacts are checked too.
+static std::string check_contact_queries(void)
+{
+    AnimatedHand anim_hand;
+    anim_hand.initialize();
+
+    size_t contacts_num = 0;
+    std::string message = check_segment_distance();
+    if (message.empty())
+    {
+        message = check_hand_collision(anim_hand, contacts_num);
+    }
+    if (message.empty() && contacts_num == 0)
+    {
+        message = "no contacts in the random poses";
+    }
+    return message;
+}
+
+/************************** Joint calibration **************************/
+/// Check that the limits of the calibration file are negated and swapped
+/// for a channel with a negative sign, and that the readings of the
+/// inverse calibration are calibrated back to the joint angles of the
+/// precomputed frames (clamped to the limits), with a gain, an offset and
+/// a cubic correction on every channel.
+static std::string check_joint_calibration(void)
+{
+    AnimatedHand anim_hand;
+    anim_hand.initialize();
+
+    // Limits of a negative channel
+    std::vector<double> signs = anim_hand.get_channel_signs();
+    std::vector<JointCalibration::Parameters> parameters, negative_parameters;
+    JointCalibration::load_parameters(signs, parameters);
+    signs.at(1) = -signs.at(1);
+    JointCalibration::load_parameters(signs, negative_parameters);
+    if (negative_parameters.at(1).min != -parameters.at(1).max ||
+        negative_parameters.at(1).max != -parameters.at(1).min)
+    {
+        return "the limits of a negative channel are not negated";
+    }
+
+    for (auto& channel : parameters)
+    {
+        channel.offset = 5.0;
+        channel.gain = 1.2;
+        channel.polynomial = {0.5, 0.98, 1e-4, -2e-6};
+    }
+    JointCalibration calibration;
+    calibration.initialize(parameters);
+
+    // Round trip of the precomputed frames
+    std::vector<std::vector<double>> joint_angles =
+        get_joint_angles(anim_hand.get_channels_num());
+    double max_error = 0.0;
+    for (const auto& frame_joint_angles : joint_angles)
+    {
+        std::vector<double> sample(frame_joint_angles.size());
+        for (size_t i = 0; i < sample.size(); i++)
+        {
+            sample.at(i) = frame_joint_angles.at(i) * 180.0 / M_PI;
+        }
+        calibration.invert(sample);
+        calibration.apply(sample);
+
+        for (size_t i = 0; i < sample.size(); i++)
+        {
+            double angle = std::clamp(frame_joint_angles.at(i) * 180.0 /
+                M_PI, parameters.at(i).min, parameters.at(i).max);
+            max_error = std::max(max_error, std::abs(sample.at(i) - angle));
+        }
+    }
+
+    std::ostringstream stream;
+    if (max_error > 1e-9)
+    {
+        stream << "round trip error " << max_error << " deg";
+    }
+    return stream.str();
+}
+
+/************************* Offline trajectories ************************/
+/// Check the conversion of a generated session (the precomputed frames in
+/// degrees, with device tick and sequence counter) into binary
+/// trajectories: every line must be a sample, and the trajectories must
+/// not depend on the number of workers. The blocks are small, so the
+/// session is split in many of them.
+static std::string check_trajectory_batch(void)
+{
+    const size_t lines_num = 4096;
+    AnimatedHand anim_hand;
+    anim_hand.initialize();
+
+    // Generate session
+    std::filesystem::path directory = std::filesystem::temp_directory_path();
+    std::string session_filename =
+        (directory / "kinematics_test_session.txt").string();
+    std::vector<std::vector<double>> joint_angles =
+        get_joint_angles(anim_hand.get_channels_num());
+    {
+        std::ofstream session(session_filename);
+        for (size_t i = 0; i < lines_num; i++)
+        {
+            for (double angle : joint_angles.at(i % g_frames_num))
+            {
+                session << angle * 180.0 / M_PI << ",";
+            }
+            session << i << "," << i << "\n";
+        }
+    }
+
+    std::string message;
+    std::vector<std::string> outputs;
+    for (size_t threads_num : {1, 4})
+    {
+        TrajectoryBatch::Parameters parameters;
+        parameters.format = TrajectoryBatch::Format::Binary;
+        parameters.threads_num = threads_num;
+        parameters.block_size = 4096;
+        TrajectoryBatch batch;
+        batch.initialize(parameters);
+
+        std::string output_filename = (directory / ("kinematics_test_"
+            "trajectories_" + std::to_string(threads_num) + ".bin")).string();
+        bool is_processed = batch.process(session_filename, output_filename);
+        const TrajectoryBatch::Statistics& statistics =
+            batch.get_statistics();
+
+        std::ifstream output(output_filename, std::ios::binary);
+        outputs.emplace_back(std::istreambuf_iterator<char>(output),
+            std::istreambuf_iterator<char>());
+        std::filesystem::remove(output_filename);
+
+        std::ostringstream stream;
+        if (!is_processed || statistics.lines != lines_num ||
+            statistics.samples != lines_num)
+        {
+            stream << threads_num << " workers processed " <<
+                statistics.samples << " samples of " << statistics.lines <<
+                " lines (" << lines_num << " expected)";
+        }
+        else if (outputs.back().size() != lines_num * sizeof(double) *
+            batch.get_column_names().size())
+        {
+            stream << threads_num << " workers wrote " <<
+                outputs.back().size() << " bytes";
+        }
+        else if (outputs.back() != outputs.front())
+        {
+            stream << "trajectories of " << threads_num << " workers differ "
+                "from 1 worker";
+        }
+        message = stream.str();
+        if (!message.empty()) { break; }
+    }
+
+    std::filesystem::remove(session_filename);
+    return message;
+}
+
+/**
+ * @brief Runs the tests and reports the failed ones.
+ * @return int 0 if every test passes, 1 otherwise.
+ */
+int main(void)
+{
+    const std::vector<std::pair<std::string, std::function<std::string()>>>
+        tests = {
+        {"skinning_kernel<float>", check_skinning_kernel<float>},
+        {"skinning_kernel<double>", check_skinning_kernel<double>},
+        {"update_vertices", check_update_vertices},
+        {"jacobians", check_jacobians},
+        {"jacobian_batch", check_jacobian_batch},
+        {"contact_queries", check_contact_queries},
+        {"joint_calibration", check_joint_calibration},
+        {"trajectory_batch", check_trajectory_batch},
+    };
+
+    size_t failed_num = 0;
+    for (const auto& [name, test] : tests)
+    {
+        std::string message = test();
+        if (message.empty())
+        {
+            std::cout << "[kinematics_test] " << name << ": passed" <<
+                std::endl;
+        }
+        else
+        {
+            std::cerr << "[kinematics_test] " << name << ": " << message <<
+                std::endl;
+            failed_num++;
+        }
+    }
+
+    std::cout << "[kinematics_test] " << tests.size() - failed_num << " of "
+        << tests.size() << " tests passed" << std::endl;
+
+    return failed_num > 0;
+}
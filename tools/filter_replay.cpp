@@ -0,0 +1,470 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+
+#include "../include/animated_hand.h"
+#include "../include/joint_calibration.h"
+#include "../include/one_euro_filter.h"
+#include "../include/stream_health.h"
+
+/**
+ * Replay of a session through the one-euro filter of the glove channels
+ * (see OneEuroFilter::), to choose the filter parameters from the lag and
+ * the jitter they trade. The session is a recorded one (calibrated like the
+ * stream, see JointCalibration::) or, without a session file, a synthetic
+ * one: every channel clenches from 0 to 90 deg and back with a minimum-jerk
+ * profile, holds each end, and carries gaussian noise and the quantisation
+ * of the potentiometers.
+ *
+ * The rest segments are found on the raw samples of every channel. The
+ * jitter is measured on them only: each segment is replayed twice through a
+ * filter of its channel alone and measured on the second pass, so it
+ * excludes the settling of the filter after the preceding motion, which is
+ * lag. The lag is the delay of the filtered samples at the middle of every
+ * motion between two rest segments, with respect to the raw samples. The
+ * synthetic session also reports the largest error to its noiseless
+ * angles. It loads the glove and calibration configuration files from the
+ * share folder, so it must be run from the root of the repository (like
+ * main).
+ */
+
+/// Usage of the tool.
+static const char* g_usage =
+    "usage: filter_replay [session file] [options]\n"
+    "  --rate HZ          sample rate of the session (default: 100)\n"
+    "  --seconds S        duration of the synthetic session (default: 30)\n"
+    "  --filter MC,B,DC   minimum cutoff (Hz), beta (1/deg) and derivative\n"
+    "                     cutoff (Hz) to replay, on every channel (can be\n"
+    "                     repeated, default: a sweep around the glove\n"
+    "                     configuration file)\n"
+    "  --rest-range DEG   largest motion of a rest segment (default: 2)\n"
+    "  --min-rest S       shortest rest segment (default: 0.5)\n"
+    "  --uncalibrated     the session holds joint angles, not readings\n";
+
+/// Amplitude (deg) and duration (s) of a synthetic clench.
+static constexpr double g_clench_amplitude = 90.0, g_clench_time = 0.4;
+
+/// Duration of a synthetic hold at each end of a clench (s).
+static constexpr double g_hold_time = 1.1;
+
+/// Standard deviation of the synthetic noise (deg).
+static constexpr double g_noise = 0.5;
+
+/// Quantisation step of the synthetic readings (deg).
+static constexpr double g_quantisation = 0.35;
+
+/// Half width of the moving average of the rest detection (s).
+static constexpr double g_average_time = 0.05;
+
+/// Rest segment of a channel (samples [begin, end)).
+struct RestSegment
+{
+    size_t begin, end;
+};
+
+/// Statistics of a filter over the session.
+struct Statistics
+{
+    // Jitter on the rest segments (deg, RMS)
+    double jitter = 0.0;
+
+    // Mean delay at the middle of the motions (s)
+    double lag = NAN;
+
+    // Largest error to the noiseless angles (deg, synthetic session)
+    double max_error = NAN;
+};
+
+/**
+ * @brief Generates the synthetic session: the channels clench together with
+ * a minimum-jerk profile, and each one carries its own noise.
+ * @param channels_num The number of channels.
+ * @param rate The sample rate (Hz).
+ * @param seconds The duration of the session (s).
+ * @param samples The samples (one vector of channels per sample).
+ * @param truth The noiseless angle of every sample (deg).
+ */
+static void generate_session(size_t channels_num, double rate,
+    double seconds, std::vector<std::vector<double>>& samples,
+    std::vector<double>& truth)
+{
+    std::mt19937 generator(1);
+    std::normal_distribution<double> noise(0.0, g_noise);
+    double period = 2.0 * (g_clench_time + g_hold_time);
+
+    size_t samples_num = (size_t) std::llround(seconds * rate);
+    samples.assign(samples_num, std::vector<double>(channels_num));
+    truth.resize(samples_num);
+    for (size_t i = 0; i < samples_num; i++)
+    {
+        // Rest, clench, hold and release
+        double t = std::fmod(i / rate, period);
+        double s = 0.0;
+        if (t < g_hold_time) { s = 0.0; }
+        else if (t < g_hold_time + g_clench_time)
+        {
+            s = (t - g_hold_time) / g_clench_time;
+        }
+        else if (t < 2.0 * g_hold_time + g_clench_time) { s = 1.0; }
+        else { s = (period - t) / g_clench_time; }
+        truth.at(i) = g_clench_amplitude * s * s * s *
+            (10.0 - 15.0 * s + 6.0 * s * s);
+
+        for (auto& value : samples.at(i))
+        {
+            value = g_quantisation * std::round((truth.at(i) +
+                noise(generator)) / g_quantisation);
+        }
+    }
+}
+
+/**
+ * @brief Reads the valid samples of a session file (see
+ * StreamHealth::parse_line) and calibrates them.
+ * @param filename The session file.
+ * @param calibration The calibration of the channels.
+ * @param samples The samples (one vector of channels per sample).
+ * @return true The session has been read.
+ * @return false The file cannot be opened.
+ */
+static bool read_session(const std::string& filename,
+    JointCalibration& calibration, std::vector<std::vector<double>>& samples)
+{
+    std::ifstream input(filename);
+    if (!input.is_open())
+    {
+        std::cerr << "Cannot open " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    std::vector<double> values;
+    double tick, sequence;
+    while (std::getline(input, line))
+    {
+        if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+        if (StreamHealth::parse_line(line, true,
+            calibration.get_channels_num(), values, tick, sequence) !=
+            StreamHealth::LineStatus::Valid)
+        {
+            continue;
+        }
+        calibration.apply(values);
+        samples.push_back(values);
+    }
+    return true;
+}
+
+/**
+ * @brief Finds the rest segments of a channel: the samples around which the
+ * moving average of the raw samples stays within the rest range, in runs of
+ * at least the shortest rest segment.
+ * @param samples The raw samples.
+ * @param channel The channel.
+ * @param rate The sample rate (Hz).
+ * @param rest_range The largest motion of a rest segment (deg).
+ * @param min_rest The shortest rest segment (s).
+ * @return std::vector<RestSegment> The rest segments, in order.
+ */
+static std::vector<RestSegment> get_rest_segments(
+    const std::vector<std::vector<double>>& samples, size_t channel,
+    double rate, double rest_range, double min_rest)
+{
+    size_t samples_num = samples.size();
+    size_t half_width = std::max((size_t) 1,
+        (size_t) std::llround(g_average_time * rate));
+    size_t min_length = (size_t) std::llround(min_rest * rate);
+
+    // Centred moving average
+    std::vector<double> average(samples_num, NAN);
+    double sum = 0.0;
+    for (size_t i = 0; i < samples_num; i++)
+    {
+        sum += samples.at(i).at(channel);
+        if (i >= 2 * half_width + 1)
+        {
+            sum -= samples.at(i - 2 * half_width - 1).at(channel);
+        }
+        if (i >= 2 * half_width)
+        {
+            average.at(i - half_width) = sum / (2 * half_width + 1);
+        }
+    }
+
+    // Runs of samples at rest
+    std::vector<RestSegment> rest_segments;
+    size_t begin = 0;
+    bool is_resting = false;
+    for (size_t i = 0; i <= samples_num; i++)
+    {
+        bool is_rest = i >= 2 * half_width && i + 2 * half_width < samples_num;
+        if (is_rest)
+        {
+            auto window = std::minmax_element(average.begin() + i -
+                half_width, average.begin() + i + half_width + 1);
+            is_rest = *window.second - *window.first < rest_range;
+        }
+
+        if (is_rest && !is_resting) { begin = i; }
+        if (!is_rest && is_resting && i - begin >= min_length)
+        {
+            rest_segments.push_back(RestSegment{begin, i});
+        }
+        is_resting = is_rest;
+    }
+    return rest_segments;
+}
+
+/**
+ * @brief Replays the session through the filter and measures the jitter,
+ * the lag and the error of the filtered samples.
+ * @param samples The raw samples.
+ * @param truth The noiseless angles (empty for a recorded session).
+ * @param rest_segments The rest segments of every channel.
+ * @param parameters The filter parameters of every channel (a non-positive
+ * minimum cutoff replays the raw samples).
+ * @param rate The sample rate (Hz).
+ * @return Statistics The statistics of the filter.
+ */
+static Statistics replay(const std::vector<std::vector<double>>& samples,
+    const std::vector<double>& truth,
+    const std::vector<std::vector<RestSegment>>& rest_segments,
+    const std::vector<OneEuroFilter::Parameters>& parameters, double rate)
+{
+    Statistics statistics;
+    size_t channels_num = parameters.size();
+    double dt = 1.0 / rate;
+
+    // Filter session
+    OneEuroFilter filter;
+    filter.initialize(parameters);
+    std::vector<std::vector<double>> filtered = samples;
+    for (auto& sample : filtered) { filter.filter(sample, dt); }
+
+    // Error to the noiseless angles
+    if (!truth.empty())
+    {
+        statistics.max_error = 0.0;
+        for (size_t i = 0; i < filtered.size(); i++)
+        {
+            for (double value : filtered.at(i))
+            {
+                statistics.max_error = std::max(statistics.max_error,
+                    std::abs(value - truth.at(i)));
+            }
+        }
+    }
+
+    double square_sum = 0.0, lag_sum = 0.0;
+    size_t rest_samples_num = 0, motions_num = 0;
+    for (size_t j = 0; j < channels_num; j++)
+    {
+        const std::vector<RestSegment>& segments = rest_segments.at(j);
+
+        // Jitter on the rest segments (second pass of a filter of the
+        // channel alone)
+        OneEuroFilter channel_filter;
+        channel_filter.initialize({parameters.at(j)});
+        std::vector<double> segment;
+        for (const auto& rest : segments)
+        {
+            channel_filter.reset();
+            for (int pass = 0; pass < 2; pass++)
+            {
+                segment.clear();
+                for (size_t i = rest.begin; i < rest.end; i++)
+                {
+                    double value = samples.at(i).at(j);
+                    channel_filter.filter(&value, dt);
+                    segment.push_back(value);
+                }
+            }
+
+            double mean = 0.0;
+            for (double value : segment) { mean += value; }
+            mean /= segment.size();
+            for (double value : segment)
+            {
+                square_sum += (value - mean) * (value - mean);
+            }
+            rest_samples_num += segment.size();
+        }
+
+        // Lag at the middle of the motions between two rest segments
+        for (size_t k = 0; k + 1 < segments.size(); k++)
+        {
+            auto get_mean = [&](const RestSegment& rest) {
+                double mean = 0.0;
+                for (size_t i = rest.begin; i < rest.end; i++)
+                {
+                    mean += samples.at(i).at(j);
+                }
+                return mean / (rest.end - rest.begin); };
+            double before = get_mean(segments.at(k));
+            double after = get_mean(segments.at(k + 1));
+            double middle = 0.5 * (before + after);
+            double direction = after > before ? 1.0 : -1.0;
+
+            auto get_crossing = [&](
+                const std::vector<std::vector<double>>& values) {
+                for (size_t i = segments.at(k).end;
+                    i < segments.at(k + 1).end; i++)
+                {
+                    if (direction * (values.at(i).at(j) - middle) >= 0.0)
+                    {
+                        return (double) i;
+                    }
+                }
+                return (double) NAN; };
+            double lag = (get_crossing(filtered) - get_crossing(samples)) *
+                dt;
+            if (std::isnan(lag)) { continue; }
+            lag_sum += lag;
+            motions_num++;
+        }
+    }
+
+    if (rest_samples_num > 0)
+    {
+        statistics.jitter = std::sqrt(square_sum / rest_samples_num);
+    }
+    if (motions_num > 0) { statistics.lag = lag_sum / motions_num; }
+    return statistics;
+}
+
+/**
+ * @brief Parses the options, replays the session through every set of
+ * filter parameters and prints the jitter at rest, the lag and the error of
+ * each (the raw samples first, the glove configuration file last).
+ */
+int main(int argc, char** argv)
+{
+    // Parse options
+    double rate = 100.0, seconds = 30.0, rest_range = 2.0, min_rest = 0.5;
+    bool calibrate = true;
+    std::vector<OneEuroFilter::Parameters> filters;
+    std::vector<std::string> filenames;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--rate" && i + 1 < argc) { rate = std::stod(argv[++i]); }
+        else if (arg == "--seconds" && i + 1 < argc)
+        {
+            seconds = std::stod(argv[++i]);
+        }
+        else if (arg == "--filter" && i + 1 < argc)
+        {
+            OneEuroFilter::Parameters parameters;
+            if (std::sscanf(argv[++i], "%lf,%lf,%lf", &parameters.min_cutoff,
+                &parameters.beta, &parameters.d_cutoff) != 3)
+            {
+                std::cerr << g_usage;
+                return 1;
+            }
+            filters.push_back(parameters);
+        }
+        else if (arg == "--rest-range" && i + 1 < argc)
+        {
+            rest_range = std::stod(argv[++i]);
+        }
+        else if (arg == "--min-rest" && i + 1 < argc)
+        {
+            min_rest = std::stod(argv[++i]);
+        }
+        else if (arg == "--uncalibrated") { calibrate = false; }
+        else if (arg.rfind("--", 0) != 0) { filenames.push_back(arg); }
+        else
+        {
+            std::cerr << g_usage;
+            return 1;
+        }
+    }
+
+    if (filenames.size() > 1 || rate <= 0.0)
+    {
+        std::cerr << g_usage;
+        return 1;
+    }
+
+    // Initialize glove mapping and calibration (identity for joint angles)
+    AnimatedHand anim_hand;
+    anim_hand.initialize();
+    size_t channels_num = anim_hand.get_channels_num();
+
+    std::vector<JointCalibration::Parameters> calibration_parameters(
+        channels_num);
+    if (calibrate)
+    {
+        JointCalibration::load_parameters(anim_hand.get_channel_signs(),
+            calibration_parameters);
+    }
+    JointCalibration calibration;
+    calibration.initialize(calibration_parameters);
+
+    // Read or generate session
+    std::vector<std::vector<double>> samples;
+    std::vector<double> truth;
+    if (filenames.empty())
+    {
+        generate_session(channels_num, rate, seconds, samples, truth);
+    }
+    else if (!read_session(filenames.at(0), calibration, samples))
+    {
+        return 1;
+    }
+
+    // Rest segments
+    std::vector<std::vector<RestSegment>> rest_segments(channels_num);
+    size_t rest_samples_num = 0;
+    for (size_t j = 0; j < channels_num; j++)
+    {
+        rest_segments.at(j) = get_rest_segments(samples, j, rate, rest_range,
+            min_rest);
+        for (const auto& rest : rest_segments.at(j))
+        {
+            rest_samples_num += rest.end - rest.begin;
+        }
+    }
+    std::cout << "Session: " << samples.size() << " samples at " << rate <<
+        " Hz (" << (truth.empty() ? "recorded" : "synthetic") << "), " <<
+        rest_samples_num << " samples at rest over " << channels_num <<
+        " channels" << std::endl;
+
+    // Filters to replay
+    if (filters.empty())
+    {
+        filters = {{1.0, 0.0, 1.0}, {1.0, 0.02, 1.0}, {1.0, 0.05, 1.0},
+            {1.5, 0.05, 1.0}};
+    }
+    std::vector<std::pair<std::string, std::vector<OneEuroFilter::Parameters>>>
+        replays = {{"raw", std::vector<OneEuroFilter::Parameters>(
+            channels_num, OneEuroFilter::Parameters{0.0, 0.0, 1.0})}};
+    char name[64];
+    for (const auto& parameters : filters)
+    {
+        std::snprintf(name, sizeof(name), "mc %g, beta %g, dc %g",
+            parameters.min_cutoff, parameters.beta, parameters.d_cutoff);
+        replays.emplace_back(name, std::vector<OneEuroFilter::Parameters>(
+            channels_num, parameters));
+    }
+    replays.emplace_back("glove_config.json",
+        anim_hand.get_filter_parameters());
+
+    // Replay
+    std::printf("%-24s %12s %10s %12s\n", "filter", "jitter (deg)",
+        "lag (ms)", "error (deg)");
+    for (const auto& [replay_name, parameters] : replays)
+    {
+        Statistics statistics = replay(samples, truth, rest_segments,
+            parameters, rate);
+        std::printf("%-24s %12.3f %10.1f %12.2f\n", replay_name.c_str(),
+            statistics.jitter, 1e3 * statistics.lag, statistics.max_error);
+    }
+
+    return 0;
+}
@@ -0,0 +1,239 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <charconv>
+
+#include "../include/hand_ik.h"
+#include "../include/joint_calibration.h"
+
+/**
+ * Solver of the hand angles from fingertip trajectories (see HandIK::). The
+ * input is a CSV file with a header line and the <Finger>_tip_x, _y and _z
+ * columns of every finger (m, with respect to the base frame of the hand),
+ * e.g. the output of trajectory_batch or a motion capture export. The output
+ * is a glove session (one line per frame, channels in degrees, see
+ * AnimatedHand::get_joint_angles) of readings, i.e. the joint angles go
+ * through the inverse calibration (see JointCalibration::invert), so it can
+ * be replayed by the viewer tools (trajectory_batch, session_render). It
+ * loads the glove, calibration and hand configuration files from the share
+ * folder, so it must be run from the root of the repository (like main).
+ */
+
+/// Usage of the tool.
+static const char* g_usage =
+    "usage: fingertip_ik <targets csv> <session file> [options]\n"
+    "  --right              the targets are the fingertips of the right hand\n"
+    "  --threads N          number of solver threads (default: one per core)\n"
+    "  --max-iterations N   maximum number of iterations per finger\n"
+    "  --tolerance M        fingertip position tolerance (m)\n"
+    "  --damping M          damping factor (m)\n"
+    "  --uncalibrated       write joint angles instead of readings\n";
+
+/**
+ * @brief Reads the fingertip targets of a CSV file (the columns are found
+ * by name in the header line, the other columns are ignored).
+ * @param filename The CSV file.
+ * @param finger_names The names of the fingers.
+ * @param targets The targets of every frame, in finger order.
+ * @return true The targets have been read.
+ * @return false The file cannot be opened, or a column is missing or
+ * malformed.
+ */
+static bool read_targets(const std::string& filename,
+    const std::vector<std::string>& finger_names,
+    std::vector<Eigen::Vector3d>& targets)
+{
+    std::ifstream file(filename);
+    std::string line;
+    if (!file.is_open() || !std::getline(file, line))
+    {
+        std::cerr << "Cannot read " << filename << std::endl;
+        return false;
+    }
+
+    // Find columns
+    std::vector<std::string> header;
+    std::stringstream header_stream(line);
+    for (std::string name; std::getline(header_stream, name, ',');)
+    {
+        if (!name.empty() && name.back() == '\r') { name.pop_back(); }
+        header.push_back(name);
+    }
+
+    std::vector<size_t> columns;
+    for (const auto& finger_name : finger_names)
+    {
+        for (const char* axis : {"x", "y", "z"})
+        {
+            auto it = std::find(header.begin(), header.end(),
+                finger_name + "_tip_" + axis);
+            if (it == header.end())
+            {
+                std::cerr << "Missing column " << finger_name << "_tip_" <<
+                    axis << std::endl;
+                return false;
+            }
+            columns.push_back(it - header.begin());
+        }
+    }
+
+    // Read rows
+    std::vector<double> values(header.size());
+    while (std::getline(file, line))
+    {
+        if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+        if (line.empty()) { continue; }
+
+        // Parse the fields of the row (the unused ones may not be numbers)
+        const char* begin = line.data();
+        const char* end = line.data() + line.size();
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            const char* field_end = std::find(begin, end, ',');
+            auto result = std::from_chars(begin, field_end, values.at(i));
+            if (result.ec != std::errc() &&
+                std::find(columns.begin(), columns.end(), i) != columns.end())
+            {
+                std::cerr << "Malformed row: " << line << std::endl;
+                return false;
+            }
+            begin = std::min(field_end + 1, end);
+        }
+
+        for (size_t j = 0; j < finger_names.size(); j++)
+        {
+            targets.emplace_back(values.at(columns.at(3*j)),
+                values.at(columns.at(3*j+1)), values.at(columns.at(3*j+2)));
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Parses the options, solves the fingertip targets in parallel,
+ * writes the glove session and prints the convergence statistics and the
+ * solve time per target.
+ */
+int main(int argc, char** argv)
+{
+    // Parse options
+    HandIK::Parameters parameters;
+    bool calibrate = true;
+    std::vector<std::string> filenames;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--right") { parameters.type = 1; }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            parameters.threads_num = std::stoul(argv[++i]);
+        }
+        else if (arg == "--max-iterations" && i + 1 < argc)
+        {
+            parameters.max_iterations = std::stoul(argv[++i]);
+        }
+        else if (arg == "--tolerance" && i + 1 < argc)
+        {
+            parameters.tolerance = std::stod(argv[++i]);
+        }
+        else if (arg == "--damping" && i + 1 < argc)
+        {
+            parameters.damping = std::stod(argv[++i]);
+        }
+        else if (arg == "--uncalibrated") { calibrate = false; }
+        else if (arg.rfind("--", 0) != 0) { filenames.push_back(arg); }
+        else
+        {
+            std::cerr << g_usage;
+            return 1;
+        }
+    }
+
+    if (filenames.size() != 2)
+    {
+        std::cerr << g_usage;
+        return 1;
+    }
+
+    // Initialize glove mapping and solver
+    AnimatedHand anim_hand;
+    anim_hand.initialize();
+    HandIK hand_ik;
+    hand_ik.initialize(anim_hand, parameters);
+
+    HandKinematics hand;
+    hand.initialize(parameters.type, Eigen::Vector3d::Zero(), false);
+
+    // Initialize calibration (identity for joint angles)
+    std::vector<JointCalibration::Parameters> calibration_parameters(
+        anim_hand.get_channels_num());
+    if (calibrate)
+    {
+        JointCalibration::load_parameters(anim_hand.get_channel_signs(),
+            calibration_parameters);
+    }
+    JointCalibration calibration;
+    calibration.initialize(calibration_parameters);
+
+    // Read targets
+    std::vector<Eigen::Vector3d> targets;
+    if (!read_targets(filenames.at(0), hand.get_finger_names(), targets))
+    {
+        return 1;
+    }
+
+    // Solve targets
+    double start_time = Utils::monotonic_time();
+    std::vector<AnimatedHand::HandAngles> euler_arr;
+    hand_ik.solve_batch(targets, euler_arr);
+    double time = Utils::monotonic_time() - start_time;
+
+    // Write session
+    std::ofstream output(filenames.at(1));
+    std::vector<double> joint_angles;
+    char buffer[32];
+    for (const auto& frame_euler_arr : euler_arr)
+    {
+        // Joint angles (deg) to readings
+        anim_hand.get_joint_angles(frame_euler_arr, joint_angles);
+        for (auto& joint_angle : joint_angles)
+        {
+            joint_angle = Utils::rad2deg(joint_angle);
+        }
+        calibration.invert(joint_angles);
+
+        std::string line;
+        for (size_t i = 0; i < joint_angles.size(); i++)
+        {
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer),
+                joint_angles.at(i));
+            line += (i == 0 ? "" : ",");
+            line.append(buffer, result.ptr);
+        }
+        output << line << "\n";
+    }
+    output.close();
+    if (!output)
+    {
+        std::cerr << "Cannot write " << filenames.at(1) << std::endl;
+        return 1;
+    }
+
+    // Print statistics
+    const HandIK::Statistics& statistics = hand_ik.get_statistics();
+    double targets_num = std::max(statistics.targets, (uint64_t) 1);
+    std::cout << "Frames: " << euler_arr.size() << ", finger targets: " <<
+        statistics.targets << " (converged " << statistics.converged << ", " <<
+        100.0 * statistics.converged / targets_num << " %)" << std::endl;
+    std::cout << "Iterations: " << statistics.iterations / targets_num <<
+        " per target (max " << statistics.max_iterations << ")" << std::endl;
+    std::cout << "Error: " << statistics.error_sum / targets_num <<
+        " m mean, " << statistics.max_error << " m max" << std::endl;
+    std::cout << "Time: " << time << " s, " << 1e6 *
+        statistics.solve_time / targets_num << " us per target (" <<
+        hand_ik.get_threads_num() << " threads)" << std::endl;
+
+    return 0;
+}
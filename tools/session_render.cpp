@@ -0,0 +1,168 @@
+#include <iostream>
+#include <vector>
+#include <string>
+
+#include "../include/session_render.h"
+
+/**
+ * Offline renderer of recorded sessions into PNG frames of the hands (see
+ * SessionRender::). It loads the glove, calibration and hand configuration
+ * files and the meshes from the share folder, so it must be run from the
+ * root of the repository (like main).
+ */
+
+/// Usage of the tool.
+static const char* g_usage =
+    "usage: session_render <session file> <output folder> [options]\n"
+    "  --width W           width of the frames (pixels)\n"
+    "  --height H          height of the frames (pixels)\n"
+    "  --render-mode MODE  cpu, gpu or instanced (see Hand::RenderMode)\n"
+    "  --encoders N        number of PNG encoders (default: one per core\n"
+    "                      but the renderer's)\n"
+    "  --stride N          render one frame every N samples\n"
+    "  --compare MODE      render every frame in MODE as well and fail if\n"
+    "                      the geometry of the frames differs\n"
+    "  --max-different-pixels N\n"
+    "                      different pixels allowed per compared frame\n"
+    "                      (default: 0.01% of the frame, rasterization\n"
+    "                      of the edges)\n"
+    "  --headless          create an EGL context without a display (GLFW\n"
+    "                      3.4, e.g. llvmpipe without Xvfb)\n"
+    "  --uncalibrated      the session holds joint angles, not readings\n";
+
+/**
+ * @brief Parses a render mode.
+ * @param mode The name of the mode (cpu, gpu or instanced).
+ * @param render_mode The render mode.
+ * @return true The mode is valid.
+ */
+static bool parse_render_mode(const std::string& mode,
+    Hand::RenderMode& render_mode)
+{
+    if (mode == "cpu") { render_mode = Hand::RenderMode::CPU; }
+    else if (mode == "gpu") { render_mode = Hand::RenderMode::GPU; }
+    else if (mode == "instanced") { render_mode = Hand::RenderMode::Instanced; }
+    else { return false; }
+    return true;
+}
+
+/**
+ * @brief Parses the options, renders the session and prints the statistics
+ * of the rendering (frames per second of the renderer and of the encoders).
+ */
+int main(int argc, char** argv)
+{
+    // Parse options
+    SessionRender::Parameters parameters;
+    std::vector<std::string> filenames;
+    int64_t max_different_pixels = -1;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--width" && i + 1 < argc)
+        {
+            parameters.width = std::stoi(argv[++i]);
+        }
+        else if (arg == "--height" && i + 1 < argc)
+        {
+            parameters.height = std::stoi(argv[++i]);
+        }
+        else if (arg == "--render-mode" && i + 1 < argc)
+        {
+            if (!parse_render_mode(argv[++i], parameters.render_mode))
+            {
+                std::cerr << g_usage;
+                return 1;
+            }
+        }
+        else if (arg == "--encoders" && i + 1 < argc)
+        {
+            parameters.encoders_num = std::stoul(argv[++i]);
+        }
+        else if (arg == "--stride" && i + 1 < argc)
+        {
+            parameters.stride = std::stoul(argv[++i]);
+        }
+        else if (arg == "--compare" && i + 1 < argc)
+        {
+            parameters.compare = true;
+            if (!parse_render_mode(argv[++i], parameters.reference_mode))
+            {
+                std::cerr << g_usage;
+                return 1;
+            }
+        }
+        else if (arg == "--headless")
+        {
+            parameters.headless = true;
+        }
+        else if (arg == "--uncalibrated")
+        {
+            parameters.calibrate = false;
+        }
+        else if (arg == "--max-different-pixels" && i + 1 < argc)
+        {
+            max_different_pixels = std::stoll(argv[++i]);
+        }
+        else if (arg.rfind("--", 0) != 0) { filenames.push_back(arg); }
+        else
+        {
+            std::cerr << g_usage;
+            return 1;
+        }
+    }
+
+    if (filenames.size() != 2)
+    {
+        std::cerr << g_usage;
+        return 1;
+    }
+
+    if (max_different_pixels < 0)
+    {
+        max_different_pixels = (int64_t) parameters.width *
+            parameters.height / 10000;
+    }
+
+    // Render session
+    SessionRender session_render;
+    session_render.initialize(parameters);
+    if (!session_render.process(filenames.at(0), filenames.at(1))) { return 1; }
+
+    // Print statistics
+    const SessionRender::Statistics& statistics =
+        session_render.get_statistics();
+    std::cout << "Samples: " << statistics.samples << " of " <<
+        statistics.lines << " lines (malformed " << statistics.malformed <<
+        ", short " << statistics.short_lines << ", overlong " <<
+        statistics.overlong << ")" << std::endl;
+    std::cout << "Renderer: " << statistics.renderer << std::endl;
+    std::cout << "Render: " << statistics.frames << " frames, " <<
+        statistics.frames / std::max(statistics.render_time, 1e-9) <<
+        " fps (waited " << statistics.encoder.wait_time <<
+        " s for the encoders)" << std::endl;
+    std::cout << "Encode: " << statistics.encoder.frames / std::max(
+        statistics.encoder.encode_time, 1e-9) << " fps per encoder (" <<
+        statistics.encoders_num << " encoders)" << std::endl;
+    std::cout << "Time: " << statistics.time << " s, " <<
+        statistics.frames / std::max(statistics.time, 1e-9) << " fps" <<
+        std::endl;
+
+    // Check the geometry against the reference mode
+    if (statistics.compared_frames > 0)
+    {
+        std::cout << "Compare: " << statistics.compared_frames <<
+            " frames, at most " << statistics.max_different_pixels <<
+            " different pixels (largest color difference " <<
+            statistics.max_color_difference << ")" << std::endl;
+        if (statistics.max_different_pixels >
+            (uint64_t) max_different_pixels)
+        {
+            std::cerr << "The frames differ from the reference mode" <<
+                std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
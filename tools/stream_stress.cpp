@@ -0,0 +1,290 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <cstdio>
+#include <cmath>
+#include <pty.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+
+#include "../include/utils.h"
+#include "../include/exoskeleton.h"
+#include "../include/frame_arena.h"
+#include "../include/thread_scheduler.h"
+
+/**
+ * Stress test of the serial acquisition under CPU load. A pseudo terminal
+ * plays the glove: its master side is written by a device thread at the
+ * sample rate, with a tick and a sequence counter on every line, and its
+ * slave side is read by an Exoskeleton:: (its acquisition thread and ring
+ * buffer), with the scheduling options of the thread configuration file (see
+ * ThreadScheduler::). The main thread plays the animation loop: it collects
+ * the samples at the frame rate (Exoskeleton::get_joint_samples) with the
+ * scheduling options of the compute thread. Load threads keep every CPU busy
+ * meanwhile. A line is overrun if the receive buffer is full when the device
+ * sends it (the line a UART would lose), missed if its sequence counter
+ * never arrives, and dropped if the ring buffer is full because the frames
+ * do not collect the samples in time. It must be run from the root of the
+ * repository (like main) to use the thread configuration file.
+ */
+
+/// Usage of the tool.
+static const char* g_usage =
+    "usage: stream_stress [options]\n"
+    "  --rate HZ          sample rate of the device (default: 1000)\n"
+    "  --seconds S        duration of the stream (default: 10)\n"
+    "  --load N           number of load threads (default: one per core)\n"
+    "  --priority P       SCHED_FIFO priority of the acquisition thread\n"
+    "                     (default: thread configuration file, 0: none)\n"
+    "  --buffer BYTES     receive buffer of the device (default: 4096)\n"
+    "  --fps FPS          frame rate of the animation loop (default: 30)\n"
+    "  --frame-priority P SCHED_FIFO priority of the animation loop\n"
+    "                     (default: thread configuration file, 0: none)\n";
+
+/// Glove line of the default topology without tick and sequence.
+static const std::string g_glove_values = "12.50,-3.25,45.00,0.00,1.50,"
+    "2.50,3.50,-4.50,5.50,6.50,-7.50,8.50,9.50";
+
+/// Number of channels of the default topology.
+static constexpr int g_channels_num = 13;
+
+/// Counters of the device thread.
+struct DeviceCounters
+{
+    std::atomic<uint64_t> sent{0}, overrun{0};
+};
+
+/**
+ * @brief Writes the glove lines to the master side of the pseudo terminal
+ * at the sample rate (absolute deadlines, so a late line does not delay the
+ * next ones) until it is stopped. A line that does not fit in the receive
+ * buffer of the slave side is not written and is counted as overrun.
+ * @param master The master side of the pseudo terminal.
+ * @param slave The slave side (to query its receive buffer).
+ * @param rate The sample rate (Hz).
+ * @param buffer_size The receive buffer (bytes).
+ * @param is_stopped Whether to stop.
+ * @param counters The counters of the device.
+ */
+static void run_device(int master, int slave, double rate,
+    int buffer_size, const std::atomic<bool>& is_stopped,
+    DeviceCounters& counters)
+{
+    // The device keeps its timing under load if it is permitted
+    ThreadScheduler::Parameters parameters;
+    parameters.priority = 90;
+    ThreadScheduler::apply(parameters);
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    long period = std::lround(1e9 / rate);
+    char line[256];
+    for (uint64_t sequence = 0; !is_stopped; sequence++)
+    {
+        // Wait for the next sample
+        deadline.tv_nsec += period;
+        while (deadline.tv_nsec >= 1000000000)
+        {
+            deadline.tv_nsec -= 1000000000;
+            deadline.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr);
+
+        // Send the line if it fits in the receive buffer
+        int length = snprintf(line, sizeof(line), "%s,%llu,%llu\r\n",
+            g_glove_values.c_str(), (unsigned long long) sequence,
+            (unsigned long long) sequence);
+        int pending = 0;
+        ioctl(slave, TIOCINQ, &pending);
+        if (pending + length > buffer_size ||
+            write(master, line, length) != length)
+        {
+            counters.overrun++;
+        }
+        else { counters.sent++; }
+    }
+}
+
+/**
+ * @brief Parses the options, streams the glove lines under load, collects
+ * them at the frame rate and prints the lines that were overrun, missed or
+ * dropped.
+ * @return int 0 if no line was lost, 1 otherwise.
+ */
+int main(int argc, char** argv)
+{
+    // Parse options
+    double rate = 1000.0, seconds = 10.0, fps = 30.0;
+    size_t load_num = std::max(std::thread::hardware_concurrency(), 1u);
+    int priority = -1, frame_priority = -1, buffer_size = 4096;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--rate" && i + 1 < argc) { rate = std::stod(argv[++i]); }
+        else if (arg == "--seconds" && i + 1 < argc)
+        {
+            seconds = std::stod(argv[++i]);
+        }
+        else if (arg == "--load" && i + 1 < argc)
+        {
+            load_num = std::stoul(argv[++i]);
+        }
+        else if (arg == "--priority" && i + 1 < argc)
+        {
+            priority = std::stoi(argv[++i]);
+        }
+        else if (arg == "--buffer" && i + 1 < argc)
+        {
+            buffer_size = std::stoi(argv[++i]);
+        }
+        else if (arg == "--fps" && i + 1 < argc) { fps = std::stod(argv[++i]); }
+        else if (arg == "--frame-priority" && i + 1 < argc)
+        {
+            frame_priority = std::stoi(argv[++i]);
+        }
+        else
+        {
+            std::cerr << g_usage;
+            return 1;
+        }
+    }
+
+    // Scheduling of the acquisition and compute threads
+    ThreadScheduler scheduler;
+    scheduler.initialize();
+    ThreadScheduler::Parameters acquisition_parameters =
+        scheduler.get_acquisition_parameters();
+    if (priority >= 0) { acquisition_parameters.priority = priority; }
+    ThreadScheduler::Parameters compute_parameters =
+        scheduler.get_compute_parameters();
+    if (frame_priority >= 0) { compute_parameters.priority = frame_priority; }
+    ThreadScheduler::Status compute_status =
+        ThreadScheduler::apply(compute_parameters);
+
+    // Open pseudo terminal in raw mode
+    int master, slave;
+    char name[256];
+    if (openpty(&master, &slave, name, nullptr, nullptr) != 0)
+    {
+        std::cerr << "Cannot open a pseudo terminal" << std::endl;
+        return 1;
+    }
+    struct termios tty;
+    tcgetattr(slave, &tty);
+    cfmakeraw(&tty);
+    tcsetattr(slave, TCSANOW, &tty);
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    // Load threads (default scheduling, not the one they inherit), created
+    // first (their stacks are locked) and started with the frames
+    bool is_memory_locked = scheduler.lock_memory();
+    std::atomic<bool> is_stopped{false}, is_loading{false};
+    std::vector<std::thread> load_threads;
+    for (size_t i = 0; i < load_num; i++)
+    {
+        load_threads.emplace_back([&is_stopped, &is_loading]() {
+            ThreadScheduler::apply(ThreadScheduler::Parameters());
+            while (!is_loading && !is_stopped)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            volatile double x = 1.0;
+            while (!is_stopped) { x = x * 1.0000001 + 1e-9; } });
+    }
+
+    // Device thread
+    DeviceCounters device;
+    std::thread device_thread(run_device, master, slave, rate, buffer_size,
+        std::cref(is_stopped), std::ref(device));
+
+    // Exoskeleton (starts its acquisition thread)
+    Exoskeleton exoskeleton;
+    exoskeleton.initialize(name, 115200, g_channels_num, {},
+        acquisition_parameters);
+    is_loading = true;
+
+    // Animation loop: collect the samples at the frame rate
+    FrameArena arena;
+    uint64_t samples_num = 0;
+    double prev_time = NAN, max_interval = 0.0;
+    auto collect_samples = [&]() {
+        arena.reset();
+        Eigen::Map<Eigen::MatrixXd> samples =
+            exoskeleton.get_joint_samples(arena);
+        for (Eigen::Index i = 0; i < samples.cols(); i++)
+        {
+            double time = samples(Exoskeleton::arrival_time_row, i);
+            if (!std::isnan(prev_time))
+            {
+                max_interval = std::max(max_interval, time - prev_time);
+            }
+            prev_time = time;
+        }
+        samples_num += samples.cols(); };
+
+    auto frame_period = std::chrono::duration_cast<
+        std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / fps));
+    auto end_time = std::chrono::steady_clock::now() +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(seconds));
+    for (auto frame_time = std::chrono::steady_clock::now();
+        frame_time < end_time; frame_time += frame_period)
+    {
+        std::this_thread::sleep_until(frame_time);
+        collect_samples();
+    }
+
+    // Stop the device, let the acquisition drain the pseudo terminal (the
+    // frames go on collecting the samples), then stop it and collect the
+    // last samples
+    is_stopped = true;
+    device_thread.join();
+    for (int i = 0; i < 100; i++)
+    {
+        int pending = 0;
+        ioctl(slave, TIOCINQ, &pending);
+        if (pending == 0) { break; }
+        std::this_thread::sleep_for(frame_period);
+        collect_samples();
+    }
+    std::this_thread::sleep_for(frame_period);
+    exoskeleton.stop();
+    collect_samples();
+    for (auto& thread : load_threads) { thread.join(); }
+    close(master);
+    close(slave);
+
+    // Print results
+    StreamHealth::Statistics stats = exoskeleton.get_stream_health();
+    const ThreadScheduler::Status& acquisition_status =
+        exoskeleton.get_scheduling_status();
+    auto get_scheduling = [](const ThreadScheduler::Status& status) {
+        return status.is_realtime ? "SCHED_FIFO " +
+            std::to_string(status.priority) :
+            std::string("default scheduling"); };
+    std::cout << "Acquisition: " << get_scheduling(acquisition_status) <<
+        ", frames: " << get_scheduling(compute_status) << ", memory " <<
+        (is_memory_locked ? "locked" : "not locked") << std::endl;
+    std::cout << "Stream: " << rate << " Hz for " << seconds << " s, " <<
+        fps << " frames per second, " << load_num << " load threads" <<
+        std::endl;
+    std::cout << "Lines: " << device.sent + device.overrun << " generated, " <<
+        device.overrun << " overrun, " << stats.lines << " received, " <<
+        stats.lost << " missed (" << stats.sequence_gaps << " gaps), " <<
+        stats.duplicates << " duplicates, " <<
+        stats.malformed + stats.short_lines + stats.overlong << " bad" <<
+        std::endl;
+    std::cout << "Samples: " << samples_num << " collected, " <<
+        stats.dropped << " dropped" << std::endl;
+    std::cout << "Largest interval between lines: " << 1e3 * max_interval <<
+        " ms" << std::endl;
+
+    return (device.overrun > 0 || stats.lost > 0 || stats.dropped > 0) ?
+        1 : 0;
+}
@@ -0,0 +1,109 @@
+#include <iostream>
+#include <vector>
+#include <string>
+
+#include "../include/trajectory_batch.h"
+
+/**
+ * Offline converter of recorded sessions into joint and fingertip
+ * trajectories, or into BVH and glTF animations of the hand skeleton (see
+ * TrajectoryBatch::). It loads the glove, calibration and hand
+ * configuration files from the share folder, so it must be run from the
+ * root of the repository (like main).
+ */
+
+/// Usage of the tool.
+static const char* g_usage =
+    "usage: trajectory_batch <session file> <output file> [options]\n"
+    "  --right            the session was recorded with the right hand\n"
+    "  --binary           write float64 rows instead of CSV\n"
+    "  --bvh              write a BVH animation of the skeleton\n"
+    "  --glb              write a binary glTF animation of the skeleton\n"
+    "  --frame-time S     time between two samples of the animation (s)\n"
+    "  --threads N        number of workers (default: one per core)\n"
+    "  --block-size BYTES size of a block of the session file\n"
+    "  --uncalibrated     the session holds joint angles, not readings\n"
+    "  --columns          print the output columns and exit\n";
+
+/**
+ * @brief Parses the options, processes the session and prints the
+ * statistics of the processing.
+ */
+int main(int argc, char** argv)
+{
+    // Parse options
+    TrajectoryBatch::Parameters parameters;
+    std::vector<std::string> filenames;
+    bool print_columns = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--right") { parameters.type = 1; }
+        else if (arg == "--binary")
+        {
+            parameters.format = TrajectoryBatch::Format::Binary;
+        }
+        else if (arg == "--bvh")
+        {
+            parameters.format = TrajectoryBatch::Format::BVH;
+        }
+        else if (arg == "--glb")
+        {
+            parameters.format = TrajectoryBatch::Format::GLB;
+        }
+        else if (arg == "--frame-time" && i + 1 < argc)
+        {
+            parameters.frame_time = std::stod(argv[++i]);
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            parameters.threads_num = std::stoul(argv[++i]);
+        }
+        else if (arg == "--block-size" && i + 1 < argc)
+        {
+            parameters.block_size = std::stoul(argv[++i]);
+        }
+        else if (arg == "--uncalibrated") { parameters.calibrate = false; }
+        else if (arg == "--columns") { print_columns = true; }
+        else if (arg.rfind("--", 0) != 0) { filenames.push_back(arg); }
+        else
+        {
+            std::cerr << g_usage;
+            return 1;
+        }
+    }
+
+    // Initialize batch processor
+    TrajectoryBatch batch;
+    batch.initialize(parameters);
+
+    if (print_columns)
+    {
+        for (const auto& column_name : batch.get_column_names())
+        {
+            std::cout << column_name << std::endl;
+        }
+        return 0;
+    }
+
+    if (filenames.size() != 2)
+    {
+        std::cerr << g_usage;
+        return 1;
+    }
+
+    // Process session
+    if (!batch.process(filenames.at(0), filenames.at(1))) { return 1; }
+
+    // Print statistics
+    const TrajectoryBatch::Statistics& statistics = batch.get_statistics();
+    std::cout << "Samples: " << statistics.samples << " of " <<
+        statistics.lines << " lines (malformed " << statistics.malformed <<
+        ", short " << statistics.short_lines << ", overlong " <<
+        statistics.overlong << ")" << std::endl;
+    std::cout << "Time: " << statistics.time << " s, " <<
+        statistics.samples / std::max(statistics.time, 1e-9) / 1e6 <<
+        " Msamples/s (" << statistics.threads_num << " threads)" << std::endl;
+
+    return 0;
+}